@@ -29,7 +29,7 @@ all:	kn10-kl DPROCS_KL ALL_UTILS
 # Modules needed for KL10 version.
 
 OFILES_KL = klh10.o prmstr.o fecmd.o feload.o wfio.o osdsup.o \
-	kn10cpu.o kn10pag.o kn10clk.o opdata.o kn10ops.o \
+	kn10cpu.o kn10pag.o kn10clk.o kn10prf.o kn10ckp.o opdata.o kn10ops.o \
 	inmove.o inhalf.o inblsh.o intest.o \
 	infix.o  inflt.o  inbyte.o injrst.o \
 	inexts.o inio.o   kn10dev.o 	\
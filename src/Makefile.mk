@@ -164,8 +164,8 @@ depend:
 # Generic header files
 
 CONFS = cenv.h klh10.h word10.h wfio.h fecmd.h feload.h \
-	kn10mac.h kn10def.h kn10pag.h kn10clk.h kn10dev.h kn10ops.h \
-	opcods.h opdefs.h osdsup.h \
+	kn10mac.h kn10def.h kn10pag.h kn10clk.h kn10dev.h kn10ops.h kn10prf.h \
+	kn10ckp.h opcods.h opdefs.h osdsup.h \
 	dvcty.h dvuba.h dvrh11.h dvlhdh.h dvdz11.h dvch11.h \
 	dvrh20.h dvrpxx.h dvtm03.h dvni20.h dvhost.h dvlites.h \
 	vmtape.h vdisk.h config.h
@@ -622,6 +622,12 @@ kn10dev.o: $(SRC)/kn10dev.c $(SRC)/kn10dev.h $(BLDSRC)/config.h
 kn10ops.o: $(SRC)/kn10ops.c $(SRC)/kn10ops.h $(BLDSRC)/config.h
 	$(BUILDMOD) $(SRC)/kn10ops.c
 
+kn10prf.o: $(SRC)/kn10prf.c $(SRC)/kn10prf.h $(BLDSRC)/config.h
+	$(BUILDMOD) $(SRC)/kn10prf.c
+
+kn10ckp.o: $(SRC)/kn10ckp.c $(SRC)/kn10ckp.h $(BLDSRC)/config.h
+	$(BUILDMOD) $(SRC)/kn10ckp.c
+
 kn10pag.o: $(SRC)/kn10pag.c $(SRC)/kn10pag.h $(BLDSRC)/config.h
 	$(BUILDMOD) $(SRC)/kn10pag.c
 
@@ -359,6 +359,10 @@ main(int argc, char **argv)
     if (DBGFLG)
 	dbprint("DP inited");
 
+    /* Input to 10 must be queued in a ring iff we were built to do so */
+    if (!dp.dp_adr->dpc_frdp.dpx_qsiz != !KLH10_DP_RING)
+	efatal(1, "KLH10_DP_RING mismatch with 10");
+
     /* Always attempt to lock memory since the DP processes are fairly
     ** small, must respond quickly, and SU mode is more or less guaranteed.
     ** Skip it only if dp_main() already did it for us.
@@ -1195,19 +1199,35 @@ void ethtoten(struct dpni20_s *dpni)
     int stoploop = 50;
 
     dpx = dp_dpxfr(&dp);		/* Get ptr to from-DP comm rgn */
+#if KLH10_DP_RING
+    max = MAXETHERLEN;
+
+    /* Tell KLH10 we're initialized and ready by queueing initial msg */
+    (void) dp_xqswait(dpx, (size_t)0);
+    dp_xqsput(dpx, DPNI_INIT, (size_t)0);
+    dp_xqsend(dpx);
+#else
     buff = dp_xsbuff(dpx, &max);	/* Set up buffer ptr & max count */
 
     /* Tell KLH10 we're initialized and ready by sending initial packet */
     dp_xswait(dpx);			/* Wait until buff free, in case */
     dp_xsend(dpx, DPNI_INIT, 0);	/* Send INIT */
+#endif
 
     if (DBGFLG)
 	dbprintln("sent INIT");
 
     /* Standard algorithm, one packet per read call */
     for (;;) {
+#if KLH10_DP_RING
+	/* Get a free slot in the ring; the 10 may still be working on
+	** earlier ones.
+	*/
+	buff = dp_xqswait(dpx, max);
+#else
 	/* Make sure that buffer is free before clobbering it */
 	dp_xswait(dpx);			/* Wait until buff free */
+#endif
 
 	if (DBGFLG)
 	    dbprintln("InWait");
@@ -1268,7 +1288,12 @@ void ethtoten(struct dpni20_s *dpni)
 #endif
 
 	/* Normal packet, pass to 10 via DPC */
+#if KLH10_DP_RING
+	dp_xqsput(dpx, DPNI_RPKT, (size_t)cnt);
+	dp_xqsend(dpx);
+#else
 	dp_xsend(dpx, DPNI_RPKT, cnt);
+#endif
 	if (DBGFLG)
 	    dbprint("sent RPKT");
     }	/* Infinite loop reading packetfilter input */
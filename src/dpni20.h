@@ -35,6 +35,10 @@
 /* Version of DPNI20-specific shared memory structure */
 
 #define DPNI20_VERSION DPC_VERSION(1,1,3)	/* 1.1.3 */
+
+#ifndef DPNI_RQLEN	/* # max-size packets the input ring holds */
+# define DPNI_RQLEN 32	/* (if KLH10_DP_RING) */
+#endif
 #define IFNAM_LEN	PATH_MAX	/* at least IFNAMSIZ! */
 
 /* DPNI20-specific stuff */
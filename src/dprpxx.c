@@ -85,6 +85,7 @@ struct devdk {
 
 void rptoten(struct devdk *);
 void tentorp(struct devdk *);
+int  rpdocmd(struct devdk *, int);
 
 void dprpclear(struct devdk *);
 #if 0
@@ -184,6 +185,10 @@ main(int argc, char **argv)
     if (DBGFLG)
 	fprintf(stderr, "[dprpxx: Started]");
 
+    /* Commands must be queued in a ring iff we were built to do so */
+    if (!dp_dpxto(&d->d_dp)->dpx_qsiz != !KLH10_DP_RING)
+	efatal(1, "KLH10_DP_RING mismatch with 10");
+
     /* See if using DMA to 10 memory, and set up if so */
     d->d_10mem = NULL;
     if (d->d_rp->dprp_dma) {
@@ -318,115 +323,152 @@ void chkmntreq(register struct devdk *d)
 void tentorp(register struct devdk *d)
 {
     register struct dpx_s *dpx;
-    register unsigned char *buff;
-    size_t max;
-    register int rcnt;
     int res;
-    int cmd;
-
+#if KLH10_DP_RING
+    register unsigned char *ucp;
+    register struct dprp_rq *rq;
+    register struct dprpxx_s *dprp = d->d_rp;
+    int cmd, failed;
+#endif
 
     if (DBGFLG)
 	fprintf(stderr, "[dprpxx: in tentorp]");
 
     dpx = dp_dpxto(&(d->d_dp));		/* Get ptr to "To-DP" xfer stuff */
-    buff = dp_xrbuff(dpx, &max);
 
     for (;;) {
 
 	/* Wait until 10 has a command for us */
 	dp_xrwait(dpx);
 
-	/* Reset some stuff for every command */
-	d->d_rp->dprp_err = 0;
-	res = DPRP_RES_SUCC;		/* Default is successful op */
+#if KLH10_DP_RING
+	/* Carry out the whole batch, passing each request's vars through
+	** the usual shared ones.  Taking the last slot tells the 10 we're
+	** done with all of them.
+	*/
+	failed = FALSE;
+	while ((ucp = dp_xqrbuff(dpx, &cmd, (size_t *)NULL))) {
+	    rq = (struct dprp_rq *)ucp;
+	    if (rq->rq_chain && failed) {	/* Skip rest of failed batch */
+		rq->rq_res = DPRP_RES_FAIL;
+		rq->rq_err = 1;
+		rq->rq_scnt = 0;
+	    } else {
+		dprp->dprp_scnt = rq->rq_scnt;
+		dprp->dprp_daddr = rq->rq_daddr;
+		dprp->dprp_phyadr = rq->rq_phyadr;
+		d->d_buff = ucp + DPRP_RQSIZ;
+		rq->rq_res = res = rpdocmd(d, cmd);
+		rq->rq_err = dprp->dprp_err;
+		rq->rq_scnt = dprp->dprp_scnt;
+		failed = (res != DPRP_RES_SUCC);
+	    }
+	    dp_xqrnext(dpx);
+	}
+#else
+	res = rpdocmd(d, dp_xrcmd(dpx));
 
-	/* Process command from 10! */
-	switch (cmd = dp_xrcmd(dpx)) {
+	/* Command done, return result and tell 10 we're done */
+	dp_xrdoack(dpx, res);
+#endif
+    }
+}
 
-	default:
-	    fprintf(stderr, "[dprpxx: Unknown cmd %o]\r\n", dp_xrcmd(dpx));
-	    res = DPRP_RES_FAIL;
-	    break;
+/* RPDOCMD - Carry out one command from the 10, using the I/O vars in
+**	shared memory and data in d_buff.  Returns result code.
+*/
+int rpdocmd(register struct devdk *d, int cmd)
+{
+    register unsigned char *buff = d->d_buff;
+    int res;
+
+    /* Reset some stuff for every command */
+    d->d_rp->dprp_err = 0;
+    res = DPRP_RES_SUCC;		/* Default is successful op */
+
+    /* Process command from 10! */
+    switch (cmd) {
+
+    default:
+	fprintf(stderr, "[dprpxx: Unknown cmd %o]\r\n", cmd);
+	res = DPRP_RES_FAIL;
+	break;
 
-	case DPRP_RESET:	/* Reset DP */
-	    /* Attempt to do complete reset */
-	    fprintf(stderr, "[dprpxx: Reset request]\r\n");
+    case DPRP_RESET:	/* Reset DP */
+	/* Attempt to do complete reset */
+	fprintf(stderr, "[dprpxx: Reset request]\r\n");
 #if 0
-	    dprp_restart(2);
+	dprp_restart(2);
 #endif
-	    break;
+	break;
 
-	case DPRP_MOUNT:	/* Mount disk specified by string of N bytes */
-	  {
-	    unsigned char *tmpbuf = buff+1;
-	    int wrtf;
+    case DPRP_MOUNT:	/* Mount disk specified by string of N bytes */
+      {
+	unsigned char *tmpbuf = buff+1;
+	int wrtf;
 
-	    dprpclear(d);
-	    switch (buff[0]) {		/* Check first char */
-	    case 'R':	wrtf = FALSE;	break;
-	    case '*':
-	    case 'W':	wrtf = TRUE;	break;
-	    default:
-		fprintf(stderr, "[dprpxx: Unknown mount type \'%c\']\r\n",
-					buff[0]);
-		res = DPRP_RES_FAIL;
-		break;
-	    }
-	    if (res != DPRP_RES_FAIL) {
-		if (!devmount(d, (char *)tmpbuf, wrtf)) {
-		    res = DPRP_RES_FAIL;
-		}
-	    }
-	  }
-	    break;
-
-	case DPRP_SEEK:
-	case DPRP_NOP:		/* No operation */
+	dprpclear(d);
+	switch (buff[0]) {		/* Check first char */
+	case 'R':	wrtf = FALSE;	break;
+	case '*':
+	case 'W':	wrtf = TRUE;	break;
+	default:
+	    fprintf(stderr, "[dprpxx: Unknown mount type \'%c\']\r\n",
+				    buff[0]);
+	    res = DPRP_RES_FAIL;
 	    break;
-
-	case DPRP_UNL:		/* Unload??  (Eject?)  */
-	    if (!devclose(d)) {		/* Same as close for now */
+	}
+	if (res != DPRP_RES_FAIL) {
+	    if (!devmount(d, (char *)tmpbuf, wrtf)) {
 		res = DPRP_RES_FAIL;
 	    }
-	    break;
+	}
+      }
+	break;
 
-	case DPRP_WRITE:	/* Write N words */
-	    rcnt = dp_xrcnt(dpx);		/* Get length to write */
-	    if (!devwrite(d)) {
-		/* Handle write error of some kind */
-		res = DPRP_RES_FAIL;
-	    }
-	    break;
+    case DPRP_SEEK:
+    case DPRP_NOP:		/* No operation */
+	break;
 
-	case DPRP_READ:		/* Read N words */
-	    if (!devread(d)) {
-		/* Handle read error of some kind? */
-		res = DPRP_RES_FAIL;
-	    }
-	    break;
+    case DPRP_UNL:		/* Unload??  (Eject?)  */
+	if (!devclose(d)) {		/* Same as close for now */
+	    res = DPRP_RES_FAIL;
+	}
+	break;
 
-	case DPRP_WRDMA:	/* Write N sectors into mem */
-	    if (!dmawrite(d)) {
-		/* Handle write error of some kind */
-		res = DPRP_RES_FAIL;
-	    }
-	    break;
+    case DPRP_WRITE:	/* Write N words */
+	if (!devwrite(d)) {
+	    /* Handle write error of some kind */
+	    res = DPRP_RES_FAIL;
+	}
+	break;
 
-	case DPRP_RDDMA:	/* Read N sectors into mem */
-	    if (!dmaread(d)) {
-		/* Handle read error of some kind? */
-		res = DPRP_RES_FAIL;
-	    }
-	    break;
+    case DPRP_READ:		/* Read N words */
+	if (!devread(d)) {
+	    /* Handle read error of some kind? */
+	    res = DPRP_RES_FAIL;
+	}
+	break;
 
+    case DPRP_WRDMA:	/* Write N sectors into mem */
+	if (!dmawrite(d)) {
+	    /* Handle write error of some kind */
+	    res = DPRP_RES_FAIL;
 	}
-#if 0
-	dprpstat(d);		/* Update most status vars */
-#endif
+	break;
+
+    case DPRP_RDDMA:	/* Read N sectors into mem */
+	if (!dmaread(d)) {
+	    /* Handle read error of some kind? */
+	    res = DPRP_RES_FAIL;
+	}
+	break;
 
-	/* Command done, return result and tell 10 we're done */
-	dp_xrdoack(dpx, res);
     }
+#if 0
+    dprpstat(d);		/* Update most status vars */
+#endif
+    return res;
 }
 
 #if 0
@@ -519,6 +561,7 @@ int devmount(register struct devdk *d, char *opath, int wrtf)
     d->d_vdk.dk_ntrks = dprp->dprp_ntrk;
     d->d_vdk.dk_nsecs = dprp->dprp_nsec;
     d->d_vdk.dk_nwds = dprp->dprp_nwds;
+    d->d_vdk.dk_ovpath = dprp->dprp_ovpath[0] ? dprp->dprp_ovpath : NULL;
     if (!vdk_mount(&d->d_vdk, path, wrtf)) {
 	fprintf(stderr, "[dprpxx: Cannot mount device \"%s\": %s]\r\n", 
 			    path, dp_strerror(d->d_vdk.dk_err));
@@ -36,6 +36,12 @@
 #ifndef DPRP_NSECS_MAX		/* Max # sectors for single I/O operation */
 # define DPRP_NSECS_MAX 4	/* 4*128 = 512 wds */
 #endif
+#ifndef DPRP_MAXPATH		/* Length of overlay pathname */
+# define DPRP_MAXPATH 63	/* Same as DVRP_MAXPATH */
+#endif
+#ifndef DPRP_QMAX		/* Max # requests 10 queues at once */
+# define DPRP_QMAX 8		/* (if KLH10_DP_RING) */
+#endif
 
 /* DPRPXX-specific stuff */
 
@@ -64,6 +70,7 @@ struct dprpxx_s {
     int dprp_nsec;
     int dprp_nwds;
     char dprp_devname[16];
+    char dprp_ovpath[DPRP_MAXPATH+1];	/* Overlay file, "" if none */
 
     /* Disk status - set by DP.  Not really used. */
     int dprp_mol;
@@ -73,6 +80,21 @@ struct dprpxx_s {
 #define DPRP_RES_FAIL 0
 #define DPRP_RES_SUCC 1
 
+/* Request slot, used instead of the dprp_ I/O vars when the 10-to-DP
+**	direction is a ring (KLH10_DP_RING).  Any data for the request
+**	follows it in the slot.  A batch of requests is sent together;
+**	a chained request is not done if an earlier one in its batch failed.
+*/
+struct dprp_rq {
+    int rq_chain;		/* TRUE if part of batch with previous req */
+    int rq_res;			/* Operation result */
+    int rq_err;			/* Non-zero if error */
+    uint32 rq_phyadr;		/* Memory word address for DMA */
+    unsigned long rq_scnt;	/* # sectors to xfer, then # xferred */
+    unsigned long rq_daddr;	/* Disk address as # sectors */
+};
+#define DPRP_RQSIZ ((sizeof(struct dprp_rq)+7) & ~7)	/* Offset of data */
+
 
 /* Commands to and from DP and KLH10 RPXX driver */
 
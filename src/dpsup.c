@@ -56,6 +56,11 @@ static int decosfcclossage;
 # include <sys/wait.h>
 # include <sys/mman.h>
 # include <unistd.h>
+# if KLH10_DP_MSEM
+#  include <stdint.h>
+#  include <poll.h>
+#  include <sys/eventfd.h>
+# endif
 # include <signal.h>
 # if defined(MAXSIG)
 #  define SIGMAX MAXSIG		/* Different wording on Sun */
@@ -71,6 +76,12 @@ static int decosfcclossage;
 #endif
 
 static int dp_cxinit(struct dpc_s *, int, int, int, size_t, size_t);
+#if KLH10_DP_MSEM
+static void dp_xtmsem_close(struct dpx_s *);
+#endif
+#if KLH10_DP_RING
+static void dp_xqbell(struct dpx_s *, int);
+#endif
 
 /* DP_INIT - Called from superior (KLH10) to initialize device subprocess
 **	context and shared memory area.
@@ -137,6 +148,9 @@ int dp_init(register struct dp_s *dp, size_t dpcsiz,
     if (!dp_cxinit(dpc, 1, outtyp, outarg, dpcsiz, outsiz)
       || !dp_cxinit(dpc, 0, intyp, inarg, dpcsiz+outsiz, insiz)) {
 
+#if KLH10_DP_MSEM
+	dp_xtmsem_close(&dpc->dpc_todp);
+#endif
 	shmdt((caddr_t)dpc);		/* Detach attached segment */
 	shmctl(shmid, IPC_RMID, (struct shmid_ds *)NULL);
 	fprintf(stderr, "[dp_init: xinit failed]\r\n");
@@ -144,7 +158,7 @@ int dp_init(register struct dp_s *dp, size_t dpcsiz,
     }
 
     /* Finally init the DP struct itself */
-    dp->dp_type = DP_XT_MSIG;
+    dp->dp_type = outtyp;
     dp->dp_adr = dpc;
     dp->dp_shmid = shmid;
 
@@ -156,23 +170,55 @@ static int dp_cxinit(register struct dpc_s *dpc,
 {
     register struct dpx_s *dx;
 
-    if (type != DP_XT_MSIG)
+    dx = dir ? &dpc->dpc_todp : &dpc->dpc_frdp;
+#if KLH10_DP_MSEM
+    dx->dpx_wakfd = dx->dpx_donfd = -1;
+#endif
+#if KLH10_DP_MSEM || KLH10_DP_RING
+    dx->dpx_wakwat = !dir;		/* Say which ends are the 10's */
+    dx->dpx_donwat = dir;
+    dx->dpx_wakbel = dx->dpx_donbel = FALSE;
+#endif
+
+    switch (type) {
+    case DP_XT_MSIG:
+	break;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	/* The 10's end of each bell is watched by a thread of its own and
+	** so doesn't block; the subproc's end is slept on.  Both must
+	** survive the exec in dp_start.
+	*/
+	dx->dpx_wakfd = eventfd(0, dx->dpx_wakwat ? EFD_NONBLOCK : 0);
+	dx->dpx_donfd = eventfd(0, dx->dpx_donwat ? EFD_NONBLOCK : 0);
+	if (dx->dpx_wakfd < 0 || dx->dpx_donfd < 0) {
+	    fprintf(stderr, "[dp_init: eventfd failed - %s]\r\n",
+				dp_strerror(-1));
+	    dp_xtmsem_close(dx);
+	    return FALSE;
+	}
+	break;
+#endif
+    default:
 	return FALSE;			/* Unknown xfer type */
+    }
 
     /* Arg is signal # to use for this direction */
-    if (arg <= 0 || SIGMAX <= arg)
+    if (arg <= 0 || SIGMAX <= arg) {
+#if KLH10_DP_MSEM
+	dp_xtmsem_close(dx);
+#endif
 	return FALSE;			/* Bad signal # */
+    }
 
-    if (dir) {
-	dx = &dpc->dpc_todp;	/* Output to DP */
+    if (dir) {			/* Output to DP */
 	dx->dpx_dontyp = type;
 	dx->dpx_donflg = 0;
 	dx->dpx_donsig = arg;		/* Say how to ack sender (10) */
 	dx->dpx_donpid = getpid();
 	dx->dpx_sbuf = (unsigned char *)dpc + off;
 
-    } else {
-	dx = &dpc->dpc_frdp;	/* Input from DP */
+    } else {			/* Input from DP */
 	dx->dpx_waktyp = type;
 	dx->dpx_wakflg = 0;
 	dx->dpx_waksig = arg;		/* Say how to wakeup rcpt (10) */
@@ -273,7 +319,11 @@ int dp_term(register struct dp_s *dp, int timeout)
     dp_stop(dp, timeout);	/* Stop, kill subproc */
 
     /* Try to kill shared mem segment */
-    if (dp->dp_type == DP_XT_MSIG) {
+    if (dp->dp_type == DP_XT_MSIG || dp->dp_type == DP_XT_MSEM) {
+#if KLH10_DP_MSEM
+	dp_xtmsem_close(&dp->dp_adr->dpc_todp);
+	dp_xtmsem_close(&dp->dp_adr->dpc_frdp);
+#endif
 	shmdt((caddr_t)(dp->dp_adr));		/* Detach attached segment */
 	shmctl(dp->dp_shmid, IPC_RMID,		/* then try to flush it */
 			(struct shmid_ds *)NULL);
@@ -310,6 +360,7 @@ int dp_stop(register struct dp_s *dp, int timeout)
 
     switch (dp->dp_type) {
     case DP_XT_MSIG:
+    case DP_XT_MSEM:
 	if ((pid = dp->dp_chpid)) {
 	    (void) dp_killchild(pid, timeout);
 
@@ -413,7 +464,7 @@ int dp_main(register struct dp_s *dp, int argc, char **argv)
     }
 
     /* Hurray, we're winning... set up our stuff */
-    dp->dp_type = DP_XT_MSIG;	/* Should set this differently later */
+    dp->dp_type = dpc->dpc_todp.dpx_type;	/* Whatever superior chose */
     dp->dp_adr = dpc;
     dp->dp_shmid = shmarg;
 
@@ -518,8 +569,13 @@ static void dp_subsighan(int junk)
 
 int dp_xstest(register struct dpx_s *dx)	/* TRUE if can send */
 {
+#if KLH10_DP_RING
+    if (dx->dpx_qsiz)			/* Ring: TRUE if rcvr took all */
+	return dx->dpx_qout == dx->dpx_qin;
+#endif
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
+    case DP_XT_MSEM:
 	return dp_xtmsig_stest(dx);
     }
     return FALSE;
@@ -527,20 +583,44 @@ int dp_xstest(register struct dpx_s *dx)	/* TRUE if can send */
 
 void dp_xsblock(register struct dpx_s *dx)	/* Block for a later test */
 {
+#if KLH10_DP_RING
+    if (dx->dpx_qsiz) {
+	dp_xqbell(dx, TRUE);
+	return;
+    }
+#endif
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
 	dp_xtmsig_sblock(dx);
 	return;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	dp_xtmsem_sblock(dx);
+	return;
+#endif
     }
     return;
 }
 
 int dp_xswait(register struct dpx_s *dx)	/* Wait until can send */
 {
+#if KLH10_DP_RING
+    if (dx->dpx_qsiz) {
+	while (!dp_xstest(dx))
+	    dp_xqbell(dx, TRUE);
+	return TRUE;
+    }
+#endif
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
 	dp_xtmsig_swait(dx);
 	return TRUE;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	while (!dp_xtmsig_stest(dx))
+	    dp_xtmsem_sblock(dx);
+	return TRUE;
+#endif
     }
     return FALSE;
 }
@@ -551,6 +631,7 @@ unsigned char *dp_xsbuff(register struct dpx_s *dx,
 {
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
+    case DP_XT_MSEM:
 	return dp_xtmsig_sbuff(dx, asiz);
     }
     if (asiz)
@@ -564,6 +645,11 @@ void dp_xswake(register struct dpx_s *dx)	/* Send; say message ready */
     case DP_XT_MSIG:
 	dp_xtmsig_swake(dx);
 	return;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	dp_xtmsem_swake(dx);
+	return;
+#endif
     }
 }
 
@@ -574,14 +660,24 @@ void dp_xsend(register struct dpx_s *dx,
     case DP_XT_MSIG:
 	dp_xtmsig_send(dx, cmd, cnt);
 	return;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	dp_xtmsem_send(dx, cmd, cnt);
+	return;
+#endif
     }
 }
 
 
 int dp_xrtest(register struct dpx_s *dx)	/* TRUE if can receive */
 {
+#if KLH10_DP_RING
+    if (dx->dpx_qsiz)
+	return dp_xqrbuff(dx, (int *)NULL, (size_t *)NULL) != NULL;
+#endif
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
+    case DP_XT_MSEM:
 	return dp_xtmsig_rtest(dx);
     }
     return FALSE;
@@ -589,10 +685,21 @@ int dp_xrtest(register struct dpx_s *dx)	/* TRUE if can receive */
 
 void dp_xrblock(register struct dpx_s *dx)	/* Block for a later test */
 {
+#if KLH10_DP_RING
+    if (dx->dpx_qsiz) {
+	dp_xqbell(dx, FALSE);
+	return;
+    }
+#endif
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
 	dp_xtmsig_rblock(dx);
 	return;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	dp_xtmsem_rblock(dx);
+	return;
+#endif
     }
     return;
 }
@@ -600,10 +707,23 @@ void dp_xrblock(register struct dpx_s *dx)	/* Block for a later test */
 
 int dp_xrwait(register struct dpx_s *dx) /* Wait until can definitely recv */
 {
+#if KLH10_DP_RING
+    if (dx->dpx_qsiz) {
+	while (!dp_xrtest(dx))
+	    dp_xqbell(dx, FALSE);
+	return TRUE;
+    }
+#endif
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
 	dp_xtmsig_rwait(dx);
 	return TRUE;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	while (!dp_xtmsig_rtest(dx))
+	    dp_xtmsem_rblock(dx);
+	return TRUE;
+#endif
     }
     return FALSE;
 }
@@ -614,6 +734,7 @@ unsigned char *dp_xrbuff(register struct dpx_s *dx,
 {
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
+    case DP_XT_MSEM:
 	return dp_xtmsig_rbuff(dx, asiz);
     }
     if (asiz)
@@ -627,6 +748,11 @@ void dp_xrdone(register struct dpx_s *dx)	/* Done, ready for next msg */
     case DP_XT_MSIG:
 	dp_xtmsig_rdone(dx);
 	return;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	dp_xtmsem_rdone(dx);
+	return;
+#endif
     }
 }
 
@@ -637,6 +763,11 @@ void dp_xrdoack(register struct dpx_s *dx,	/* Done, ready for next msg */
     case DP_XT_MSIG:
 	dp_xtmsig_rdoack(dx, res);
 	return;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	dp_xtmsem_rdoack(dx, res);
+	return;
+#endif
     }
 }
 
@@ -644,6 +775,7 @@ int dp_xrcmd(register struct dpx_s *dx)		/* Get command */
 {
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
+    case DP_XT_MSEM:
 	return dp_xtmsig_rcmd(dx);
     }
     return 0;
@@ -653,11 +785,310 @@ size_t dp_xrcnt(register struct dpx_s *dx)	/* Get data count */
 {
     switch (dx->dpx_type) {
     case DP_XT_MSIG:
+    case DP_XT_MSEM:
 	return dp_xtmsig_rcnt(dx);
     }
     return 0;
 }
 
+#if KLH10_DP_MSEM || KLH10_DP_RING
+# ifndef DP_XT_SPIN
+#  define DP_XT_SPIN 2000	/* # flag tests before sleeping */
+# endif
+
+/* Spinning only pays if the other side can run meanwhile; with a
+** single CPU it just puts off the sleep that lets it.
+*/
+static int dp_xtspin = -1;
+# define DP_XTSPIN() (dp_xtspin >= 0 ? dp_xtspin : dp_xtspinit())
+
+static int dp_xtspinit(void)
+{
+    return dp_xtspin = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? DP_XT_SPIN : 0;
+}
+#endif
+
+#if KLH10_DP_MSEM
+
+/* Doorbells for DP_XT_MSEM.
+**	A subproc about to wait spins on the flag for a little while first,
+**	since replies from the other side often come back within a few
+**	usec, and only then raises its "bel" flag and sleeps reading the
+**	eventfd.  A stale ring just makes the caller test again.
+**	The 10 never sleeps on a bell, since its thread reads them all;
+**	the rare 10-side wait (such as for a reply to QUIT) just naps.
+*/
+int dp_xtmsem_ring(int fd)
+{
+    uint64_t one = 1;
+
+    return (int)write(fd, (char *)&one, sizeof(one));
+}
+
+void dp_xtmsem_sblock(register struct dpx_s *dx)
+{
+    register int n;
+    uint64_t cnt;
+
+    if (dx->dpx_donwat) {
+	(void) poll((struct pollfd *)NULL, 0, 1);	/* Nap 1ms */
+	return;
+    }
+    for (n = DP_XTSPIN(); --n >= 0; )
+	if (dx->dpx_rdyf == 0)
+	    return;
+    dx->dpx_donbel = TRUE;
+    DP_XT_FENCE();
+    if (dx->dpx_rdyf != 0)
+	(void) read(dx->dpx_donfd, (char *)&cnt, sizeof(cnt));
+    dx->dpx_donbel = FALSE;
+}
+
+void dp_xtmsem_rblock(register struct dpx_s *dx)
+{
+    register int n;
+    uint64_t cnt;
+
+    if (dx->dpx_wakwat) {
+	(void) poll((struct pollfd *)NULL, 0, 1);	/* Nap 1ms */
+	return;
+    }
+    for (n = DP_XTSPIN(); --n >= 0; )
+	if (dx->dpx_rdyf != 0)
+	    return;
+    dx->dpx_wakbel = TRUE;
+    DP_XT_FENCE();
+    if (dx->dpx_rdyf == 0)
+	(void) read(dx->dpx_wakfd, (char *)&cnt, sizeof(cnt));
+    dx->dpx_wakbel = FALSE;
+}
+
+static void dp_xtmsem_close(register struct dpx_s *dx)
+{
+    if (dx->dpx_wakfd >= 0)
+	close(dx->dpx_wakfd);
+    if (dx->dpx_donfd >= 0)
+	close(dx->dpx_donfd);
+    dx->dpx_wakfd = dx->dpx_donfd = -1;
+}
+
+#endif /* KLH10_DP_MSEM */
+
+#if KLH10_DP_RING
+
+/* Rings.
+**	The sender's "put" and receiver's "get" counts run ahead of the
+**	shared "in" and "out" counts, so a batch of slots costs one update
+**	of the shared count and at most one ring of the doorbell.  Counts
+**	never wrap back; a position in the ring is a count mod its size.
+**	Since an empty ring may be positioned anywhere, it must be able to
+**	hold two maximum-size slots so one always fits after a wrap.
+*/
+
+static void dp_xqring(struct dpx_s *, int);
+static void dp_xqsleep(struct dpx_s *, int);
+
+int dp_xqinit(register struct dpx_s *dx, size_t max)
+{
+    register size_t siz = dx->dpx_len & ~(size_t)15;
+
+    if (siz < 2 * DP_XQ_SLOT(max))
+	return FALSE;
+    dx->dpx_qin = dx->dpx_qout = dx->dpx_qput = dx->dpx_qget = 0;
+    dx->dpx_qsiz = siz;
+    return TRUE;
+}
+
+unsigned char *
+dp_xqsbuff(register struct dpx_s *dx, size_t cnt)
+{
+    register size_t slot = DP_XQ_SLOT(cnt);
+    register size_t pos, end, room;
+
+    room = dx->dpx_qsiz - (dx->dpx_qput - dx->dpx_qout);
+    DP_XT_FENCE();			/* Rcvr done before space reused */
+    pos = dx->dpx_qput % dx->dpx_qsiz;
+    end = dx->dpx_qsiz - pos;		/* Room left before end of ring */
+    if (slot > end) {			/* Won't fit there, must wrap */
+	if (room < end + slot)
+	    return NULL;
+	((struct dpq_s *)(dx->dpx_sbuf + pos))->dpq_cmd = DP_XQ_WRAP;
+	dx->dpx_qput += end;
+	pos = 0;
+    } else if (room < slot)
+	return NULL;
+    return dx->dpx_sbuf + pos + DP_XQ_HDR;
+}
+
+unsigned char *
+dp_xqswait(register struct dpx_s *dx, size_t cnt)
+{
+    register unsigned char *ucp;
+    register int n = DP_XTSPIN();
+
+    for (;;) {
+	if ((ucp = dp_xqsbuff(dx, cnt)))
+	    return ucp;
+	if (dx->dpx_type == DP_XT_MSEM && --n > 0)
+	    continue;			/* Spin a while before sleeping */
+	dx->dpx_donbel = TRUE;		/* Ask rcvr to ring when it frees */
+	DP_XT_FENCE();			/* some space, then look again */
+	if (!(ucp = dp_xqsbuff(dx, cnt)))
+	    dp_xqsleep(dx, TRUE);
+	dx->dpx_donbel = FALSE;
+	if (ucp)
+	    return ucp;
+    }
+}
+
+void dp_xqsput(register struct dpx_s *dx, int cmd, size_t cnt)
+{
+    register struct dpq_s *q;
+
+    q = (struct dpq_s *)(dx->dpx_sbuf + dx->dpx_qput % dx->dpx_qsiz);
+    q->dpq_cmd = cmd;
+    q->dpq_cnt = cnt;
+    dx->dpx_qput += DP_XQ_SLOT(cnt);
+}
+
+void dp_xqsend(register struct dpx_s *dx)
+{
+    register size_t was = dx->dpx_qin;
+
+    if (dx->dpx_qput == was)
+	return;				/* Nothing new to send */
+    DP_XT_FENCE();			/* Slots seen before the count */
+    dx->dpx_qin = dx->dpx_qput;
+    DP_XT_FENCE();			/* and count before rcvr's state */
+    if (dx->dpx_qout == was		/* If rcvr had taken everything */
+      && (dx->dpx_wakwat || dx->dpx_wakbel))	/* and may be waiting */
+	dp_xqring(dx, TRUE);
+}
+
+unsigned char *
+dp_xqrbuff(register struct dpx_s *dx, int *acmd, size_t *acnt)
+{
+    register struct dpq_s *q;
+
+    for (;;) {
+	if (dx->dpx_qget == dx->dpx_qin) {
+	    /* Seems empty.  Give back everything taken, then look
+	    ** again, so a sender that missed seeing that will be seen.
+	    */
+	    dp_xqrdone(dx);
+	    DP_XT_FENCE();
+	    if (dx->dpx_qget == dx->dpx_qin)
+		return NULL;
+	}
+	DP_XT_FENCE();			/* Count seen before the slot */
+	q = (struct dpq_s *)(dx->dpx_rbuf + dx->dpx_qget % dx->dpx_qsiz);
+	if (q->dpq_cmd != DP_XQ_WRAP)
+	    break;
+	dx->dpx_qget += dx->dpx_qsiz - (dx->dpx_qget % dx->dpx_qsiz);
+    }
+    if (acmd)
+	*acmd = q->dpq_cmd;
+    if (acnt)
+	*acnt = q->dpq_cnt;
+    return (unsigned char *)q + DP_XQ_HDR;
+}
+
+void dp_xqrnext(register struct dpx_s *dx)
+{
+    register struct dpq_s *q;
+
+    q = (struct dpq_s *)(dx->dpx_rbuf + dx->dpx_qget % dx->dpx_qsiz);
+    dx->dpx_qget += DP_XQ_SLOT(q->dpq_cnt);
+}
+
+void dp_xqrdone(register struct dpx_s *dx)
+{
+    if (dx->dpx_qout == dx->dpx_qget)
+	return;				/* Nothing new taken */
+    DP_XT_FENCE();			/* Done with slots before saying so */
+    dx->dpx_qout = dx->dpx_qget;
+    DP_XT_FENCE();
+    if (dx->dpx_donwat || dx->dpx_donbel)	/* 10 or waiting sender */
+	dp_xqring(dx, FALSE);
+}
+
+/* DP_XQRING - Ring the receiver (wake) or sender (done) of a ring,
+**	setting the same flag the single-message calls do, which is what
+**	the 10's event handling checks.
+*/
+static void dp_xqring(register struct dpx_s *dx, int wake)
+{
+    switch (dx->dpx_type) {
+    case DP_XT_MSIG:
+	if (wake) {
+	    dx->dpx_wakflg = 1;
+	    kill(dx->dpx_wakpid, dx->dpx_waksig);
+	} else {
+	    dx->dpx_donflg = 1;
+	    kill(dx->dpx_donpid, dx->dpx_donsig);
+	}
+	break;
+#if KLH10_DP_MSEM
+    case DP_XT_MSEM:
+	if (wake) {
+	    dx->dpx_wakflg = 1;
+	    (void) dp_xtmsem_ring(dx->dpx_wakfd);
+	} else {
+	    dx->dpx_donflg = 1;
+	    (void) dp_xtmsem_ring(dx->dpx_donfd);
+	}
+	break;
+#endif
+    }
+}
+
+/* DP_XQBELL - Wait for the receiver of a ring to take everything (snd)
+**	or for the sender to send something, after saying we want to be
+**	rung.  Callers test again, so an early return does no harm.
+*/
+static void dp_xqbell(register struct dpx_s *dx, int snd)
+{
+    register int n;
+
+    if (dx->dpx_type == DP_XT_MSEM)
+	for (n = DP_XTSPIN(); --n >= 0; )
+	    if (snd ? (dx->dpx_qout == dx->dpx_qin)
+		    : (dx->dpx_qget != dx->dpx_qin))
+		return;
+    if (snd) {
+	dx->dpx_donbel = TRUE;
+	DP_XT_FENCE();
+	if (dx->dpx_qout != dx->dpx_qin)
+	    dp_xqsleep(dx, TRUE);
+	dx->dpx_donbel = FALSE;
+    } else {
+	dx->dpx_wakbel = TRUE;
+	DP_XT_FENCE();
+	if (dx->dpx_qget == dx->dpx_qin)
+	    dp_xqsleep(dx, FALSE);
+	dx->dpx_wakbel = FALSE;
+    }
+}
+
+static void dp_xqsleep(register struct dpx_s *dx, int snd)
+{
+#if KLH10_DP_MSEM
+    uint64_t cnt;
+
+    if (dx->dpx_type == DP_XT_MSEM) {
+	if (snd ? dx->dpx_donwat : dx->dpx_wakwat)
+	    (void) poll((struct pollfd *)NULL, 0, 1);	/* The 10 naps */
+	else
+	    (void) read((snd ? dx->dpx_donfd : dx->dpx_wakfd),
+			(char *)&cnt, sizeof(cnt));
+	return;
+    }
+#endif
+    dp_sigwait();
+}
+
+#endif /* KLH10_DP_RING */
+
 /* Same as os_strerror() from osdsup.c, put here to avoid having to
 ** grab the entire OSDSUP package when being built for DP procs.
 */
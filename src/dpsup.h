@@ -70,7 +70,11 @@ any of:
 	Output always blocks; input is polled.
 	DP reset done directly.
 
-Only one mechanism (DP_XT_MSIG) is actually implemented at present.
+Only mechanism (1) is implemented at present, with either of two
+doorbells: DP_XT_MSIG (signals) always, or DP_XT_MSEM (Linux eventfds)
+when built with KLH10_DP_MSEM.  With MSEM the 10 is rung by a thread of
+its own that sets the device's event flag, so nothing interrupts the
+main thread, and a sleeping subproc is only rung if it asked to be.
 
 */
 
@@ -94,6 +98,15 @@ To receive a message:
 		Result value and clears Ready.
 	Receiver signals sender.
 
+	When built with KLH10_DP_RING, a device may instead make either
+direction a ring (see dp_xqinit), which carries any number of messages
+at once in variable-length slots.  Only the sender moves the "in" index
+and only the receiver moves the "out" index, so no locking is needed.
+Either side rings the other only if that side may be idle: the sender
+when the receiver had caught up, the receiver when the sender is waiting
+for room or is the 10.  Don't mix ring and single-message calls on the
+same direction.
+
 
 Should regions be arranged so each is R/W for sender, and RO for receiver?
 Can distribute variables appropriately.  Prevents wild subproc from
@@ -118,6 +131,12 @@ For now, keep everything in one mutually R/W region for simplicity.
 #define DP_XT_MSEM 2	/* Shared mem, use semaphore for doorbell */
 #define DP_XT_THCV 3	/* Same mem, use thread condition var */
 
+#if KLH10_DP_MSEM	/* What NI20 and RPxx ask dp_init for */
+# define DP_XT_BELL DP_XT_MSEM
+#else
+# define DP_XT_BELL DP_XT_MSIG
+#endif
+
 #if 0
 union dpcxmech {
     struct dpc_xt_msig {
@@ -154,8 +173,25 @@ struct dpx_s {
     sigset_t dpx_donmsk;	/* C: Mask for signal # */
     int dpx_donpid;
     unsigned char *dpx_sbuf;	/* S: S's ptr into same buffer */
+
+# if KLH10_DP_MSEM
+    int dpx_wakfd;		/* C: MSEM eventfd to wake rcpt, else -1 */
+    int dpx_donfd;		/* C: MSEM eventfd to ack sender, else -1 */
+# endif
+# if KLH10_DP_MSEM || KLH10_DP_RING
+    int dpx_wakwat;		/* C: TRUE if the 10 is the rcpt */
+    volatile int dpx_wakbel;	/* R: TRUE while rcpt sleeps for a wake */
+    int dpx_donwat;		/* C: TRUE if the 10 is the sender */
+    volatile int dpx_donbel;	/* S: TRUE while sender sleeps for an ack */
+# endif
 #endif
 
+    size_t dpx_qsiz;		/* C: Ring size in bytes, 0 if not a ring */
+    volatile size_t dpx_qin;	/* S: Bytes ever put into ring */
+    volatile size_t dpx_qout;	/* R: Bytes ever taken out of ring */
+    size_t dpx_qput;		/* S: Bytes put, including ones not yet sent */
+    size_t dpx_qget;		/* R: Bytes taken, including ones not done */
+
     size_t dpx_len;		/* C: Buffer length */
     size_t dpx_off;		/* C: Buffer offset from beg of segment */
     volatile
@@ -202,7 +238,7 @@ struct dpc_s {
 #define DPC_GV_MIN(a) (((a)>>5)&037)
 #define DPC_GV_PAT(a) (((a)>>0)&037)
 
-#define DPSUP_VERSION DPC_VERSION(1,2,0)	/* This version of DPSUP */
+#define DPSUP_VERSION DPC_VERSION(1,4,0)	/* This version of DPSUP */
 
 #define DPCF_MEMLOCK	0x1	/* M wants DP to lock its mem if possible */
 
@@ -291,6 +327,79 @@ void dp_sleep(int);			/* Sleep for N seconds */
 #define dp_xtmsig_rcmd(dpx) ((dpx)->dpx_cmd)
 #define dp_xtmsig_rcnt(dpx) ((dpx)->dpx_cnt)
 
+/* Facilities for DPCXT_MSEM
+**	Same flag protocol as MSIG.  A doorbell is rung (a write to the
+**	eventfd) only if the other side is a 10 thread, which always
+**	waits on it, or is a subproc that has said it is going to sleep.
+**	Each side sets its own flag and then looks at the other's, with a
+**	full barrier in between, so one of them always sees the other.
+*/
+#if KLH10_DP_MSEM || KLH10_DP_RING
+# define DP_XT_FENCE() __sync_synchronize()
+#endif
+
+#if KLH10_DP_MSEM
+
+#define dp_xtmsem_swake(dpx) (((dpx)->dpx_rdyf = 1),	\
+			((dpx)->dpx_wakflg = 1), DP_XT_FENCE(),	\
+			(((dpx)->dpx_wakwat || (dpx)->dpx_wakbel)	\
+			  ? dp_xtmsem_ring((dpx)->dpx_wakfd) : 0))
+#define dp_xtmsem_send(dpx, cmd, cnt) \
+	((dpx)->dpx_cmd = (cmd), (dpx)->dpx_cnt = (cnt), dp_xtmsem_swake(dpx))
+#define dp_xtmsem_rdone(dpx) (((dpx)->dpx_rdyf = 0),	\
+			((dpx)->dpx_donflg = 1), DP_XT_FENCE(),	\
+			(((dpx)->dpx_donwat || (dpx)->dpx_donbel)	\
+			  ? dp_xtmsem_ring((dpx)->dpx_donfd) : 0))
+#define dp_xtmsem_rdoack(dpx, res) ((dpx)->dpx_res = (res), \
+			dp_xtmsem_rdone(dpx))
+
+int  dp_xtmsem_ring(int);		/* Ring doorbell */
+void dp_xtmsem_sblock(dpx_t *);		/* Sender sleeps for a later test */
+void dp_xtmsem_rblock(dpx_t *);		/* Rcvr sleeps for a later test */
+
+#endif /* KLH10_DP_MSEM */
+
+/* Facilities for rings (KLH10_DP_RING)
+**	Each slot starts with a header giving its command and data count;
+**	the data follows, and the whole slot is rounded up so the next
+**	header stays aligned.  A slot that won't fit before the end of the
+**	ring is preceded by a DP_XQ_WRAP header, which the receiver skips.
+**	Sender: get a slot with dp_xqsbuff or dp_xqswait, fill it, dp_xqsput
+**		it, and so on; dp_xqsend then hands the whole batch over.
+**	Receiver: dp_xqrbuff gets the next slot, dp_xqrnext steps past it,
+**		and dp_xqrdone gives everything stepped past back to the
+**		sender.  dp_xqrbuff does the latter itself on finding the
+**		ring empty.
+**	The usual dp_xstest is TRUE once the receiver has taken everything
+**	sent, and dp_xrtest when there's a slot to take, so dp_xswait,
+**	dp_xrwait and device "waiting" checks work as before.
+*/
+struct dpq_s {			/* Ring slot header */
+    int dpq_cmd;		/* Command, or DP_XQ_WRAP */
+    size_t dpq_cnt;		/* # bytes of data */
+};
+
+#define DP_XQ_WRAP (-1)		/* Rest of ring unused, go back to start */
+#define DP_XQ_RND(n) (((n) + 15) & ~(size_t)15)
+#define DP_XQ_HDR DP_XQ_RND(sizeof(struct dpq_s))
+#define DP_XQ_SLOT(cnt) (DP_XQ_HDR + DP_XQ_RND(cnt))	/* Slot size */
+
+#if KLH10_DP_RING
+
+int  dp_xqinit(dpx_t *, size_t);	/* Make dpx a ring, given max slot data */
+unsigned char *
+     dp_xqsbuff(dpx_t *, size_t);	/* Get slot for data, NULL if full */
+unsigned char *
+     dp_xqswait(dpx_t *, size_t);	/* Same, waiting for room if needed */
+void dp_xqsput(dpx_t *, int, size_t);	/* Put slot with cmd & data count */
+void dp_xqsend(dpx_t *);		/* Send all slots put so far */
+unsigned char *
+     dp_xqrbuff(dpx_t *, int *, size_t *); /* Get next slot, NULL if none */
+void dp_xqrnext(dpx_t *);		/* Step past that slot */
+void dp_xqrdone(dpx_t *);		/* Say all slots stepped past done */
+
+#endif /* KLH10_DP_RING */
+
 #if 0
 /* For device to register its dp with 10 via device vector */
 int dpcxt_msig_register(struct dpc_s *dpc, struct device *d);
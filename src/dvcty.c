@@ -41,6 +41,9 @@
 /* Local functions & data */
 #if KLH10_CPU_KS
 static int cty_sin(int cnt);
+# if KLH10_CTYIO_ADDINT
+static int cty_lasttmo(void *junk);
+# endif
 #endif
 
 static struct clkent *ctytmr;	/* For re-check of CTY input */
@@ -84,6 +87,17 @@ cty_init(void)
     fe_ctysig(fe_iosig);	/* Set up TTY input signal handler */
     fe_iosigtest();		/* Trigger initial call */
 #endif
+
+#if KLH10_CPU_KS && KLH10_CTYIO_ADDINT
+    /* Timer for extra output-done int, quiet until cty_timeout wants it.
+    ** Getting it now rather than on first output means it always exists
+    ** for a checkpoint restore to find.
+    */
+    cpu.fe.cty_lastclk = clk_tmrget(cty_lasttmo, (void *)NULL,
+				(int32)(CLK_USECS_PER_SEC/50));
+    clk_tmrquiet(cpu.fe.cty_lastclk);
+    cpu.fe.cty_prevlastint = 0;		/* Force interval set on 1st use */
+#endif
 }
 
 
@@ -237,10 +251,6 @@ fe_intrup(void)
 }
 
 
-# if KLH10_CTYIO_ADDINT
-static int cty_lasttmo(void *junk);
-# endif
-
 /* CTY_TIMEOUT - Gross hack to delay output so that KS T20
 **	can catch up.
 */
@@ -266,22 +276,18 @@ cty_timeout(void)
 	   modifies interval and changes its timer accordingly.
 	*/
 	if (cpu.fe.cty_lastint) {	/* If we want since-last-char timer */
-	    if (!cpu.fe.cty_lastclk)	/* Get it if first time */
-		cpu.fe.cty_lastclk = clk_tmrget(cty_lasttmo, (void *)NULL,
-				(int32)(cpu.fe.cty_lastint * 1000));
-	    else if (cpu.fe.cty_prevlastint != cpu.fe.cty_lastint) {
+	    if (cpu.fe.cty_prevlastint != cpu.fe.cty_lastint) {
 		clk_tmrquiet(cpu.fe.cty_lastclk);	/* Changed interval! */
 		clk_tmrset(cpu.fe.cty_lastclk,
 				(int32)(cpu.fe.cty_lastint * 1000));
+		clk_tmractiv(cpu.fe.cty_lastclk);
 	    } else {
 		clk_tmrquiet(cpu.fe.cty_lastclk);	/* Restart timer */
 		clk_tmractiv(cpu.fe.cty_lastclk);	/* using same interv */
 	    }
 	    cpu.fe.cty_prevlastint = cpu.fe.cty_lastint; /* Remember interval*/
-	} else if (cpu.fe.cty_lastclk) {	/* Don't want, ensure clear */
-	    clk_tmrkill(cpu.fe.cty_lastclk);
-	    cpu.fe.cty_lastclk = NULL;
-	}
+	} else				/* Don't want, ensure quiet */
+	    clk_tmrquiet(cpu.fe.cty_lastclk);
 # endif
     }
     vm_psetxwd(vp, 0, 0);		/* Clear word */
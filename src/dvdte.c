@@ -42,6 +42,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>	/* For malloc/free */
 
 #include "kn10def.h"	/* This includes OSD defs */
 #include "kn10ops.h"
@@ -49,6 +50,9 @@
 #include "dvdte.h"
 #include "prmstr.h"	/* For parameter parsing */
 #include "fecmd.h"
+#if KLH10_CKPT
+# include "kn10ckp.h"
+#endif
 
 #ifdef RCSID
  RCSID(dvdte_c,"$Id: dvdte.c,v 2.7 2002/04/24 07:56:08 klh Exp $")
@@ -175,6 +179,10 @@ struct dte {
     int dt_ctyocnt;		/* # chars room left in buffer */
     char *dt_ctyocp;		/* Deposit pointer */
     char dt_ctyobuf[128];
+
+#if KLH10_CKPT
+    unsigned char *dt_ckbuf;	/* To-10 data of queue restored from ckpt */
+#endif
 };
 
 static int ndtes = 0;
@@ -222,6 +230,10 @@ static void  dt_cono(struct device *d, h10_t erh);
 static w10_t dt_coni(struct device *d);
 static void  dt_datao(struct device *d, w10_t w);
 static w10_t dt_datai(struct device *d);
+#if KLH10_CKPT
+static int   dt_ckpt(struct device *d, struct ckpt_s *ck);
+static int   dt_ckrest(struct device *d, struct ckpt_s *ck, int dorest);
+#endif
 #if 0
 static int   dt_readin();	/* Readin boot, if supported */
 #endif
@@ -398,6 +410,10 @@ struct device * dvdte_create(FILE *f, char *s)
     dt->dt_dv.dv_datai = dt_datai;
 
     dt->dt_dv.dv_init = dt_init;
+#if KLH10_CKPT
+    dt->dt_dv.dv_ckpt = dt_ckpt;
+    dt->dt_dv.dv_ckrest = dt_ckrest;
+#endif
 
     if (!dte_conf(f, s, dt))		/* Do configuration stuff */
 	return NULL;
@@ -442,6 +458,13 @@ static int dt_init(struct device *d, FILE *of)
 	dt->dt_kpal = clk_tmrget(dte_kaltmo, (void *)dt,
 						CLK_USECS_PER_SEC/2);
 
+    /* Set up 60Hz KLDCP clock timer, quiet until the 10 turns it on */
+    if (!dt->dt_clk) {
+	dt->dt_clk = clk_tmrget(dte_clktmo, (void *)dt,
+				CLK_USECS_PER_SEC/60);
+	clk_tmrquiet(dt->dt_clk);
+    }
+
     /* Set up ACK delay timer (mostly useful for T10) */
     if (dt->dt_dlyackms) {
 	dt->dt_dlyack = clk_tmrget(dte_acktmo, (void *)dt,
@@ -1064,15 +1087,9 @@ static void dte_clkset(register struct dte *dt, int on)
 
     if (on) {
 	dt->dt_clkticks = 0;	/* Reset count of ticks */
-	if (dt->dt_clk)		/* Activate timer */
-	    clk_tmractiv(dt->dt_clk);
-	else			/* Gotta get it for 1st time */
-	    dt->dt_clk = clk_tmrget(dte_clktmo, (void *)dt,
-				CLK_USECS_PER_SEC/60);
-    } else {
-	if (dt->dt_clk)
-	    clk_tmrquiet(dt->dt_clk);	/* Make quiescent */
-    }
+	clk_tmractiv(dt->dt_clk);	/* Activate timer */
+    } else
+	clk_tmrquiet(dt->dt_clk);	/* Make quiescent */
 }
 
 /* Handle clock timeout. */
@@ -1944,7 +1961,7 @@ static void dte_wrhd(register struct dte *dt, register struct dteq_s *q)
 static void dte_wrbyte(register struct dte *dt, register struct dteq_s *q, register int cnt)
 {
     register w10_t bp, w;
-    register vmptr_t abp, vp;
+    register vmptr_t abp, vp, vp0;
     register int i;
     register vaddr_t va;
     register uint18 uhw;
@@ -1968,6 +1985,7 @@ static void dte_wrbyte(register struct dte *dt, register struct dteq_s *q, regis
     if (!vp) {
 	panic("DTE: Page fail writing S hdr at %lo", (long)RHGET(bp));
     }
+    vp0 = vp;			/* Only this page was checked by map */
 
     if (!(ucp = q->q_dcp)) {
 	panic("dte_wrbyte: no data ptr");
@@ -2001,6 +2019,7 @@ static void dte_wrbyte(register struct dte *dt, register struct dteq_s *q, regis
     }
     q->q_dcp = ucp;		/* Update queue pkt data ptr */
     vm_pset(vp, w);		/* Store word we're done with */
+    PAG_IOWRITE((paddr_t)(vp0 - cpu.physmem), (long)(vp - vp0) + 1);
 
     /* Now update BP as if written cnt bytes */
     LHSET(bp, bp8lhtab[i]);	/* Set up appropriate LH */
@@ -2365,5 +2384,120 @@ static void dte_ctyforce(register struct dte *dt)
     dt->dt_ctyocp = dt->dt_ctyobuf;
 }
 
+#if KLH10_CKPT
+
+/* Checkpoint/restore.
+**	Saves the DTE struct, then the to-10 queue as a node count
+**	followed by each node and its remaining data bytes.
+**	The restored queue's data is kept in a buffer of its own, since
+**	what it pointed to originally may have been anywhere.
+*/
+static int dt_ckpt(struct device *d, struct ckpt_s *ck)
+{
+    register struct dte *dt = (struct dte *)d;
+    register struct dteq_s *q;
+    int n = 0;
+
+    for (q = dt->dt_sndq; q; q = q->q_next)
+	++n;
+    if (!ckp_put(ck, dt, sizeof(*dt))
+      || !ckp_put(ck, &n, sizeof(n)))
+	return FALSE;
+    for (q = dt->dt_sndq; q; q = q->q_next) {
+	if (!ckp_put(ck, q, sizeof(*q))
+	  || !ckp_put(ck, q->q_dcp, (size_t)(q->q_bbcnt + q->q_wbcnt)))
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+static int dt_ckrest(struct device *d, struct ckpt_s *ck, int dorest)
+{
+    register struct dte *dt = (struct dte *)d;
+    register struct dteq_s *q, *sq;
+    struct dte *s, live;
+    int *np, i, nfree;
+    size_t len = 0;
+    unsigned char *ucp, *buf = NULL;
+
+    if (!(s = (struct dte *)ckp_get(ck, sizeof(*s)))
+      || !(np = (int *)ckp_get(ck, sizeof(*np))))
+	return FALSE;
+    if (s->dt_dten != dt->dt_dten || s->dt_ismaster != dt->dt_ismaster) {
+	fprintf(ckp_outf(ck), "DTE config differs from checkpoint\n");
+	return FALSE;
+    }
+
+    /* Check queue and find its total data size */
+    for (nfree = 0, q = dteqfreep; q; q = q->q_next)
+	++nfree;
+    for (q = dt->dt_sndq; q; q = q->q_next)
+	++nfree;
+    if (*np < 0 || *np > nfree)
+	return FALSE;
+    for (i = *np; --i >= 0; ) {
+	if (!(sq = (struct dteq_s *)ckp_get(ck, sizeof(*sq)))
+	  || sq->q_bbcnt < 0 || sq->q_wbcnt < 0
+	  || !ckp_get(ck, (size_t)(sq->q_bbcnt + sq->q_wbcnt)))
+	    return FALSE;
+	len += sq->q_bbcnt + sq->q_wbcnt;
+    }
+    if (len && !(buf = (unsigned char *)malloc(len)))
+	return FALSE;
+    if (!dorest) {
+	if (buf)
+	    free(buf);
+	return TRUE;
+    }
+
+    /* Free up live queue, then take on saved state */
+    while ((q = dt->dt_sndq)) {
+	dt->dt_sndq = q->q_next;
+	q->q_next = dteqfreep;
+	dteqfreep = q;
+    }
+    live = *dt;
+    *dt = *s;
+    dt->dt_dv = live.dt_dv;
+    dt->dt_dv.dv_pireq = s->dt_dv.dv_pireq;
+    dt->dt_kpal = live.dt_kpal;
+    dt->dt_dlyack = live.dt_dlyack;
+    dt->dt_clk = live.dt_clk;		/* Clock state set by clk_ckprest */
+    dt->dt_eptcb = ckp_vmptr(ck, s->dt_eptcb);
+    dt->dt_eptexa = ckp_vmptr(ck, s->dt_eptexa);
+    dt->dt_eptdep = ckp_vmptr(ck, s->dt_eptdep);
+    dt->dt_ctyocp = dt->dt_ctyobuf
+		+ (sizeof(dt->dt_ctyobuf) - dt->dt_ctyocnt);
+    if (live.dt_ckbuf)
+	free(live.dt_ckbuf);
+    dt->dt_ckbuf = buf;
+
+    /* Rebuild queue.  Re-fetch saved nodes from start of section. */
+    dt->dt_sndq = dt->dt_sndqtail = NULL;
+    ckp_secfind(ck, "DEV", dt->dt_dv.dv_name);
+    (void) ckp_get(ck, sizeof(*s));
+    (void) ckp_get(ck, sizeof(*np));
+    for (ucp = buf, i = *np; --i >= 0; ) {
+	sq = (struct dteq_s *)ckp_get(ck, sizeof(*sq));
+	len = sq->q_bbcnt + sq->q_wbcnt;
+	q = dteqfreep;
+	dteqfreep = q->q_next;
+	*q = *sq;
+	q->q_next = NULL;
+	q->q_dcp = ucp;
+	if (len) {
+	    memcpy((char *)ucp, (char *)ckp_get(ck, len), len);
+	    ucp += len;
+	}
+	if (dt->dt_sndqtail)
+	    dt->dt_sndqtail->q_next = q;
+	else
+	    dt->dt_sndq = q;
+	dt->dt_sndqtail = q;
+    }
+    return TRUE;
+}
+#endif /* KLH10_CKPT */
+
 #endif /* KLH10_DEV_DTE Moby conditional */
 
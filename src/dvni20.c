@@ -57,6 +57,9 @@ static int decosfcclossage;
 #include "dvni20.h"
 #include "cmdline.h"
 #include "prmstr.h"	/* For parameter parsing */
+#if KLH10_CKPT
+# include "kn10ckp.h"
+#endif
 
 #if KLH10_DEV_DPNI20	/* Event handling and dev sub-proc stuff! */
 # include "dpni20.h"
@@ -244,6 +247,10 @@ static int   ni20_cmd(struct device *d, FILE *of, char *cmdline);
 static void  ni20_evhsdon(struct device *d, struct dvevent_s *evp);
 static void  ni20_evhrwak(struct device *d, struct dvevent_s *evp);
 #endif
+#if KLH10_CKPT
+static int   ni20_ckpt(struct device *d, struct ckpt_s *ck);
+static int   ni20_ckrest(struct device *d, struct ckpt_s *ck, int dorest);
+#endif
 
 /* Completely internal functions */
 
@@ -257,6 +264,9 @@ static void ni20_stop(struct ni20 *ni);
 static void ni20_enable(struct ni20 *ni);
 static void ni20_disable(struct ni20 *ni);
 static void ni20_run(struct ni20 *ni);
+#if KLH10_DEV_DPNI20 && KLH10_DP_RING
+static int  ni20_rget(struct ni20 *ni);
+#endif
 static int  ni20_runclk(void *arg);
 static void ni_ethtodw(dw10_t *da, unsigned char *ea);
 static int  ni20_cmdchk(struct ni20 *ni);
@@ -633,6 +643,10 @@ dvni20_create(FILE *f, char *s)
     ni->ni_dv.dv_init = ni20_init;	/* Set up own post-bind init */
     ni->ni_dv.dv_reset = ni20_reset;	/* System reset (clear stuff) */
     ni->ni_dv.dv_powoff = ni20_powoff;	/* Power-off cleanup */
+#if KLH10_CKPT
+    ni->ni_dv.dv_ckpt = ni20_ckpt;	/* Checkpoint/restore */
+    ni->ni_dv.dv_ckrest = ni20_ckrest;
+#endif
 
     ni20_conf_clear(ni);		/* Set all defaults */
     if (!ni20_conf(f, s, ni))		/* Do configuration stuff */
@@ -701,11 +715,23 @@ ni20_init(struct device *d,
 
     ni->ni_dpstate = FALSE;
     if (!dp_init(&ni->ni_dp, sizeof(struct dpni20_s),
-			DP_XT_MSIG, SIGUSR1, (size_t)1600,	/* in */
-			DP_XT_MSIG, SIGUSR1, (size_t)1600)) {	/* out */
+#if KLH10_DP_RING
+			DP_XT_BELL, SIGUSR1,			/* in */
+				DPNI_RQLEN * DP_XQ_SLOT(1600),
+#else
+			DP_XT_BELL, SIGUSR1, (size_t)1600,	/* in */
+#endif
+			DP_XT_BELL, SIGUSR1, (size_t)1600)) {	/* out */
 	if (of) fprintf(of, "NI20 subproc init failed!\n");
 	return FALSE;
     }
+#if KLH10_DP_RING
+    /* Input is queued; ni_rbuf is set to each packet as it's taken */
+    if (!dp_xqinit(&(ni->ni_dp.dp_adr->dpc_frdp), (size_t)1600)) {
+	if (of) fprintf(of, "NI20 input ring init failed!\n");
+	return FALSE;
+    }
+#endif
     ni->ni_sbuf = dp_xsbuff(&(ni->ni_dp.dp_adr->dpc_todp), &junk);
     ni->ni_rbuf = dp_xrbuff(&(ni->ni_dp.dp_adr->dpc_frdp), &junk);
 
@@ -749,16 +775,26 @@ ni20_init(struct device *d,
 
     /* Register ourselves with main KLH10 loop for DP events */
 
+#if KLH10_DP_MSEM
+    ev.dvev_type = DVEV_DPBELL;		/* Event = Device Proc doorbell */
+    ev.dvev_arg.eva_int = ni->ni_dp.dp_adr->dpc_todp.dpx_donfd;
+#else
     ev.dvev_type = DVEV_DPSIG;		/* Event = Device Proc signal */
     ev.dvev_arg.eva_int = SIGUSR1;
+#endif
     ev.dvev_arg2.eva_ip = &(ni->ni_dp.dp_adr->dpc_todp.dpx_donflg);
     if (!(*ni->ni_dv.dv_evreg)((struct device *)ni, ni20_evhsdon, &ev)) {
 	if (of) fprintf(of, "NI20 event reg failed!\n");
 	return FALSE;
     }
 
+#if KLH10_DP_MSEM
+    ev.dvev_type = DVEV_DPBELL;		/* Event = Device Proc doorbell */
+    ev.dvev_arg.eva_int = ni->ni_dp.dp_adr->dpc_frdp.dpx_wakfd;
+#else
     ev.dvev_type = DVEV_DPSIG;		/* Event = Device Proc signal */
     ev.dvev_arg.eva_int = SIGUSR1;
+#endif
     ev.dvev_arg2.eva_ip = &(ni->ni_dp.dp_adr->dpc_frdp.dpx_wakflg);
     if (!(*ni->ni_dv.dv_evreg)((struct device *)ni, ni20_evhrwak, &ev)) {
 	if (of) fprintf(of, "NI20 event reg failed!\n");
@@ -2609,9 +2645,10 @@ nicmd_dgrcv(register struct ni20 *ni,
 	    sln = blen;
 
 	/* Copy the data! */
-	ni_8stows(vm_physmap(MASK22 & w10topa(
-				vm_pget(vm_padd(bdp, NI20_BD_HDR)))),
+	w = vm_pget(vm_padd(bdp, NI20_BD_HDR));
+	ni_8stows(vm_physmap(MASK22 & w10topa(w)),
 		&ucp[ETHER_PX_DAT], sln);
+	PAG_IOWRITE(MASK22 & w10topa(w), (long)((sln + 3) / 4));
     }
 
     /* Queue entry (almost) all done!
@@ -3008,6 +3045,11 @@ ni20_evhrwak(struct device *d,
     if (NIDEBUG(ni))
 	fprintf(NIDBF(ni), "[ni20_evhrwak: %d]", (int)dp_xrtest(dpx));
 
+#if KLH10_DP_RING
+    /* Unless still blocked on a packet, take whatever is queued */
+    if (!ni->ni_pktinf && ni20_rget(ni))
+	ni20_run(ni);			/* Go process it */
+#else
     if (dp_xrtest(dpx)) {	/* Verify there's a message for us */
 	switch (dp_xrcmd(dpx)) {
 	case DPNI_INIT:
@@ -3038,7 +3080,50 @@ ni20_evhrwak(struct device *d,
 	    break;
 	}
     }
+#endif /* !KLH10_DP_RING */
+}
+
+#if KLH10_DP_RING
+
+/* NI20_RGET - Take messages off the DP input ring until a packet turns
+**	up that the NI20 can accept, and set it up as the input packet.
+**	Returns FALSE if the ring ran dry first.
+**	The packet's slot is not freed until ni20_run is done with it.
+*/
+static int
+ni20_rget(register struct ni20 *ni)
+{
+    register struct dpx_s *dpx = &(ni->ni_dp.dp_adr->dpc_frdp);
+    register unsigned char *ucp;
+    int cmd;
+    size_t cnt;
+
+    while ((ucp = dp_xqrbuff(dpx, &cmd, &cnt))) {
+	switch (cmd) {
+	case DPNI_INIT:
+	    ni20_iniable(ni);		/* Do initial disable/enable */
+	    break;
+
+	case DPNI_RPKT:			/* See kludge note above for +4 */
+	    ni->ni_cnts[NI20_RC_BR] += cnt + 4;
+	    ni->ni_cnts[NI20_RC_FR]++;		/* Update # bytes & frames */
+	    if (ni->ni_state == NI20_ST_RUNENA) { /* If running enabled */
+		ni->ni_rbuf = ucp;
+		ni->ni_rcnt = cnt;
+		ni->ni_pktinf = TRUE;
+		return TRUE;
+	    }
+	    /* Else drop through to flush it */
+	default:
+	    if (NIDEBUG(ni))
+		fprintf(NIDBF(ni), "[ni20_rget: R flushed]");
+	    break;
+	}
+	dp_xqrnext(dpx);
+    }
+    return FALSE;
 }
+#endif /* KLH10_DP_RING */
 #endif /* KLH10_DEV_DPNI20 */
 
 /* NI20_RUNCLK - invoked by clock timeout code to "run" the NI20
@@ -3090,7 +3175,13 @@ ni20_run(register struct ni20 *ni)
 		if (NIDEBUG(ni))
 		    fprintf(NIDBF(ni), "[ni20_run: R done]");
 
+# if KLH10_DP_RING
+		/* Free its slot and set up the next packet, if any */
+		dp_xqrnext(&(ni->ni_dp.dp_adr->dpc_frdp));
+		(void) ni20_rget(ni);
+# else
 		dp_xrdone(&(ni->ni_dp.dp_adr->dpc_frdp));
+# endif
 #endif
 	    }
 	    if (res != DGRCV_WONFLS)
@@ -3717,4 +3808,80 @@ dchn_ccwget(register struct dvdchn *dc)
     }
 }
 
+#if KLH10_CKPT
+
+/* Checkpoint/restore.
+**	Only the port registers and the tables cached from the PCB are
+**	restored; the network connection belongs to this process.  A port
+**	that was running comes back halted with an internal-error PC in LAR,
+**	just as if its microcode had crashed, so the monitor reloads it and
+**	rebuilds its queues.  Packets in flight at checkpoint time are lost,
+**	which any Ethernet client must already tolerate.
+*/
+static int
+ni20_ckpt(struct device *d, struct ckpt_s *ck)
+{
+    return ckp_put(ck, d, sizeof(struct ni20));
+}
+
+static int
+ni20_ckrest(struct device *d, struct ckpt_s *ck, int dorest)
+{
+    register struct ni20 *ni = (struct ni20 *)d;
+    register struct ni20 *s;
+
+    if (!(s = (struct ni20 *)ckp_get(ck, sizeof(*s))))
+	return FALSE;
+    if (!dorest)
+	return TRUE;
+
+    ni20_stop(ni);		/* Flush whatever this process had going */
+
+    ni->ni_lhcond = s->ni_lhcond;
+    ni->ni_cond = s->ni_cond;
+    ni->ni_pia = s->ni_pia;
+    ni->ni_pilev = s->ni_pilev;
+    ni->ni_pivec = s->ni_pivec;
+    ni->ni_state = s->ni_state;
+    ni->ni_rar = s->ni_rar;
+    ni->ni_lar = s->ni_lar;
+    ni->ni_ebuf = s->ni_ebuf;
+    ni->ni_staflgs = s->ni_staflgs;
+    ni->ni_retries = s->ni_retries;
+
+    ni->ni_pcba = s->ni_pcba;
+    ni->ni_pcbvp = ckp_vmptr(ck, s->ni_pcbvp);
+    ni->ni_ppia = s->ni_ppia;
+    ni->ni_ivec = s->ni_ivec;
+    ni->ni_upqelen = s->ni_upqelen;
+    ni->ni_pttvp = ckp_vmptr(ck, s->ni_pttvp);
+    ni->ni_mcatvp = ckp_vmptr(ck, s->ni_mcatvp);
+    ni->ni_rcbvp = ckp_vmptr(ck, s->ni_rcbvp);
+    ni->ni_dc = s->ni_dc;
+
+    ni->ni_istate = s->ni_istate;
+    ni->ni_cmdqf = s->ni_cmdqf;
+    ni->ni_qepa = s->ni_qepa;
+    ni->ni_qhpa = s->ni_qhpa;
+    ni->ni_pktinf = FALSE;
+    ni->ni_nptts = s->ni_nptts;
+    ni->ni_nmcats = s->ni_nmcats;
+    memcpy((char *)ni->ni_ptt, (char *)s->ni_ptt, sizeof(ni->ni_ptt));
+    memcpy((char *)ni->ni_mcat, (char *)s->ni_mcat, sizeof(ni->ni_mcat));
+    memcpy((char *)ni->ni_cnts, (char *)s->ni_cnts, sizeof(ni->ni_cnts));
+    ni->ni_ecbfuse = ni->ni_ecbffree = 0;	/* Forget echo checks */
+
+    ni->ni_dv.dv_pireq = 0;
+    if (ni->ni_state & NI20_STF_RUN) {
+	ni->ni_state = NI20_ST_HALT;	/* Port is gone, say it crashed */
+	ni->ni_cond &= ~NI20CO_MRN;
+	ni->ni_lar = NI20_CPE_INTERR;
+	ni->ni_lhcond |= NI20CI_CPE;
+	ni20_pi(ni);
+    } else
+	ni20_picheck(ni);
+    return TRUE;
+}
+#endif /* KLH10_CKPT */
+
 #endif /* KLH10_DEV_NI20 */
@@ -855,6 +855,11 @@ rh11_iobuf(struct device *drv,
 
 	rh->rh_wc = (rh->rh_wc + (wc << 1)) & MASK16;	/* Add to 11-wd cnt */
 
+	/* A drive read has just stored those words; tell the pager */
+	if (!rh->rh_dcwrt)
+	    PAG_IOWRITE(rh->rh_dcrev ? rh->rh_dcbuf - (wc - 1) : rh->rh_dcbuf,
+			(long)wc);
+
 	if (!rhdc_ccwget(rh)) {		/* Do mapping, set up our vars */
 	    if (RHDEBUG(rh))
 		fprintf(RHDBF(rh), "failed]");
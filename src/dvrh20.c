@@ -45,6 +45,9 @@ static int decosfcclossage;
 #include "kn10dev.h"
 #include "dvuba.h"
 #include "dvrh20.h"
+#if KLH10_CKPT
+# include "kn10ckp.h"
+#endif
 
 #ifdef RCSID
  RCSID(dvrh20_c,"$Id: dvrh20.c,v 2.4 2003/02/23 18:16:54 klh Exp $")
@@ -108,6 +111,10 @@ static w10_t rh20_datai(struct device *d);
 static int   rh20_bind(struct device *d, FILE *of, struct device *u, int num);
 static int   rh20_init(struct device *d, FILE *of);
 static void  rh20_reset(struct device *d);
+#if KLH10_CKPT
+static int   rh20_ckpt(struct device *d, struct ckpt_s *ck);
+static int   rh20_ckrest(struct device *d, struct ckpt_s *ck, int dorest);
+#endif
 #if 0
 static int   rh20_readin();	/* Readin boot, if supported */
 #endif
@@ -161,6 +168,10 @@ dvrh20_create(FILE *f, char *s)
     rh->rh_dv.dv_bind = rh20_bind;	/* Controller, so can bind. */
     rh->rh_dv.dv_init = rh20_init;	/* Set up own post-bind init */
     rh->rh_dv.dv_reset = rh20_reset;	/* System reset (clear stuff) */
+#if KLH10_CKPT
+    rh->rh_dv.dv_ckpt = rh20_ckpt;	/* Checkpoint/restore */
+    rh->rh_dv.dv_ckrest = rh20_ckrest;
+#endif
 
     return &rh->rh_dv;
 }
@@ -929,6 +940,11 @@ rh20_iobuf(struct device *drv,
     if (wc) {
 	/* If drive is updating our IO xfer status, do it. */
 
+	/* A drive read has just stored those words; tell the pager */
+	if (rh->rh_dcbuf && !rh->rh_dcwrt)
+	    PAG_IOWRITE(rh->rh_dcrev ? rh->rh_dcbuf + wc + 1 : rh->rh_dcbuf,
+			(long)(wc < 0 ? -wc : wc));
+
 	/* Update buffer pointer, assuming wc has correct direction sign */
 	if (rh->rh_dcbuf)
 	    rh->rh_dcbuf += wc;
@@ -1149,5 +1165,44 @@ rhdc_ccwget(register struct rh20 *rh)
     }
 }
 
+#if KLH10_CKPT
+
+/* Checkpoint/restore.  Only the registers and channel state are
+**	restored; drive bindings are those of the current configuration.
+*/
+static int
+rh20_ckpt(struct device *d, struct ckpt_s *ck)
+{
+    return ckp_put(ck, d, sizeof(struct rh20));
+}
+
+static int
+rh20_ckrest(struct device *d, struct ckpt_s *ck, int dorest)
+{
+    register struct rh20 *rh = (struct rh20 *)d;
+    struct rh20 *s, live;
+    register int i;
+
+    if (!(s = (struct rh20 *)ckp_get(ck, sizeof(*s))))
+	return FALSE;
+    for (i = 0; i < 8; ++i) {
+	if (!s->rh_drive[i] != !rh->rh_drive[i]) {
+	    fprintf(ckp_outf(ck), "RH20 drive %d binding differs\n", i);
+	    return FALSE;
+	}
+    }
+    if (!dorest)
+	return TRUE;
+
+    live = *rh;
+    *rh = *s;
+    rh->rh_dv = live.rh_dv;
+    rh->rh_dv.dv_pireq = s->rh_dv.dv_pireq;
+    memcpy((char *)rh->rh_drive, (char *)live.rh_drive, sizeof(rh->rh_drive));
+    rh->rh_dsptr = s->rh_dsptr ? rh->rh_drive[rh->rh_ds] : NULL;
+    return TRUE;
+}
+#endif /* KLH10_CKPT */
+
 #endif /* KLH10_DEV_RH20 */
 
@@ -48,6 +48,9 @@ static int decosfcclossage;
 #include "dvrh20.h"
 #include "dvrpxx.h"
 #include "prmstr.h"	/* For parameter parsing */
+#if KLH10_CKPT
+# include "kn10ckp.h"
+#endif
 
 #if KLH10_DEV_DPRPXX
 # include "dpsup.h"	/* Using device subproc! */
@@ -57,6 +60,19 @@ static int decosfcclossage;
 # include "wfio.h"	/* For word-based file i/o */
 # include "vdisk.h"	/* Virtual Disk facilities */
 #endif
+#if KLH10_RP_THREAD
+# if !KLH10_DEV_DPRPXX
+#  error "KLH10_RP_THREAD needs KLH10_DEV_DPRPXX"
+# endif
+# if !(HAVE_PTHREAD_H && HAVE_SYS_EVENTFD_H)
+#  error "KLH10_RP_THREAD needs <pthread.h> and <sys/eventfd.h>"
+# endif
+# include <stdint.h>
+# include <unistd.h>
+# include <signal.h>
+# include <pthread.h>
+# include <sys/eventfd.h>
+#endif
 
 #ifdef RCSID
  RCSID(dvrpxx_c,"$Id: dvrpxx.c,v 2.4 2002/05/21 09:52:07 klh Exp $")
@@ -70,6 +86,10 @@ static int decosfcclossage;
 # define DVRP_MAXPATH 63
 #endif
 
+#ifndef DVRP_NTHR		/* Max # of I/O threads shared by all drives */
+# define DVRP_NTHR 4
+#endif
+
 #if 0
 #define DVDEBUG(d) ((d)->rp_dv.dv_debug)
 #define DVDBF(d)   ((d)->rp_dv.dv_dbf)
@@ -156,6 +176,7 @@ struct rpdev {
     long rp_blkadr;		/* Disk loc as a sector number */
     int rp_isdirect;		/* TRUE if current xfer is direct */
     vmptr_t rp_xfrvp;		/* If direct, holds ptr to 10-mem */
+    long rp_xfrpre;		/* # words channel already advanced over */
 
     int rp_bufwds;		/* Size of buffer in words */
     int rp_bufsec;		/* Size of buffer in sectors */
@@ -175,6 +196,28 @@ struct rpdev {
 # define RPXX_ST_READY	1	/* On and ready for command */
 # define RPXX_ST_BUSY	2	/* Executing some command */
     int rp_dpdbg;		/* Initial DP debug value */
+# if KLH10_DP_RING
+    int rp_nrq;			/* # requests in batch being sent or done */
+    struct dprp_rq *rp_rq[DPRP_QMAX];	/* Their slots in the ring */
+# endif
+# if KLH10_DP_RING || KLH10_RP_THREAD
+    long rp_rescnt;		/* Batch or thread result sector count */
+    long rp_reserr;		/* Batch or thread result error (if nonzero) */
+# endif
+# if KLH10_RP_THREAD		/* In-process I/O instead of subproc */
+    int rp_thr;			/* TRUE if this drive uses I/O threads */
+    int rp_thrfd;		/* eventfd rung when a command is done */
+    int rp_thrflg;		/* and flag set along with it */
+    int rp_thrrun;		/* TRUE while a thread has the command */
+    int rp_thrmol;		/* Medium online, as of last command */
+    int rp_thrwrl;		/* Write-locked, ditto */
+    int rp_thrcmd;		/* DPRP_ command for the thread to do */
+    vmptr_t rp_thrvp;		/* Buffer or 10 mem to xfer to/from */
+    int rp_thrsec;		/* # sectors to xfer */
+    unsigned long rp_thrdad;	/* Disk address (sectors) */
+    struct rpdev *rp_thrnext;	/* Next in queue of drives awaiting I/O */
+    struct vdk_unit rp_vdk;	/* Virtual Disk unit */
+# endif
 
 #else
     long rp_rescnt;		/* I/O result sector count */
@@ -182,10 +225,42 @@ struct rpdev {
     struct vdk_unit rp_vdk;	/* Virtual Disk unit */
 #endif
     char rp_spath[DVRP_MAXPATH+1];
+    char rp_ovpath[DVRP_MAXPATH+1];	/* Overlay for pack, "" if none */
 };
 
 #define RPREG(d,r) ((d)->rp_reg[r])
 
+#if KLH10_RP_THREAD		/* TRUE if drive uses I/O threads */
+# define RP_ISTHR(rp) ((rp)->rp_thr)
+#else
+# define RP_ISTHR(rp) 0
+#endif
+
+#if KLH10_RP_THREAD		/* Where drive status turns up */
+# define RP_DPMOL(rp) (RP_ISTHR(rp) ? (rp)->rp_thrmol \
+				    : (rp)->rp_sdprp->dprp_mol)
+# define RP_DPWRL(rp) (RP_ISTHR(rp) ? (rp)->rp_thrwrl \
+				    : (rp)->rp_sdprp->dprp_wrl)
+#elif KLH10_DEV_DPRPXX
+# define RP_DPMOL(rp) ((rp)->rp_sdprp->dprp_mol)
+# define RP_DPWRL(rp) ((rp)->rp_sdprp->dprp_wrl)
+#endif
+
+#if KLH10_DEV_DPRPXX && !KLH10_DP_RING	/* Where I/O results turn up */
+# if KLH10_RP_THREAD
+#  define RP_RESCNT(rp) (RP_ISTHR(rp) ? (rp)->rp_rescnt \
+				      : (long)(rp)->rp_sdprp->dprp_scnt)
+#  define RP_RESERR(rp) (RP_ISTHR(rp) ? (rp)->rp_reserr \
+				      : (long)(rp)->rp_sdprp->dprp_err)
+# else
+#  define RP_RESCNT(rp) ((rp)->rp_sdprp->dprp_scnt)
+#  define RP_RESERR(rp) ((rp)->rp_sdprp->dprp_err)
+# endif
+#else
+# define RP_RESCNT(rp) ((rp)->rp_rescnt)
+# define RP_RESERR(rp) ((rp)->rp_reserr)
+#endif
+
 static int nrps = 0;		/* # of RPs defined */
 struct rpdev			/* External for easier debug */
 	*dvrpxx[DVRP_NSUP];	/* Table of pointers, for easier debug */
@@ -200,6 +275,10 @@ static uint32 rpxx_rdreg(struct device *d, int reg);
 static int  rpxx_wrreg(struct device *d, int reg, dvureg_t val);
 static void rpxx_powoff(struct device *d);
 static int  rpxx_mount(struct device *d, FILE *f, char *path, char *argstr);
+#if KLH10_CKPT
+static int  rpxx_ckpt(struct device *d, struct ckpt_s *ck);
+static int  rpxx_ckrest(struct device *d, struct ckpt_s *ck, int dorest);
+#endif
 
 /* Other exported vectors */
 
@@ -207,6 +286,9 @@ static int  rpxx_mount(struct device *d, FILE *f, char *path, char *argstr);
 static void rpxx_evhsdon(struct device *d, struct dvevent_s *evp);
 static void rpxx_evhrwak(struct device *d, struct dvevent_s *evp);
 #endif
+#if KLH10_RP_THREAD
+static void rpxx_evhtdon(struct device *d, struct dvevent_s *evp);
+#endif
 static int  rpxx_timeout(void *);
 
 /* Completely internal functions */
@@ -227,8 +309,21 @@ static void rp_showbuf(struct rpdev *, unsigned char *, vmptr_t, int, int);
 
 #if KLH10_DEV_DPRPXX
 static void rp_dpcmd(struct rpdev *rp, int cmd, size_t arg);
+static void rp_dpio(struct rpdev *rp, int cmd, int nsec, vmptr_t vp);
 static int  rp_dpstart(struct rpdev *rp);
 static void rp_dpcmddon(struct rpdev *);
+# if KLH10_DP_RING
+static struct dprp_rq *rp_dpqreq(struct rpdev *rp, size_t cnt);
+static void rp_dpqdma(struct rpdev *rp, int cmd, int wc, vmptr_t vp);
+static void rp_dpqres(struct rpdev *rp);
+# endif
+#endif
+#if KLH10_RP_THREAD
+static int  rp_thrinit(struct rpdev *rp, FILE *of);
+static void rp_thrq(struct rpdev *rp);
+static void *rp_thrloop(void *);
+static void rp_thrdo(struct rpdev *rp);
+static void rp_thrterm(struct rpdev *rp);
 #endif
 
 /* Configuration Parameters */
@@ -241,6 +336,7 @@ static void rp_dpcmddon(struct rpdev *);
     prmdef(RPP_SEC,  "sec"),	/* Drive size: # sectors/trk */\
     prmdef(RPP_SN,   "sn"),	/* Drive Serial number */\
     prmdef(RPP_PATH, "path"),	/* Pack pathname - OS file or raw device */\
+    prmdef(RPP_OVL,  "overlay"),	/* Overlay file to take pack writes */\
     prmdef(RPP_FMT,  "format"),	/* Pack format */\
     prmdef(RPP_RO,   "ro"),	/* Pack is Read-Only */\
     prmdef(RPP_RW,   "rw"),	/* Pack is Read/Write (default) */\
@@ -248,7 +344,8 @@ static void rp_dpcmddon(struct rpdev *);
     prmdef(RPP_IODLY,"iodly"),	/* Usec to delay I/O operations */\
     prmdef(RPP_DPDBG,"dpdebug"), /* Initial DP debug value */\
     prmdef(RPP_DMA,  "dpdma"),	/* True to use subproc DMA if possible */\
-    prmdef(RPP_DP,   "dppath")	/* Device subproc pathname */
+    prmdef(RPP_DP,   "dppath"),	/* Device subproc pathname */\
+    prmdef(RPP_THR,  "thread")	/* True to do I/O in threads, not subproc */
 
 enum {
 # define prmdef(i,s) i
@@ -302,11 +399,15 @@ rp_conf(FILE *f, char *s, struct rpdev *rp)
 #endif
     rp->rp_iotmr = NULL;
     rp->rp_spath[0] = '\0';		/* No path (default it later) */
+    rp->rp_ovpath[0] = '\0';		/* No overlay */
 #if KLH10_DEV_DPRPXX
     rp->rp_dpdma = TRUE;		/* Default is DO use DMA if possible */
     rp->rp_dpname = "dprpxx";		/* Subproc executable */
     rp->rp_dpdbg = FALSE;
 #endif
+#if KLH10_RP_THREAD
+    rp->rp_thr = FALSE;			/* Default is subproc */
+#endif
 
     prm_init(&prm, buff, sizeof(buff),
 		s, strlen(s),
@@ -437,6 +538,17 @@ rp_conf(FILE *f, char *s, struct rpdev *rp)
 		strcpy(rp->rp_spath, prm.prm_val);
 	    continue;
 
+	case RPP_OVL:		/* Parse as simple string */
+	    if (!prm.prm_val)
+		break;
+	    if (strlen(prm.prm_val) > DVRP_MAXPATH) {
+		fprintf(f, "RPXX overlay path too long (max %d)\n",
+							DVRP_MAXPATH);
+		ret = FALSE;
+	    } else
+		strcpy(rp->rp_ovpath, prm.prm_val);
+	    continue;
+
 	case RPP_DPDBG:		/* Parse as true/false boolean or number */
 #if KLH10_DEV_DPRPXX
 	    if (!prm.prm_val)	/* No arg => default to 1 */
@@ -460,6 +572,15 @@ rp_conf(FILE *f, char *s, struct rpdev *rp)
 	    if (!prm.prm_val)
 		break;
 	    rp->rp_dpname = s_dup(prm.prm_val);
+#endif
+	    continue;
+
+	case RPP_THR:		/* Parse as true/false boolean */
+#if KLH10_RP_THREAD
+	    if (!prm.prm_val)	/* No arg => default to 1 */
+		rp->rp_thr = TRUE;
+	    else if (!s_tobool(prm.prm_val, &rp->rp_thr))
+		break;
 #endif
 	    continue;
 	}
@@ -473,7 +594,8 @@ rp_conf(FILE *f, char *s, struct rpdev *rp)
 
     /* Param string all done, do followup checks or cleanup */
 #if KLH10_DEV_DPRPXX
-    if (!cpu.mm_shared)		/* If no shared 10 mem, */
+    if (!cpu.mm_shared		/* If no shared 10 mem, */
+      && !RP_ISTHR(rp))		/* and not in our own address space, */
 	rp->rp_dpdma = FALSE;	/* force no DMA. */
 #endif
 
@@ -619,6 +741,10 @@ dvrp_create(FILE *f, char *s)
     rp->rp_dv.dv_wrreg  = rpxx_wrreg;
     rp->rp_dv.dv_powoff = rpxx_powoff;
     rp->rp_dv.dv_mount  = rpxx_mount;
+#if KLH10_CKPT
+    rp->rp_dv.dv_ckpt   = rpxx_ckpt;
+    rp->rp_dv.dv_ckrest = rpxx_ckrest;
+#endif
 
     /* Configure drive internals from parsed string and remember for
     ** setting up disk during init.
@@ -653,6 +779,12 @@ rpxx_init(struct device *d, FILE *of)
     rp->rp_scmd = -1;
 
 #if KLH10_DEV_DPRPXX
+# if KLH10_RP_THREAD
+    if (rp->rp_thr) {
+	if (!rp_thrinit(rp, of))	/* No subproc, use I/O threads */
+	    return FALSE;
+    } else
+# endif
   {
     register struct dprpxx_s *dprp;
     struct dvevent_s ev;
@@ -660,12 +792,26 @@ rpxx_init(struct device *d, FILE *of)
     rp->rp_state = RPXX_ST_OFF;
 
     if (!dp_init(&rp->rp_dp, sizeof(struct dprpxx_s),
-		DP_XT_MSIG, SIGUSR1, 0,				/* in fr dp */
-		DP_XT_MSIG, SIGUSR1,				/* out to dp */
+		DP_XT_BELL, SIGUSR1, 0,				/* in fr dp */
+		DP_XT_BELL, SIGUSR1,				/* out to dp */
+#if KLH10_DP_RING	/* Room for a buffer batch, or a full direct one */
+		2 * DP_XQ_SLOT(DPRP_RQSIZ + rp->rp_bufwds*sizeof(w10_t))
+			+ DPRP_QMAX * DP_XQ_SLOT(DPRP_RQSIZ))) {
+#else
 				(size_t)rp->rp_bufwds*sizeof(w10_t))) {
+#endif
 	if (of) fprintf(of, "RPXX subproc init failed!\n");
 	return FALSE;
     }
+#if KLH10_DP_RING
+    /* Requests are queued; rp_buff is set to each one's data */
+    rp->rp_nrq = 0;
+    if (!dp_xqinit(&(rp->rp_dp.dp_adr->dpc_todp),
+			DPRP_RQSIZ + rp->rp_bufwds*sizeof(w10_t))) {
+	if (of) fprintf(of, "RPXX request ring init failed!\n");
+	return FALSE;
+    }
+#endif
     rp->rp_buff = dp_xsbuff(&(rp->rp_dp.dp_adr->dpc_todp), (size_t *)NULL);
 
     rp->rp_dv.dv_dpp = &(rp->rp_dp);	/* Tell CPU where our DP struct is */
@@ -696,16 +842,26 @@ rpxx_init(struct device *d, FILE *of)
 
     /* Register ourselves with main KLH10 loop for DP events */
 
+#if KLH10_DP_MSEM
+    ev.dvev_type = DVEV_DPBELL;		/* Event = Device Proc doorbell */
+    ev.dvev_arg.eva_int = rp->rp_dp.dp_adr->dpc_todp.dpx_donfd;
+#else
     ev.dvev_type = DVEV_DPSIG;		/* Event = Device Proc signal */
     ev.dvev_arg.eva_int = SIGUSR1;
+#endif
     ev.dvev_arg2.eva_ip = &(rp->rp_dp.dp_adr->dpc_todp.dpx_donflg);
     if (!(*rp->rp_dv.dv_evreg)((struct device *)rp, rpxx_evhsdon, &ev)) {
 	if (of) fprintf(of, "RPXX event reg failed!\n");
 	return FALSE;
     }
 
+#if KLH10_DP_MSEM
+    ev.dvev_type = DVEV_DPBELL;		/* Event = Device Proc doorbell */
+    ev.dvev_arg.eva_int = rp->rp_dp.dp_adr->dpc_frdp.dpx_wakfd;
+#else
     ev.dvev_type = DVEV_DPSIG;		/* Event = Device Proc signal */
     ev.dvev_arg.eva_int = SIGUSR1;
+#endif
     ev.dvev_arg2.eva_ip = &(rp->rp_dp.dp_adr->dpc_frdp.dpx_wakflg);
     if (!(*rp->rp_dv.dv_evreg)((struct device *)rp, rpxx_evhrwak, &ev)) {
 	if (of) fprintf(of, "RPXX event reg failed!\n");
@@ -744,7 +900,8 @@ rpxx_init(struct device *d, FILE *of)
     if (rp->rp_spath[0]) {
 
 #if KLH10_DEV_DPRPXX
-	if (!rp_dpstart(rp)) {		/* Fire up the subproc! */
+	if (!RP_ISTHR(rp)
+	  && !rp_dpstart(rp)) {		/* Fire up the subproc! */
 	    if (of) fprintf(of, "RPXX subproc \"%s\" startup failed!\n",
 					rp->rp_dpname);
 	    return FALSE;
@@ -795,6 +952,13 @@ rpxx_powoff(struct device *d)
 		(struct device *)rp,
 		NULL,		/* No event handler proc */
 		(struct dvevent_s *)NULL);
+# if KLH10_RP_THREAD
+    if (rp->rp_thr) {
+	rp_thrterm(rp);			/* Wait out any command, then free */
+	rp->rp_state = RPXX_ST_OFF;
+	return;
+    }
+# endif
     dp_term(&(rp->rp_dp), 0);	/* Flush all subproc overhead */
 
     rp->rp_state = RPXX_ST_OFF;
@@ -840,7 +1004,10 @@ rpxx_mount(struct device *d,
 	    fprintf(f, "No pack mounted.\n");
 	    return TRUE;
 	}
-	fprintf(f, "Current disk pathname is \"%s\", status ", opath);
+	fprintf(f, "Current disk pathname is \"%s\"", opath);
+	if (rp->rp_ovpath[0])
+	    fprintf(f, " (overlay \"%s\")", rp->rp_ovpath);
+	fprintf(f, ", status ");
 
 #if KLH10_DEV_DPRPXX
 	switch (rp->rp_state) {
@@ -857,9 +1024,9 @@ rpxx_mount(struct device *d,
 		fprintf(f, "<\?\?%d\?\?>", rp->rp_state);
 		break;
 	}
-	if (rp->rp_sdprp->dprp_mol)
+	if (RP_DPMOL(rp))
 	    fprintf(f, " ONLINE");
-	if (rp->rp_sdprp->dprp_wrl)
+	if (RP_DPWRL(rp))
 	    fprintf(f, " WRITELOCKED");
 #else
 	switch (vstate) {
@@ -900,6 +1067,12 @@ rpxx_mount(struct device *d,
 	    return TRUE;		/* OK, no pack mounted */
 	}
 
+# if KLH10_RP_THREAD
+	if (RP_ISTHR(rp)) {
+	    if (!rp_thrinit(rp, f))	/* Hand drive to I/O threads again */
+		return FALSE;
+	} else
+# endif
 	if (!rp_dpstart(rp))		/* Fire up the subproc! */
 	    return FALSE;
     }
@@ -911,14 +1084,20 @@ rpxx_mount(struct device *d,
 	/* Process argstr to determine optional params for mount */
 	int roflag = FALSE;
 	int fmt = rp_format;	/* For now, default to external */
+	char ovpath[DVRP_MAXPATH+1];	/* New pack doesn't inherit overlay */
 	int err = FALSE;
 	size_t plen;
 	char tokbuf[100];
 
+	ovpath[0] = '\0';
 	while (s_eztoken(tokbuf, sizeof(tokbuf), &argstr)) {
 		 if (s_match(tokbuf, "ro")==2) roflag = TRUE;
 	    else if (s_match(tokbuf, "rw")==2) roflag = FALSE;
 	    else if (parfmt(tokbuf, &fmt));
+	    else if (strncmp(tokbuf, "overlay=", 8) == 0
+		  && strlen(tokbuf+8) <= DVRP_MAXPATH) {
+		strcpy(ovpath, tokbuf+8);
+	    }
 	    else {
 		fprintf(f, "Unknown mount option: \"%s\"\n", tokbuf);
 		err++;
@@ -930,6 +1109,7 @@ rpxx_mount(struct device *d,
 	/* Plug params into RP struct for use by xmount */
 	rp->rp_fmt = fmt;
 	rp->rp_iswrite = !roflag;
+	strcpy(rp->rp_ovpath, ovpath);
 
 	plen = strlen(path);
 	if (plen > DVRP_MAXPATH-1)
@@ -951,9 +1131,13 @@ rpxx_mount(struct device *d,
     } else {
 	/* Just unmounting current pack? */
 #if KLH10_DEV_DPRPXX
+# if KLH10_DP_RING
+	if (!RP_ISTHR(rp))
+	    (void) rp_dpqreq(rp, (size_t)1);
+# endif
 	rp->rp_buff[0] = '\0';		/* Tell DP to unmount */
 	rp->rp_scmd = RH_MNOP;		/* Conspire with rp_dpcmddon */
-	rp_dpcmd(rp, DPRP_MOUNT, (size_t)0);
+	rp_dpcmd(rp, DPRP_MOUNT, (size_t)1);
 	fprintf(f, "Unmount requested\n");
 	return TRUE;
 #else
@@ -978,20 +1162,36 @@ rp_xmount(register struct rpdev *rp)
     /* Copy new path into DP comm buffer, including a terminating nul.
     */
     cnt = strlen(rp->rp_spath);
+#if KLH10_DP_RING
+    if (!RP_ISTHR(rp))
+	(void) rp_dpqreq(rp, cnt+2);
+#endif
     rp->rp_buff[0] = (rp->rp_iswrite ? 'W' : 'R');	/* Special prefix */
 
     memcpy((char *)(rp->rp_buff+1), rp->rp_spath, cnt);
     rp->rp_buff[++cnt] = '\0';
+#if KLH10_RP_THREAD
+    if (rp->rp_thr) {			/* Thread mounts our own unit */
+	rp->rp_vdk.dk_format = rp->rp_fmt;
+	rp->rp_vdk.dk_ovpath = rp->rp_ovpath[0] ? rp->rp_ovpath : NULL;
+    } else
+#endif
+  {
     rp->rp_sdprp->dprp_fmt = rp->rp_fmt;	/* Set desired format */
+    memcpy(rp->rp_sdprp->dprp_ovpath, rp->rp_ovpath,	/* and overlay */
+		sizeof(rp->rp_sdprp->dprp_ovpath));
+    rp->rp_sdprp->dprp_ovpath[DPRP_MAXPATH] = '\0';
+  }
 
     /* Do command!  And hope for the best... */
     rp->rp_scmd = RH_MNOP;			/* Conspire with rp_dpcmddon */
-    rp_dpcmd(rp, DPRP_MOUNT, cnt);
+    rp_dpcmd(rp, DPRP_MOUNT, cnt+1);
     return TRUE;
 #else
     int res;
 
     rp->rp_vdk.dk_format = rp->rp_fmt;
+    rp->rp_vdk.dk_ovpath = rp->rp_ovpath[0] ? rp->rp_ovpath : NULL;
     res = vdk_mount(&(rp->rp_vdk), rp->rp_spath, rp->rp_iswrite);
 
     rp_clear(rp);		/* Clear drive status, set regs */
@@ -1008,11 +1208,23 @@ rp_xmount(register struct rpdev *rp)
 static void
 rp_dpcmd(register struct rpdev *rp, int cmd, size_t arg)
 {
-    register struct dpx_s *dpx = &(rp->rp_dp.dp_adr->dpc_todp);
+    register struct dpx_s *dpx;
 
     if (DVDEBUG(rp))
 	fprintf(DVDBF(rp), "[rp_dpcmd: DP %d, %ld]\r\n", cmd, (long)arg);
 
+#if KLH10_RP_THREAD
+    if (rp->rp_thr) {
+	if (rp->rp_state != RPXX_ST_READY)
+	    panic("[rp_dpcmd: can't send cmd %d]", cmd);
+	rp->rp_state = RPXX_ST_BUSY;
+	rp->rp_thrcmd = cmd;
+	rp_thrq(rp);			/* Hand it to an I/O thread */
+	return;
+    }
+#endif
+    dpx = &(rp->rp_dp.dp_adr->dpc_todp);
+
     /* First, double-check to be sure it's OK to send a command */
     if (rp->rp_state != RPXX_ST_READY) {
 	/* Says not ready -- check DP to see if true */
@@ -1026,9 +1238,148 @@ rp_dpcmd(register struct rpdev *rp, int cmd, size_t arg)
     }
     rp->rp_state = RPXX_ST_BUSY;
 
+#if KLH10_DP_RING
+    /* Put the request got from rp_dpqreq, and send the whole batch */
+    dp_xqsput(dpx, cmd, DPRP_RQSIZ + arg);
+    dp_xqsend(dpx);
+#else
     dp_xsend(dpx, cmd, arg);		/* Send command! */
+#endif
 }
 
+/* RP_DPIO - Start a read or write of NSEC sectors at the current disk
+**	address, directly to or from 10 memory at VP, or using the buffer
+**	if VP is NULL.
+*/
+static void
+rp_dpio(register struct rpdev *rp, int cmd, int nsec, vmptr_t vp)
+{
+#if KLH10_RP_THREAD
+    if (rp->rp_thr) {
+	rp->rp_thrvp = vp ? vp : (vmptr_t)rp->rp_buff;
+	rp->rp_thrsec = nsec;
+	rp->rp_thrdad = rp->rp_blkadr;
+	rp_dpcmd(rp, cmd, (size_t)0);
+	return;
+    }
+#endif
+#if KLH10_DP_RING
+    register struct dprp_rq *rq = rp->rp_rq[rp->rp_nrq-1];
+
+    if (vp)
+	rq->rq_phyadr = vp - vm_physmap(0);
+    rq->rq_scnt = nsec;
+    rq->rq_daddr = rp->rp_blkadr;
+    rp_dpcmd(rp, cmd,
+	(vp ? 0 : (size_t)nsec * rp->rp_dcf.dcf_nwds * sizeof(w10_t)));
+#else
+    if (vp)
+	rp->rp_sdprp->dprp_phyadr = vp - vm_physmap(0);
+    rp->rp_sdprp->dprp_scnt = nsec;
+    rp->rp_sdprp->dprp_daddr = rp->rp_blkadr;
+    rp_dpcmd(rp, cmd, (size_t)0 /* nsec*128*sizeof(w10_t) */);
+#endif
+}
+
+#if KLH10_DP_RING
+
+/* RP_DPQREQ - Get a ring slot for the next request of a batch, with
+**	room for CNT bytes of data, and point rp_buff at the latter.
+**	The ring is empty whenever the DP is ready, and sized so a batch
+**	always fits.
+*/
+static struct dprp_rq *
+rp_dpqreq(register struct rpdev *rp, size_t cnt)
+{
+    register unsigned char *ucp;
+    register struct dprp_rq *rq;
+
+    if (rp->rp_nrq >= DPRP_QMAX
+      || !(ucp = dp_xqsbuff(&(rp->rp_dp.dp_adr->dpc_todp),
+			    DPRP_RQSIZ + cnt)))
+	panic("[rp_dpqreq: no room for request]");
+    rq = (struct dprp_rq *)ucp;
+    rq->rq_chain = (rp->rp_nrq > 0);
+    rp->rp_rq[rp->rp_nrq++] = rq;
+    rp->rp_buff = ucp + DPRP_RQSIZ;
+    return rq;
+}
+
+/* RP_DPQDMA - Start a direct read or write of WC words to or from VP,
+**	going on to further pieces of the channel's buffer list while each
+**	is whole sectors, so the DP can do up to DPRP_QMAX at one go.
+**	The channel is advanced over every piece but the last now, and
+**	rp_xfrpre says how far; if the batch fails short of that point,
+**	the completion code must stop the transfer with an error rather
+**	than leave the channel claiming words that were never moved.
+*/
+static void
+rp_dpqdma(register struct rpdev *rp,
+	  int cmd,
+	  register int wc,
+	  vmptr_t vp)
+{
+    register struct dprp_rq *rq;
+    register int nwds = rp->rp_dcf.dcf_nwds;
+    register long lim = rp->rp_blklim;
+    unsigned long daddr = rp->rp_blkadr;
+    int nsec, nwc;
+
+    rp->rp_xfrpre = 0;
+    for (;;) {
+	nsec = ((wc < lim) ? wc : lim) / nwds;
+	rq = rp_dpqreq(rp, (size_t)0);
+	rq->rq_phyadr = vp - vm_physmap(0);
+	rq->rq_scnt = nsec;
+	rq->rq_daddr = daddr;
+
+	/* Stop unless this piece is all used and there's another */
+	if (rp->rp_nrq >= DPRP_QMAX || nsec * nwds != wc)
+	    break;
+	nwc = (*rp->rp_dv.dv_iobuf)(&rp->rp_dv, wc, &vp);
+	if (!vp || nwc < nwds || (lim -= wc) < nwds) {
+	    /* Oops, already advanced over this one; say so */
+	    rp->rp_xfrpre += wc;
+	    break;
+	}
+	rp->rp_xfrpre += wc;
+	daddr += nsec;
+	wc = nwc;
+	if (DVDEBUG(rp))
+	    fprintf(DVDBF(rp), "[rp_dpqdma: +%d sec, %ld <-> %#lo]\r\n",
+			nsec, (long)daddr, (long)(vp - vm_physmap(0)));
+	dp_xqsput(&(rp->rp_dp.dp_adr->dpc_todp), cmd, DPRP_RQSIZ);
+    }
+    rp_dpcmd(rp, cmd, (size_t)0);
+}
+
+/* RP_DPQRES - Gather the results of a batch of requests as if it had
+**	been one.  The DP skips whatever follows a failure, so the sector
+**	count stops there.  A direct read's pieces are reported to the
+**	pager here, since the channel was advanced over most of them
+**	before the data arrived.
+*/
+static void
+rp_dpqres(register struct rpdev *rp)
+{
+    register struct dprp_rq *rq;
+    register int i;
+
+    rp->rp_rescnt = rp->rp_reserr = 0;
+    for (i = 0; i < rp->rp_nrq; ++i) {
+	rq = rp->rp_rq[i];
+	rp->rp_rescnt += rq->rq_scnt;
+	if (rp->rp_isdirect && rp->rp_scmd == RH_MRED)
+	    PAG_IOWRITE((paddr_t)rq->rq_phyadr,
+			(long)rq->rq_scnt * rp->rp_dcf.dcf_nwds);
+	if ((rp->rp_reserr = rq->rq_err))
+	    break;
+    }
+    rp->rp_nrq = 0;
+}
+
+#endif /* KLH10_DP_RING */
+
 
 /* RPXX_EVHSDON - Invoked by INSBRK event handling when
 **	signal detected from DP saying "done" in response to something
@@ -1047,6 +1398,9 @@ rpxx_evhsdon(struct device *d,
 		(int)dp_xstest(&(rp->rp_dp.dp_adr->dpc_todp)));
 
     rp->rp_state = RPXX_ST_READY;	/* Say ready for cmd again */
+#if KLH10_DP_RING
+    rp_dpqres(rp);
+#endif
     rp_dpcmddon(rp);
 }
 
@@ -1111,6 +1465,275 @@ rp_dpstart(register struct rpdev *rp)
     return TRUE;
 }
 
+#if KLH10_RP_THREAD
+
+/* I/O thread pool.
+**	A drive configured with "thread" has no subproc.  Instead its
+** commands are carried out with vdisk calls by one of a few threads
+** shared by all such drives, which read and write 10 memory directly
+** since it is in our own address space; no drive has to map all of it
+** into a process of its own.  As with a subproc a drive has at most
+** one command outstanding, so its vdk_unit, buffer and rp_thr vars
+** belong to the thread until it rings the drive's eventfd.  That
+** arrives as a DVEV_DPBELL event, like a subproc's doorbell.
+*/
+static struct {
+    pthread_mutex_t rpt_lock;
+    pthread_cond_t rpt_cond;	/* Signalled when a drive is queued */
+    pthread_cond_t rpt_dcond;	/* Broadcast when a command is done */
+    struct rpdev *rpt_head;	/* Queue of drives with a command */
+    struct rpdev **rpt_tail;
+    int rpt_nthr;		/* # threads started (main thread only) */
+} rpthr = {
+    PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,
+    NULL, &rpthr.rpt_head, 0
+};
+
+/* RP_THRINIT - Set up a drive to use the I/O threads instead of a
+**	subproc, starting another thread if the pool isn't full yet.
+*/
+static int
+rp_thrinit(register struct rpdev *rp, FILE *of)
+{
+    struct dvevent_s ev;
+    pthread_t thr;
+    sigset_t allmsk, oldmsk;
+    int err;
+
+    rp->rp_thrfd = -1;
+    rp->rp_thrrun = FALSE;
+    if (!vdk_init(&(rp->rp_vdk), (void (*)())NULL, (char *)NULL))
+	return FALSE;
+
+    if (!(rp->rp_buff = (unsigned char *)
+			malloc(rp->rp_bufwds * sizeof(w10_t)))) {
+	if (of) fprintf(of, "RPXX alloc of %d-word buffer failed!\n",
+					    rp->rp_bufwds);
+	return FALSE;
+    }
+
+    /* Set up config vars */
+    rp->rp_vdk.dk_format = rp->rp_fmt;
+    rp->rp_vdk.dk_filename = NULL;	/* Nothing mounted yet */
+    rp->rp_vdk.dk_dtype = rp->rp_dcf.dcf_type;
+    strcpy(rp->rp_vdk.dk_devname, rp->rp_dcf.dcf_name);
+    rp->rp_vdk.dk_ncyls = rp->rp_dcf.dcf_ncyl;
+    rp->rp_vdk.dk_ntrks = rp->rp_dcf.dcf_ntrk;
+    rp->rp_vdk.dk_nsecs = rp->rp_dcf.dcf_nsec;
+    rp->rp_vdk.dk_nwds = rp->rp_dcf.dcf_nwds;
+    rp->rp_thrmol = rp->rp_thrwrl = FALSE;
+
+    if ((rp->rp_thrfd = eventfd(0, EFD_NONBLOCK)) < 0) {
+	if (of) fprintf(of, "RPXX eventfd failed - %s\n",
+					    os_strerror(errno));
+	rp_thrterm(rp);
+	return FALSE;
+    }
+
+    /* Register ourselves with main KLH10 loop for thread doorbell */
+    ev.dvev_type = DVEV_DPBELL;		/* Event = doorbell */
+    ev.dvev_arg.eva_int = rp->rp_thrfd;
+    ev.dvev_arg2.eva_ip = &(rp->rp_thrflg);
+    if (!(*rp->rp_dv.dv_evreg)((struct device *)rp, rpxx_evhtdon, &ev)) {
+	if (of) fprintf(of, "RPXX event reg failed!\n");
+	rp_thrterm(rp);
+	return FALSE;
+    }
+
+    /* One more thread per drive, up to the limit */
+    if (rpthr.rpt_nthr < DVRP_NTHR) {
+	sigfillset(&allmsk);		/* Leave all signals to main thread */
+	pthread_sigmask(SIG_BLOCK, &allmsk, &oldmsk);
+	err = pthread_create(&thr, (pthread_attr_t *)NULL,
+				rp_thrloop, (void *)NULL);
+	pthread_sigmask(SIG_SETMASK, &oldmsk, (sigset_t *)NULL);
+	if (err) {
+	    if (of) fprintf(of, "RPXX I/O thread start failed - %s\n",
+					    os_strerror(err));
+	    if (!rpthr.rpt_nthr) {	/* OK if any others are running */
+		(*rp->rp_dv.dv_evreg)((struct device *)rp,
+			NULL, (struct dvevent_s *)NULL);  /* Unwatch fd */
+		rp_thrterm(rp);
+		return FALSE;
+	    }
+	} else {
+	    pthread_detach(thr);
+	    ++rpthr.rpt_nthr;
+	}
+    }
+
+    rp->rp_sdprp = NULL;		/* No subproc, ever */
+    rp->rp_state = RPXX_ST_READY;
+    return TRUE;
+}
+
+/* RP_THRQ - Queue drive's command for the next free I/O thread.
+*/
+static void
+rp_thrq(register struct rpdev *rp)
+{
+    pthread_mutex_lock(&rpthr.rpt_lock);
+    rp->rp_thrnext = NULL;
+    *rpthr.rpt_tail = rp;
+    rpthr.rpt_tail = &(rp->rp_thrnext);
+    pthread_cond_signal(&rpthr.rpt_cond);
+    pthread_mutex_unlock(&rpthr.rpt_lock);
+}
+
+/* RP_THRLOOP - Body of each I/O thread.  Never returns.
+*/
+static void *
+rp_thrloop(void *arg)
+{
+    register struct rpdev *rp;
+    uint64_t one = 1;
+
+    for (;;) {
+	pthread_mutex_lock(&rpthr.rpt_lock);
+	while (!(rp = rpthr.rpt_head))
+	    pthread_cond_wait(&rpthr.rpt_cond, &rpthr.rpt_lock);
+	if (!(rpthr.rpt_head = rp->rp_thrnext))
+	    rpthr.rpt_tail = &rpthr.rpt_head;
+	rp->rp_thrrun = TRUE;
+	pthread_mutex_unlock(&rpthr.rpt_lock);
+
+	rp_thrdo(rp);
+
+	/* Results are in, tell the 10 */
+	rp->rp_thrflg = 1;
+	__sync_synchronize();
+	if (write(rp->rp_thrfd, (char *)&one, sizeof(one)) < 0)
+	    fprintf(stderr, "[rp_thrloop: %s bell failed - %s]\r\n",
+			rp->rp_dv.dv_name, os_strerror(errno));
+
+	/* Drive is all ours again; let rp_thrterm know */
+	pthread_mutex_lock(&rpthr.rpt_lock);
+	rp->rp_thrrun = FALSE;
+	pthread_cond_broadcast(&rpthr.rpt_dcond);
+	pthread_mutex_unlock(&rpthr.rpt_lock);
+    }
+    return NULL;
+}
+
+/* RP_THRTERM - Take a drive away from the I/O threads for good.
+**	A command still queued is dropped; one a thread is carrying out
+**	is waited for.  Then the disk is unmounted and the eventfd and
+**	buffer freed.  Any doorbell event must already be unregistered.
+*/
+static void
+rp_thrterm(register struct rpdev *rp)
+{
+    register struct rpdev **rpp;
+
+    pthread_mutex_lock(&rpthr.rpt_lock);
+    for (rpp = &rpthr.rpt_head; *rpp; rpp = &((*rpp)->rp_thrnext))
+	if (*rpp == rp) {
+	    if (!(*rpp = rp->rp_thrnext))
+		rpthr.rpt_tail = rpp;
+	    break;
+	}
+    while (rp->rp_thrrun)
+	pthread_cond_wait(&rpthr.rpt_dcond, &rpthr.rpt_lock);
+    pthread_mutex_unlock(&rpthr.rpt_lock);
+
+    if (vdk_ismounted(&(rp->rp_vdk)))
+	(void) vdk_unmount(&(rp->rp_vdk));
+    rp->rp_thrmol = rp->rp_thrwrl = FALSE;
+    if (rp->rp_thrfd >= 0) {
+	(void) close(rp->rp_thrfd);
+	rp->rp_thrfd = -1;
+    }
+    if (rp->rp_buff) {
+	free((char *)rp->rp_buff);
+	rp->rp_buff = NULL;
+    }
+}
+
+/* RP_THRDO - Carry out drive's command as the subproc would, leaving
+**	results in rp_rescnt and rp_reserr.
+**	Runs in an I/O thread, so touches nothing but the drive's buffer,
+**	vdk_unit and rp_thr vars, and the 10 memory being transferred.
+*/
+static void
+rp_thrdo(register struct rpdev *rp)
+{
+    register struct vdk_unit *dk = &(rp->rp_vdk);
+    register unsigned char *buff = rp->rp_buff;
+
+    rp->rp_rescnt = 0;
+    rp->rp_reserr = 0;
+
+    switch (rp->rp_thrcmd) {
+    default:
+	rp->rp_reserr = 1;
+	break;
+
+    case DPRP_MOUNT:	/* Mount disk named in buffer, or just unmount */
+	if (vdk_ismounted(dk))
+	    (void) vdk_unmount(dk);
+	if (buff[0] && !vdk_mount(dk, (char *)buff+1, (buff[0] != 'R')))
+	    rp->rp_reserr = dk->dk_err ? dk->dk_err : 1;
+	break;
+
+    case DPRP_UNL:	/* Unload, same as unmount */
+	if (vdk_ismounted(dk))
+	    (void) vdk_unmount(dk);
+	break;
+
+    case DPRP_READ:	/* Read N sectors into buffer or 10 mem */
+    case DPRP_RDDMA:
+	if (!vdk_ismounted(dk)) {
+	    rp->rp_reserr = 1;
+	    break;
+	}
+	rp->rp_rescnt = vdk_read(dk, rp->rp_thrvp,
+				(uint32)rp->rp_thrdad, rp->rp_thrsec);
+	rp->rp_reserr = dk->dk_err;
+	break;
+
+    case DPRP_WRITE:	/* Write N sectors from buffer or 10 mem */
+    case DPRP_WRDMA:
+	if (!vdk_ismounted(dk)) {
+	    rp->rp_reserr = 1;
+	    break;
+	}
+	rp->rp_rescnt = vdk_write(dk, rp->rp_thrvp,
+				(uint32)rp->rp_thrdad, rp->rp_thrsec);
+	rp->rp_reserr = dk->dk_err;
+	break;
+    }
+}
+
+/* RPXX_EVHTDON - Invoked by INSBRK event handling when an I/O thread
+**	has rung to say the drive's command is done.
+*/
+static void
+rpxx_evhtdon(struct device *d,
+	     register struct dvevent_s *evp)
+{
+    register struct rpdev *rp = (struct rpdev *)d;
+
+    if (DVDEBUG(rp))
+	fprintf(DVDBF(rp), "[rpxx_evhtdon: %d %ld %ld]",
+		rp->rp_thrcmd, rp->rp_rescnt, rp->rp_reserr);
+
+    /* If ran out of space, go offline! */
+    if (rp->rp_reserr == ENOSPC
+      && (rp->rp_thrcmd == DPRP_WRITE || rp->rp_thrcmd == DPRP_WRDMA))
+	vdk_unmount(&(rp->rp_vdk));
+
+    /* Thread is done with the unit, so safe to look at it now */
+    rp->rp_thrmol = vdk_ismounted(&(rp->rp_vdk));
+    rp->rp_thrwrl = rp->rp_thrmol && !vdk_iswritable(&(rp->rp_vdk));
+
+    rp->rp_state = RPXX_ST_READY;	/* Say ready for cmd again */
+    rp_dpcmddon(rp);
+}
+
+#endif /* KLH10_RP_THREAD */
+
 #endif /* KLH10_DEV_DPRPXX */
 
 /* RP_SSTA - Set Status bits from slave info
@@ -1128,15 +1751,13 @@ rp_ssta(register struct rpdev *rp)
 
 #if KLH10_DEV_DPRPXX
   {
-    register struct dprpxx_s *dprp = rp->rp_sdprp;
-
-    if (rp->rp_state != RPXX_ST_OFF && dprp) {
+    if (rp->rp_state != RPXX_ST_OFF && (rp->rp_sdprp || RP_ISTHR(rp))) {
 	/* Drive present, see if ready for commands */
 	if (rp->rp_state == RPXX_ST_READY)
 	    sts |= RH_SDRY;	/* Drive present & ready for commands */
 
-	if (dprp->dprp_mol) sts |= RH_SMOL|RH_SVV;	/* Medium online */
-	if (dprp->dprp_wrl) sts |= RH_SWRL;		/* Write-locked */
+	if (RP_DPMOL(rp)) sts |= RH_SMOL|RH_SVV;	/* Medium online */
+	if (RP_DPWRL(rp)) sts |= RH_SWRL;		/* Write-locked */
     }
   }
 #else
@@ -1190,7 +1811,8 @@ rp_clear(register struct rpdev *rp)
     ** be set anytime.
     */
 #if KLH10_DEV_DPRPXX
-    rp->rp_sdprp->dprp_err = 0;	/* For now, so rp_ssta doesn't spill beans */
+    if (rp->rp_sdprp)		/* For now, so rp_ssta doesn't spill beans */
+	rp->rp_sdprp->dprp_err = 0;	/* (no DP if using I/O threads) */
 #endif
     RPREG(rp, RHR_STS) =	/* RO  FS Formatter Status */
 		RH_SDPR;	/*	Drive/formatter Present */
@@ -1715,6 +2337,7 @@ rp_ioxfr(register struct rpdev *rp, int wrtf)
 
     rp->rp_xfrcnt = 0;		/* Init # of subtransfers */
     rp->rp_isdirect = FALSE;	/* Not direct xfer (yet) */
+    rp->rp_xfrpre = 0;		/* Nothing done ahead of channel */
     if (wrtf) {
 	rp->rp_scmd = RH_MWRT;
 #if KLH10_DEV_DPRPXX
@@ -1770,11 +2393,7 @@ rp_updxfr(register struct rpdev *rp)
 {
     register int i;
 
-#if KLH10_DEV_DPRPXX
-    i = rp->rp_sdprp->dprp_scnt;
-#else
-    i = rp->rp_rescnt;
-#endif
+    i = RP_RESCNT(rp);
 
     rp->rp_blkadr += i;		/* Update sector address */
 
@@ -1805,11 +2424,7 @@ rp_updxfr(register struct rpdev *rp)
     RPREG(rp, RHR_BAFC) = RH_ADRSET(rp->rp_trk, rp->rp_sec);
 
     /* Check to see if last write completed successfully */
-#if KLH10_DEV_DPRPXX
-    if ((i = rp->rp_sdprp->dprp_err)) {
-#else
-    if ((i = rp->rp_reserr)) {
-#endif
+    if ((i = RP_RESERR(rp))) {
 	/* Ugh, what error bit to use?? */
 	if (i < 0) {				/* If -1 assume addr ovfl */
 	    RPREG(rp, RHR_ER1) |= RH_1AOE;
@@ -1844,15 +2459,16 @@ rp_wrfilbuf(register struct rpdev *rp)
 	** see if operation complete or need to write another bufferful.
 	*/
 	if (rp->rp_isdirect) {
-#if KLH10_DEV_DPRPXX
-	    wc = rp->rp_sdprp->dprp_scnt;	/* Get # sectors written */
-#else
-	    wc = rp->rp_rescnt;
-#endif
+	    wc = RP_RESCNT(rp);		/* Get # sectors written */
 	    wc *= rp->rp_dcf.dcf_nwds;	/* Find # words */
 	    rp->rp_blkwds -= wc;
 	    rp->rp_blklim -= wc;
-	    (void) (*rp->rp_dv.dv_iobuf)(&rp->rp_dv, wc, &vp);
+#if KLH10_DP_RING
+	    if (wc < rp->rp_xfrpre && !rp->rp_reserr)
+		rp->rp_reserr = 1;	/* Batch stopped behind channel */
+#endif
+	    (void) (*rp->rp_dv.dv_iobuf)(&rp->rp_dv,	/* Less any done */
+		(wc > rp->rp_xfrpre ? wc - (int)rp->rp_xfrpre : 0), &vp);
 	}
 
 	if (!rp_updxfr(rp))	/* Update regs to reflect progress */
@@ -1893,11 +2509,12 @@ rp_wrfilbuf(register struct rpdev *rp)
 	}
 
 #if KLH10_DEV_DPRPXX
-	/* Set up shared vars here */
-	rp->rp_sdprp->dprp_phyadr = vp - vm_physmap(0);
-	rp->rp_sdprp->dprp_scnt = wc;		/* # sectors */
-	rp->rp_sdprp->dprp_daddr = rp->rp_blkadr;
-	rp_dpcmd(rp, DPRP_WRDMA, (size_t)0 /* wc*128*sizeof(w10_t) */);
+# if KLH10_DP_RING
+	if (!RP_ISTHR(rp))
+	    rp_dpqdma(rp, DPRP_WRDMA, (int)totw, vp);
+	else
+# endif
+	rp_dpio(rp, DPRP_WRDMA, wc, vp);
 #else
 	rp->rp_rescnt = vdk_write(&rp->rp_vdk, vp, (uint32)rp->rp_blkadr, wc);
 
@@ -1916,6 +2533,10 @@ rp_wrfilbuf(register struct rpdev *rp)
     ** be some multiple of sector size.
     */
     rp->rp_isdirect = FALSE;
+#if KLH10_DP_RING
+    if (!RP_ISTHR(rp))
+	(void) rp_dpqreq(rp, (size_t)rp->rp_bufwds * sizeof(w10_t));
+#endif
     bwcnt = (rp->rp_bufwds < rp->rp_blklim)
 		    ? rp->rp_bufwds : rp->rp_blklim;
     totw = bwcnt;
@@ -1926,6 +2547,9 @@ rp_wrfilbuf(register struct rpdev *rp)
 	    /* Yuck, don't attempt to support this.  What err to use?
 	    ** It's not a device error actually...  just halt chan xfer.
 	    */
+#if KLH10_DP_RING
+	    rp->rp_nrq = 0;			/* Drop the unsent request */
+#endif
 	    (*rp->rp_dv.dv_ioend)(&rp->rp_dv, 1);	/* Complain to ctlr */
 	    return 0;
 	}
@@ -1956,6 +2580,9 @@ rp_wrfilbuf(register struct rpdev *rp)
     /* See if buffer has anything and write it out if so */
     totw -= bwcnt;		/* Find # words put into buffer */
     if (totw <= 0) {
+#if KLH10_DP_RING
+	rp->rp_nrq = 0;	/* Drop the unsent request */
+#endif
 	rp_ioend(rp);	/* Nothing in buffer, stop entire xfer now */
 	return 0;
     }
@@ -1979,10 +2606,7 @@ rp_wrfilbuf(register struct rpdev *rp)
     wc = (bwcnt / rp->rp_dcf.dcf_nwds);	/* Find # sectors */
 
 #if KLH10_DEV_DPRPXX
-    /* Set up shared mem vars here */
-    rp->rp_sdprp->dprp_scnt = wc;	/* # sectors to write from buffer */
-    rp->rp_sdprp->dprp_daddr = rp->rp_blkadr;
-    rp_dpcmd(rp, DPRP_WRITE, (size_t)0 /* wc*128*sizeof(w10_t) */);
+    rp_dpio(rp, DPRP_WRITE, wc, (vmptr_t)NULL);	/* Write from buffer */
 #else
 
     /* Set up WC and VP for indirect xfer */
@@ -2028,11 +2652,7 @@ rp_rdflsbuf(register struct rpdev *rp)
 	/* Invoking after completion of a read.
 	** Examine result, copy into 10 mem, and set up for next.
 	*/
-#if KLH10_DEV_DPRPXX
-	totw = rp->rp_sdprp->dprp_scnt;	/* Find # sectors read */
-#else
-	totw = rp->rp_rescnt;		/* Find # sectors read */
-#endif
+	totw = RP_RESCNT(rp);		/* Find # sectors read */
 	totw *= rp->rp_dcf.dcf_nwds;	/* Find # words read */
 	if (DVDEBUG(rp))
 	    fprintf(DVDBF(rp), "[rp_rdflsbuf: Read %ld words]", totw);
@@ -2043,7 +2663,12 @@ rp_rdflsbuf(register struct rpdev *rp)
 	    */
 	    if (DVDEBUG(rp) & DVDBF_DATSHO)
 		rp_showbuf(rp, (unsigned char *)NULL, rp->rp_xfrvp, (int)totw, 0);
-	    wc = (*rp->rp_dv.dv_iobuf)(&rp->rp_dv, (int)totw, &vp);
+#if KLH10_DP_RING
+	    if (totw < rp->rp_xfrpre && !rp->rp_reserr)
+		rp->rp_reserr = 1;	/* Batch stopped behind channel */
+#endif
+	    wc = (*rp->rp_dv.dv_iobuf)(&rp->rp_dv,	/* Less any done */
+		(totw > rp->rp_xfrpre ? (int)(totw - rp->rp_xfrpre) : 0), &vp);
 
 	} else {
 	    /* Indirect transfer, must copy from buffer into 10's memory.
@@ -2124,13 +2749,9 @@ rp_rdflsbuf(register struct rpdev *rp)
 					) {
 	/* Yup, at least one sector's worth. */
 	rp->rp_isdirect = TRUE;
-	wc = (wc < bwcnt) ? wc : bwcnt;		/* Truncate if needed */
-	wc = (wc / rp->rp_dcf.dcf_nwds);	/* Find # sectors */
+	totw = (wc < bwcnt) ? wc : bwcnt;	/* Truncate if needed */
+	wc = (totw / rp->rp_dcf.dcf_nwds);	/* Find # sectors */
 	rp->rp_xfrvp = vp;			/* Remember loc reading into */
-
-#if KLH10_DEV_DPRPXX
-	rp->rp_sdprp->dprp_phyadr = vp - vm_physmap(0);
-#endif
 	if (DVDEBUG(rp))
 	    fprintf(DVDBF(rp), "[RP rddir: %d sec, %ld -> %#lo]\r\n",
 			wc, (long)rp->rp_blkadr, (long)(vp - vm_physmap(0)));
@@ -2144,7 +2765,12 @@ rp_rdflsbuf(register struct rpdev *rp)
 	*/
 	rp->rp_isdirect = FALSE;
 	bwcnt = (rp->rp_bufwds < bwcnt) ? rp->rp_bufwds : bwcnt;
+	totw = bwcnt;
 	wc = (bwcnt / rp->rp_dcf.dcf_nwds);	/* Find # sectors */
+#if KLH10_DP_RING
+	if (!RP_ISTHR(rp))
+	    (void) rp_dpqreq(rp, (size_t)bwcnt * sizeof(w10_t));
+#endif
 	vp = (vmptr_t) rp->rp_buff;		/* Pointer to buffer */
 
 	if (DVDEBUG(rp))
@@ -2153,10 +2779,14 @@ rp_rdflsbuf(register struct rpdev *rp)
     }
 
 #if KLH10_DEV_DPRPXX
-    rp->rp_sdprp->dprp_scnt = wc;
-    rp->rp_sdprp->dprp_daddr = rp->rp_blkadr;
-    rp_dpcmd(rp, (rp->rp_isdirect ? DPRP_RDDMA : DPRP_READ),
-					(size_t)0 /* wc*128*sizeof(w10_t) */);
+    if (!rp->rp_isdirect)
+	rp_dpio(rp, DPRP_READ, wc, (vmptr_t)NULL);
+# if KLH10_DP_RING
+    else if (!RP_ISTHR(rp))
+	rp_dpqdma(rp, DPRP_RDDMA, (int)totw, vp);
+# endif
+    else
+	rp_dpio(rp, DPRP_RDDMA, wc, vp);
 # if 0
     dp_xswait(&(rp->rp_dp.dp_adr->dpc_todp));	/* Synch hack */
 # endif
@@ -2197,4 +2827,83 @@ rp_showbuf(register struct rpdev *rp,
     }
 }
 
+#if KLH10_CKPT
+
+/* Checkpoint/restore.
+**	Only the drive registers and transfer state are saved; the pack
+**	itself is whatever is mounted now, which must be the same one,
+**	unchanged since the checkpoint.  No operation may be in progress.
+*/
+static int
+rp_ckbusy(register struct rpdev *rp)
+{
+#if KLH10_DEV_DPRPXX
+    return rp->rp_state == RPXX_ST_BUSY;
+#else
+    return rp->rp_iotmr && rp->rp_iotmr->cke_state == CLKENT_ST_MTICK;
+#endif
+}
+
+static int
+rpxx_ckpt(struct device *d, struct ckpt_s *ck)
+{
+    register struct rpdev *rp = (struct rpdev *)d;
+
+    if (rp_ckbusy(rp)) {
+	fprintf(ckp_outf(ck), "%s busy\n", rp->rp_dv.dv_name);
+	return FALSE;
+    }
+    return ckp_put(ck, rp, sizeof(*rp));
+}
+
+static int
+rpxx_ckrest(struct device *d, struct ckpt_s *ck, int dorest)
+{
+    register struct rpdev *rp = (struct rpdev *)d;
+    register struct rpdev *s;
+
+    if (!(s = (struct rpdev *)ckp_get(ck, sizeof(*s))))
+	return FALSE;
+    if (s->rp_totsecs != rp->rp_totsecs || s->rp_fmt != rp->rp_fmt) {
+	fprintf(ckp_outf(ck), "%s drive config differs from checkpoint\n",
+		rp->rp_dv.dv_name);
+	return FALSE;
+    }
+    if (rp_ckbusy(rp))
+	return FALSE;
+    if (!dorest) {
+	if (strcmp(s->rp_spath, rp->rp_spath) != 0)
+	    fprintf(ckp_outf(ck), "Warning: %s had \"%s\" mounted, now \"%s\"\n",
+		rp->rp_dv.dv_name, s->rp_spath, rp->rp_spath);
+	return TRUE;
+    }
+
+    rp->rp_dv.dv_pireq = s->rp_dv.dv_pireq;
+    rp->rp_bit = s->rp_bit;
+    rp->rp_scmd = s->rp_scmd;
+    memcpy((char *)rp->rp_reg, (char *)s->rp_reg, sizeof(rp->rp_reg));
+    rp->rp_blkcnt = s->rp_blkcnt;
+    rp->rp_xfrcnt = s->rp_xfrcnt;
+    rp->rp_blkwds = s->rp_blkwds;
+    rp->rp_blklim = s->rp_blklim;
+    rp->rp_cyl = s->rp_cyl;
+    rp->rp_trk = s->rp_trk;
+    rp->rp_sec = s->rp_sec;
+    rp->rp_blkadr = s->rp_blkadr;
+    rp->rp_isdirect = s->rp_isdirect;
+    rp->rp_xfrvp = ckp_vmptr(ck, s->rp_xfrvp);
+#if !KLH10_DEV_DPRPXX
+    rp->rp_rescnt = s->rp_rescnt;
+    rp->rp_reserr = s->rp_reserr;
+#endif
+#if KLH10_RP_THREAD
+    if (RP_ISTHR(rp)) {		/* Drive status as the 10 last saw it */
+	rp->rp_thrmol = s->rp_thrmol;
+	rp->rp_thrwrl = s->rp_thrwrl;
+    }
+#endif
+    return TRUE;
+}
+#endif /* KLH10_CKPT */
+
 #endif /* KLH10_DEV_RPXX */
@@ -60,6 +60,9 @@ static int decosfcclossage;
 #include "dvuba.h"
 #include "dvtm03.h"
 #include "prmstr.h"
+#if KLH10_CKPT
+# include "kn10ckp.h"
+#endif
 
 #if KLH10_DEV_DPTM03
 # include "dpsup.h"	/* Using device subproc! */
@@ -225,6 +228,10 @@ static void tm03_powoff(struct device *d);
 static void tm03_reset(struct device *d);
 static uint32 tm03_rdreg(struct device *d, int reg);
 static int  tm03_wrreg(struct device *d, int reg, unsigned int val);
+#if KLH10_CKPT
+static int  tm03_ckpt(struct device *d, struct ckpt_s *ck);
+static int  tm03_ckrest(struct device *d, struct ckpt_s *ck, int dorest);
+#endif
 #if KLH10_DEV_DPTM03
 static void tm03_run(struct tmdev *tm);
 static void tm03_evhsdon(struct device *d, struct dvevent_s *evp);
@@ -495,6 +502,10 @@ dvtm03_create(FILE *f, char *s)
     tm->tm_dv.dv_wrreg  = tm03_wrreg;
     tm->tm_dv.dv_powoff = tm03_powoff;
     tm->tm_dv.dv_mount  = tm03_mount;
+#if KLH10_CKPT
+    tm->tm_dv.dv_ckpt   = tm03_ckpt;
+    tm->tm_dv.dv_ckrest = tm03_ckrest;
+#endif
 
     /* TM-specific stuff */
 
@@ -2472,4 +2483,55 @@ tm_space(register struct tmdev *tm, int revf)
 #endif /* !KLH10_DEV_DPTM03 */
 }
 
+#if KLH10_CKPT
+
+/* Checkpoint/restore.
+**	Only the formatter registers and slave settings are restored.
+**	The tape is not repositioned, so the 10 will see it wherever the
+**	current mount left it.
+*/
+static int
+tm03_ckpt(struct device *d, struct ckpt_s *ck)
+{
+    register struct tmdev *tm = (struct tmdev *)d;
+
+#if KLH10_DEV_DPTM03
+    if (tm->tm_state == TM03_ST_BUSY) {
+	fprintf(ckp_outf(ck), "%s busy\n", tm->tm_dv.dv_name);
+	return FALSE;
+    }
+#endif
+    return ckp_put(ck, tm, sizeof(*tm));
+}
+
+static int
+tm03_ckrest(struct device *d, struct ckpt_s *ck, int dorest)
+{
+    register struct tmdev *tm = (struct tmdev *)d;
+    register struct tmdev *s;
+
+    if (!(s = (struct tmdev *)ckp_get(ck, sizeof(*s))))
+	return FALSE;
+    if (s->tm_typ != tm->tm_typ || s->tm_styp != tm->tm_styp)
+	return FALSE;
+    if (!dorest)
+	return TRUE;
+
+    fprintf(ckp_outf(ck), "Note: %s tape position not restored\n",
+		tm->tm_dv.dv_name);
+    tm->tm_dv.dv_pireq = s->tm_dv.dv_pireq;
+    memcpy((char *)tm->tm_reg, (char *)s->tm_reg, sizeof(tm->tm_reg));
+    tm->tm_bit = s->tm_bit;
+    tm->tm_wc = s->tm_wc;
+    tm->tm_vp = ckp_vmptr(ck, s->tm_vp);
+    tm->tm_slv = s->tm_slv;
+    tm->tm_sfmt = s->tm_sfmt;
+    tm->tm_sfpw = s->tm_sfpw;
+    tm->tm_sden = s->tm_sden;
+    tm->tm_srew = s->tm_srew;
+    tm->tm_scmd = s->tm_scmd;
+    return TRUE;
+}
+#endif /* KLH10_CKPT */
+
 #endif /* KLH10_DEV_TM03 */
@@ -363,6 +363,128 @@ cbpget(register struct canbp *bp, register vaddr_t e, int inc)
     return TRUE;
 }
 #endif /* KLH10_USE_CANBP */
+
+#if KLH10_BPCACHE
+
+/* Byte pointer cache, see kn10def.h.
+**	ILDB and IDPB first try BPC_INC, which only needs the BP word to be
+** unchanged since it was last stored.  If the increment stays within
+** the same word, or moves to the next word of the same page, the
+** cached host pointer is used with no remapping and no BP decoding.
+** Anything else is a miss and goes the normal way, after which
+** BPC_FILL remembers the result for next time.
+*/
+#define bpc_ent(e) (&cpu.bpcache[va_insect(e) & BPCACHE_MASK])
+
+/* BPC_INC - Increment BP at E from the cache if possible.
+**	ACC is the access needed for the byte's word (VMF_READ/VMF_WRITE).
+**	On a hit, stores the new BP, sets P and S, and returns host pointer
+**	to the byte's word.  On a miss returns NULL having changed nothing.
+*/
+static vmptr_t
+bpc_inc(register vaddr_t e, int acc, int *pp, int *sp)
+{
+    register struct bpcent *bc = bpc_ent(e);
+    register w10_t w;
+    register vmptr_t vp;
+    register int p;
+
+    if (bc->bc_gen != cpu.mr_bpgen || bc->bc_e != e
+      || !(bc->bc_acc & acc) || cpu.mr_inpxct)
+	goto miss;
+    w = vm_pget(bc->bc_bpvp);
+    if (op10m_camn(w, bc->bc_w))	/* BP changed since we stored it? */
+	goto miss;
+    vp = bc->bc_vp;
+
+#if KLH10_EXTADR
+    if (bc->bc_ps) {			/* OWGBP */
+	register struct owgbpe *tp = &owgbptab[bc->bc_ps - 37];
+
+	if (tp->pands > tp->pnext) {	/* Going to next word? */
+	    if (bc->bc_left <= 0)
+		goto miss;
+	    op10m_inc(w);		/* Bump the address */
+	    ++vp, --bc->bc_left;
+	}
+	tp = &owgbptab[tp->pnext - 37];	/* Find next P&S stuff */
+	op10m_tlz(w, 0770000);
+	op10m_tlo(w, (h10_t)(tp->pands) << 12);
+	bc->bc_ps = tp->pands;
+	*pp = tp->p;
+	*sp = tp->s;
+    } else
+#endif
+    {					/* One-word local BP, no I or X */
+	if ((p = bc->bc_p - bc->bc_s) < 0) {
+	    if (bc->bc_left <= 0)
+		goto miss;
+	    p = (W10BITS - bc->bc_s) & 077;	/* Moving to next word */
+	    RHSET(w, (RHGET(w)+1)&H10MASK);
+	    ++vp, --bc->bc_left;
+	}
+	op10m_tlz(w, 0770000);
+	op10m_tlo(w, ((h10_t)(p) << 12));
+	bc->bc_p = *pp = p;
+	*sp = bc->bc_s;
+    }
+    vm_pset(bc->bc_bpvp, w);		/* Store updated BP */
+    bc->bc_w = w;
+    bc->bc_vp = vp;
+    ++cpu.mr_bphits;
+    return vp;
+
+  miss:
+    ++cpu.mr_bpmiss;
+    return NULL;
+}
+
+/* BPC_FILL - Remember a BP just incremented and used the slow way.
+**	E is where the BP lives; P, S, and Y are what it decoded to.
+**	Nothing is cached unless both words can be mapped without a fault
+**	and the BP is one of the simple forms.
+*/
+static void
+bpc_fill(vaddr_t e, int p, int s, vaddr_t y, int acc)
+{
+    register struct bpcent *bc;
+    register vmptr_t bpvp, vp;
+    register w10_t w;
+    register int ps;
+
+    if (cpu.mr_inpxct
+      || va_insect(e) <= AC_17 || va_insect(y) <= AC_17)
+	return;
+    if (!(bpvp = vm_xtrymap(e, VMF_WRITE, cpu.acblk.xrw, cpu.vmap.xrw))
+      || !(vp = vm_xtrymap(y, acc, cpu.acblk.xbrw, cpu.vmap.xbrw)))
+	return;
+    w = vm_pget(bpvp);
+    ps = LHGET(w) >> 12;
+#if KLH10_EXTADR
+    if (ps > 36) {			/* OWGBP */
+	if (ps >= 63)
+	    return;
+    } else
+#endif
+    {
+	if ((LHGET(w) & 077)		/* I, X, or 2-word flag set? */
+	  || ps != p || s <= 0 || s > W10BITS)
+	    return;
+	ps = 0;
+    }
+    bc = bpc_ent(e);
+    bc->bc_gen = cpu.mr_bpgen;
+    bc->bc_e = e;
+    bc->bc_w = w;
+    bc->bc_bpvp = bpvp;
+    bc->bc_vp = vp;
+    bc->bc_acc = acc;
+    bc->bc_left = (PAG_SIZE-1) - va_pagoff(y);
+    bc->bc_ps = ps;
+    bc->bc_p = p;
+    bc->bc_s = s;
+}
+#endif /* KLH10_BPCACHE */
 
 insdef(i_adjbp);	/* Forward decl for adjbp */
 
@@ -402,9 +524,11 @@ insdef(i_ibp)
 insdef(i_ldb)
 {
 # define LDBMACRO(p, s, y) \
+    LDBVPMACRO(p, s, vm_xbrwmap(y, VMF_READ))	/* Fetch word (byte map) */
+# define LDBVPMACRO(p, s, vp) \
   {			\
     register w10_t w;	\
-    w = vm_pget(vm_xbrwmap(y, VMF_READ));	/* Fetch word (byte map) */\
+    w = vm_pget(vp);		/* Fetch word */\
     op10m_rshift(w, p);		/* Shift word to right-align byte */\
     op10m_and(w, wbytemask[s]);	/* Mask out byte */\
     ac_set(ac, w);		/* Store byte in AC */\
@@ -432,6 +556,20 @@ insdef(i_ldb)
 
 insdef(i_ildb)
 {
+#if KLH10_BPCACHE
+    register int bpcfill;	/* TRUE to cache BP after slow path */
+
+    if ((bpcfill = !PCFTEST(PCF_FPD))) {
+	register vmptr_t bvp;
+	int p, s;
+
+	if ((bvp = bpc_inc(e, VMF_READ, &p, &s)) != NULL) {
+	    LDBVPMACRO(p, s, bvp)	/* Cache hit, BP already bumped */
+	    return PCINC_1;
+	}
+    }
+#endif
+  {
 #if KLH10_USE_CANBP
     struct canbp cbp;
 
@@ -439,6 +577,10 @@ insdef(i_ildb)
     if (!cbpget(&cbp, e, PCFTEST(PCF_FPD) ? 0 : 1))
 	return i_muuo(op, ac, e);
     LDBMACRO(cbp.p, cbp.s, cbp.y)	/* Invoke shared LDB code */
+# if KLH10_BPCACHE
+    if (bpcfill)
+	bpc_fill(e, cbp.p, cbp.s, cbp.y, VMF_READ);
+# endif
 
 #else
 
@@ -455,8 +597,13 @@ insdef(i_ildb)
       register vaddr_t y = ea_bpcalc(bp);	/* Find BP's E (special map) */
 
       LDBMACRO(p, s, y)		/* Now do the LDB into AC */
+# if KLH10_BPCACHE
+      if (bpcfill)
+	  bpc_fill(e, p, s, y, VMF_READ);
+# endif
     }
 #endif
+  }
 
     PCFCLEAR(PCF_FPD);		/* Won, clear flag */
     return PCINC_1;
@@ -466,12 +613,14 @@ insdef(i_ildb)
 insdef(i_dpb)
 {
 #define DPBMACRO(p, s, y) \
+    DPBVPMACRO(p, s, vm_xbrwmap(y, VMF_WRITE))	/* Use special byte data map */
+#define DPBVPMACRO(p, s, vp) \
   {		\
     register w10_t w;		\
     register w10_t bmask, byte;	\
     register vmptr_t bvp;	\
 				\
-    bvp = vm_xbrwmap(y, VMF_WRITE);	/* Use special byte data map */\
+    bvp = (vp);			\
     byte = ac_get(ac);		/* Fetch source byte */\
     bmask = wbytemask[s];	/* Get & shift byte-sized mask */\
     op10m_lshift(bmask, p);	\
@@ -506,6 +655,20 @@ insdef(i_dpb)
 
 insdef(i_idpb)
 {
+#if KLH10_BPCACHE
+    register int bpcfill;	/* TRUE to cache BP after slow path */
+
+    if ((bpcfill = !PCFTEST(PCF_FPD))) {
+	register vmptr_t vp;
+	int p, s;
+
+	if ((vp = bpc_inc(e, VMF_WRITE, &p, &s)) != NULL) {
+	    DPBVPMACRO(p, s, vp)	/* Cache hit, BP already bumped */
+	    return PCINC_1;
+	}
+    }
+#endif
+  {
 #if KLH10_USE_CANBP
     struct canbp cbp;
 
@@ -513,6 +676,10 @@ insdef(i_idpb)
     if (!cbpget(&cbp, e, PCFTEST(PCF_FPD) ? 0 : 1))
 	return i_muuo(op, ac, e);
     DPBMACRO(cbp.p, cbp.s, cbp.y)	/* Invoke code shared with DPB */
+# if KLH10_BPCACHE
+    if (bpcfill)
+	bpc_fill(e, cbp.p, cbp.s, cbp.y, VMF_WRITE);
+# endif
 #else
 
     register vmptr_t vp = vm_modmap(e);	/* Get pointer to BP, normal mapping */
@@ -528,8 +695,13 @@ insdef(i_idpb)
       register vaddr_t y = ea_bpcalc(bp);	/* Find BP's E (special map) */
 
       DPBMACRO(p, s, y)		/* Do the DPB from AC */
+# if KLH10_BPCACHE
+      if (bpcfill)
+	  bpc_fill(e, p, s, y, VMF_WRITE);
+# endif
     }
 #endif
+  }
     PCFCLEAR(PCF_FPD);		/* Won, clear flag */
     return PCINC_1;
 }
@@ -283,9 +283,9 @@ insdef(i_extend)
     /* Default section for 2nd instr word EA calc is the section 
     ** that word was fetched from.
     */
-    return (*opcxrtn[xop])(xop, ac, e, xea_calc(xw, va_sect(e)));
+    return opx_xct(xop, ac, e, xea_calc(xw, va_sect(e)));
 #else
-    return (*opcxrtn[xop])(xop, ac, e, ea_calc(xw));
+    return opx_xct(xop, ac, e, ea_calc(xw));
 #endif
 }
 
@@ -392,12 +392,11 @@ ac_32set(int ac, uint32 val)
 **	On the KS10 there is only section 0, so this always traps as a
 **	MUUO on that machine.  Assume single-section KL similar.
 **
-** This is a straightforward implementation and there are several
-** ways to optimize it:
-**	- Separate loops for forward and reverse BLTs
-**	- Test for 32-bit count and optimize in register
-**	- Test for src -> src+1 and avoid re-reading value if mappings same.
-**	- Test for within-mem-page BLTs and break into memcpy segments.
+** Words are moved a page run at a time with vm_blkmove/vm_blkmovr,
+** which handle overlap (including src -> src+1 propagation) exactly as
+** a word-by-word move would.  Faults and interrupts can only happen at
+** the start of a run, so the ACs are always left as the word-by-word
+** version would leave them.
 **
 ** Note: for PXCT, source uses XBEA mapping, dest uses XBRW.
 **	These correspond to PXCT AC bits 11 and 12 respectively.
@@ -411,6 +410,14 @@ ac_32set(int ac, uint32 val)
 **	the KL ucode worked.
 */
 
+/* XBLT_DNLEFT - # words from va down to the start of its page, for a
+**	descending run.  Page 0 of a section is done a word at a time,
+**	so runs never reach the ACs.
+*/
+#define xblt_dnleft(va) \
+	((vm_pagleft(va) == 1 || (va_insect(va) & ~PAG_MASK) == 0) \
+	 ? 1 : (int)va_pagoff(va) + 1)
+
 xinsdef(ix_xblt)
 {
     register vaddr_t src, dst;
@@ -445,16 +452,25 @@ xinsdef(ix_xblt)
 
 	/* Do normal forward transfer */
 	for (;;) {
+	    register int n;
+
 	    if ( !(svp = vm_xbeamap(src, VMF_READ|VMF_NOTRAP))
 	      || !(dvp = vm_xbrwmap(dst, VMF_WRITE|VMF_NOTRAP))) {
 		res = RES_PF;
 		break;
 	    }
-	    vm_pset(dvp, vm_pget(svp));	/* Transfer the word */
+	    if ((n = vm_pagleft(src)) > vm_pagleft(dst))
+		n = vm_pagleft(dst);
+	    if ((uint32)n > cnt)
+		n = (int)cnt;
+	    if (n > 1)
+		n = vm_blkmove(dvp, svp, n);	/* Transfer a run */
+	    else
+		vm_pset(dvp, vm_pget(svp));	/* Transfer the word */
 
-	    va_ginc(src);		/* Bump addrs up */
-	    va_ginc(dst);
-	    if (--cnt == 0)		/* Bump count down, see if done */
+	    va_gadd(src, n);		/* Bump addrs up */
+	    va_gadd(dst, n);
+	    if ((cnt -= n) == 0)	/* Bump count down, see if done */
 		break;			/* stop loop! */
 
 	    /* Done with one iteration, now check before doing next */
@@ -485,6 +501,8 @@ xinsdef(ix_xblt)
 
 	/* Do reverse transfer */
 	for (;;) {
+	    register int n;
+
 	    va_gdec(src);		/* Bump addrs down */
 	    va_gdec(dst);
 
@@ -493,9 +511,18 @@ xinsdef(ix_xblt)
 		res = RES_PF;
 		break;
 	    }
-	    vm_pset(dvp, vm_pget(svp));	/* Transfer the word */
+	    if ((n = xblt_dnleft(src)) > xblt_dnleft(dst))
+		n = xblt_dnleft(dst);
+	    if (n > -cnt)
+		n = -cnt;
+	    if (n > 1)
+		n = vm_blkmovr(dvp, svp, n);	/* Transfer a run */
+	    else
+		vm_pset(dvp, vm_pget(svp));	/* Transfer the word */
+	    va_gadd(src, -(n-1));	/* Leave addrs at last word moved */
+	    va_gadd(dst, -(n-1));
 
-	    if (++cnt >= 0)		/* Bump count up; if gone, */
+	    if ((cnt += n) >= 0)	/* Bump count up; if gone, */
 		break;			/* stop loop! */
 
 	    /* Done with one iteration, now check before doing next */
@@ -1226,6 +1253,181 @@ xadjbp(register struct cleanbp *bp,
     }
     return RES_OK;
 }
+
+/* Bulk string auxiliaries.
+**	Once a BP has used up its current word (P < S), the following
+** bytes are all whole words until the string ends.  If the other BP is
+** also at a word boundary with the same byte size, the strings are in
+** phase and can be handled a word at a time: all the bytes of a word
+** are moved, filled, or compared together using a mask covering just
+** the byte bits, so any unused low-order bits of the destination are
+** left alone exactly as the byte-at-a-time code would.
+**	A bulk step never goes past the end of a page on either side, and
+** only uses words that could be mapped without trapping.  Anything
+** else (indirect BPs, odd sizes, page boundaries, page faults) is left
+** to the normal per-byte code, which is also where all faults and
+** interrupts happen, so the ACs are always left exactly as before.
+** Each step is at most one page, and callers poll between steps.
+*/
+
+/* XBULKBPW - Bytes per word if BP can be used for a bulk step, else 0 */
+#define xbulkbpw(bp) \
+    (((bp)->p < (bp)->s && !(bp)->isindir && (bp)->s > 0	\
+      && (bp)->s <= W10BITS) ? (W10BITS / (bp)->s) : 0)
+
+/* XBULKVP - Map next word for a bulk step.
+**	Limits *NP to the # of words left in that page and returns
+**	host pointer, or NULL if it can't be mapped without a trap.
+**	Uses the same maps as XILDB (read) and XIDPB (write).
+*/
+static vmptr_t
+xbulkvp(register struct cleanbp *bp, int32 *np, int acc)
+{
+    register vaddr_t y = bp->y;
+    register int left;
+
+    va_inc(y);			/* Word after current one */
+    if ((left = vm_pagleft(y)) < *np)
+	*np = left;
+    return (acc == VMF_WRITE)
+	? vm_xbrwmap(y, VMF_WRITE|VMF_NOTRAP)
+	: vm_xbeamap(y, VMF_READ|VMF_NOTRAP);
+}
+
+/* XBULKADV - Advance BP over N whole words (N > 0) just done in bulk.
+**	P is left pointing at the last byte of the last word, same as the
+**	byte code would leave it.
+*/
+static void
+xbulkadv(register struct cleanbp *bp, int32 n, int bpw)
+{
+    va_inc(bp->y);
+    if (--n > 0)
+	va_add(bp->y, n);
+    bp->ycnt += n + 1;
+    bp->p = W10BITS - (bpw * bp->s);
+    bp->vp = NULL;
+}
+
+/* XBULKMASK - Mask for the BPW bytes of size S in a word */
+static w10_t
+xbulkmask(int bpw, int s)
+{
+    register w10_t mask;
+
+    mask = wbytemask[bpw * s];
+    op10m_lshift(mask, W10BITS - (bpw * s));
+    return mask;
+}
+
+/* XBULKMOVE - Move whole words of bytes from S1 to S2.
+**	NBYTES is the most that may be moved.  Returns # bytes moved,
+**	which is 0 if the BPs are not both set up for it.
+**	Words are done strictly in ascending order, so overlapping strings
+**	behave as they would a byte at a time.
+*/
+static int32
+xbulkmove(register struct cleanbp *s1, register struct cleanbp *s2,
+	  int32 nbytes)
+{
+    register vmptr_t vp1, vp2;
+    register w10_t w, w2, mask;
+    register int32 i;
+    int32 n;
+    int bpw;
+
+    if (!(bpw = xbulkbpw(s1)) || s1->s != s2->s || !xbulkbpw(s2)
+      || (n = nbytes / bpw) <= 0
+      || !(vp1 = xbulkvp(s1, &n, VMF_READ))
+      || !(vp2 = xbulkvp(s2, &n, VMF_WRITE)))
+	return 0;
+
+    mask = xbulkmask(bpw, s1->s);
+    for (i = n; --i >= 0; ++vp1, ++vp2) {
+	w = vm_pget(vp1);		/* Source bytes */
+	op10m_and(w, mask);
+	w2 = vm_pget(vp2);		/* Dest word, keep unused bits */
+	op10m_andcm(w2, mask);
+	op10m_ior(w2, w);
+	vm_pset(vp2, w2);
+    }
+    xbulkadv(s1, n, bpw);
+    xbulkadv(s2, n, bpw);
+    return n * bpw;
+}
+
+/* XBULKFILL - Fill whole words of S2 with byte FILL.
+**	Returns # bytes stored, at most NBYTES.
+*/
+static int32
+xbulkfill(register struct cleanbp *s2, w10_t fill, int32 nbytes)
+{
+    register vmptr_t vp2;
+    register w10_t w, mask, pat;
+    register int32 i;
+    int32 n;
+    int bpw;
+
+    if (!(bpw = xbulkbpw(s2))
+      || (n = nbytes / bpw) <= 0
+      || !(vp2 = xbulkvp(s2, &n, VMF_WRITE)))
+	return 0;
+
+    op10m_and(fill, s2->bmsk);		/* Build word of fill bytes */
+    op10m_setz(pat);
+    for (i = bpw; --i >= 0; ) {
+	op10m_lshift(pat, s2->s);
+	op10m_ior(pat, fill);
+    }
+    op10m_lshift(pat, W10BITS - (bpw * s2->s));
+    mask = xbulkmask(bpw, s2->s);
+
+    for (i = n; --i >= 0; ++vp2) {
+	w = vm_pget(vp2);
+	op10m_andcm(w, mask);
+	op10m_ior(w, pat);
+	vm_pset(vp2, w);
+    }
+    xbulkadv(s2, n, bpw);
+    return n * bpw;
+}
+
+/* XBULKCMP - Skip over whole words of S1 and S2 that compare equal.
+**	Stops before the first word that differs, leaving that word for
+**	the byte code to find the differing byte in.
+**	Returns # bytes skipped, at most NBYTES.
+*/
+static int32
+xbulkcmp(register struct cleanbp *s1, register struct cleanbp *s2,
+	 int32 nbytes)
+{
+    register vmptr_t vp1, vp2;
+    register w10_t w1, w2, mask;
+    register int32 i;
+    int32 n;
+    int bpw;
+
+    if (!(bpw = xbulkbpw(s1)) || s1->s != s2->s || !xbulkbpw(s2)
+      || (n = nbytes / bpw) <= 0
+      || !(vp1 = xbulkvp(s1, &n, VMF_READ))
+      || !(vp2 = xbulkvp(s2, &n, VMF_READ)))
+	return 0;
+
+    mask = xbulkmask(bpw, s1->s);
+    for (i = 0; i < n; ++i, ++vp1, ++vp2) {
+	w1 = vm_pget(vp1);
+	w2 = vm_pget(vp2);
+	op10m_xor(w1, w2);
+	op10m_and(w1, mask);
+	if (op10m_skipn(w1))		/* Any byte differ? */
+	    break;
+    }
+    if (i <= 0)
+	return 0;
+    xbulkadv(s1, i, bpw);
+    xbulkadv(s2, i, bpw);
+    return i * bpw;
+}
 
 /* MOVSLJ - Move String Left Justified		(EXTEND [016 ])
 **
@@ -1237,6 +1439,7 @@ xadjbp(register struct cleanbp *bp,
 xinsdef(ix_movslj)
 {
     register int32 len1, len2;	/* Note signed */
+    int32 n;
     register vaddr_t va;
     struct cleanbp s1, s2;
     w10_t wbyte;
@@ -1273,6 +1476,8 @@ xinsdef(ix_movslj)
 		    ++len2;
 		    break;
 		}
+		if (len2 > 0)		/* Whole words of fill if possible */
+		    len2 -= xbulkfill(&s2, wfill, len2);
 	    } while (--len2 >= 0);
 	    break;	/* Return, either won or page-failed */
 	}
@@ -1300,6 +1505,10 @@ xinsdef(ix_movslj)
 	    res = RES_PI;
 	    break;
 	}
+
+	/* If both BPs are now at a word boundary, move whole words */
+	if ((n = xbulkmove(&s1, &s2, (len1 < len2 ? len1 : len2))) > 0)
+	    len1 -= n, len2 -= n;
     }
 
     /* Done, update ACs and return appropriate PC increment
@@ -1610,6 +1819,8 @@ xinsdef(ix_movsrj)
 		res = RES_PI;
 		break;
 	    }
+	    /* Whole words of fill if possible, leaving the last byte */
+	    len2 -= xbulkfill(&s2, wfill, len2 - len1 - 1);
 	}
     } else if (len1 > len2) {
 	/* Source too big, skip over source bytes before starting copy */
@@ -1639,6 +1850,8 @@ xinsdef(ix_movsrj)
 		res = RES_PI;
 		break;
 	    }
+	    /* Whole words if possible, leaving the last byte */
+	    len2 -= xbulkmove(&s1, &s2, len2 - 1);
 	}
 	len1 = len2;			/* Update len1 to match len2 */
     }
@@ -1697,6 +1910,7 @@ xinsdef(ix_cmps)		/* Do all CMPSx instructions */
     register w10_t fill;
     enum xires res = RES_OK;
     register int cmpf;
+    int32 n;
 
     /* Set up string lengths. */
     AC_32GET(len1, ac, 0, 0777000);	/* Get source len */
@@ -1775,6 +1989,11 @@ xinsdef(ix_cmps)		/* Do all CMPSx instructions */
 	    res = RES_PI;
 	    break;
 	}
+
+	/* If both BPs are now at a word boundary, skip equal words */
+	if (len1 > 0 && len2 > 0
+	  && (n = xbulkcmp(&s1, &s2, (len1 < len2 ? len1 : len2))) > 0)
+	    len1 -= n, len2 -= n;
     }
 
     /* Return result after updating ACs */
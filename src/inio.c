@@ -196,7 +196,9 @@ enum {	/* Low 3 bits of AC in Dev-IO instr are the IO opcode dispatch */
 ** careful about resolving their memory ref *prior* to doing I/O or the
 ** data will be lost if a page fault happens.
 */
+#if !KLH10_MULTI
 extern struct device *devtab[128];	/* From kn10dev.c */
+#endif
 
 insdef(i_diodisp)
 {
@@ -140,7 +140,7 @@ insdef(i_jrst)
 {
     switch (ac) {
     case 0:				/* JRST */
-	PC_JUMP(e);
+	PC_LOOPJUMP(e);
 	return PCINC_0;
 
 #if !KLH10_SYS_ITS
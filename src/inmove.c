@@ -22,6 +22,8 @@
  *
  */
 
+#include <string.h>	/* For memset */
+
 #include "klh10.h"
 #include "kn10def.h"	/* Machine defs */
 #include "kn10ops.h"	/* PDP-10 ops */
@@ -394,7 +396,8 @@ insdef(i_blt)
 {
     register int32 cnt;		/* Note signed */
     register vaddr_t src, dst;
-    register vmptr_t vp;
+    register vmptr_t vp = NULL;	/* Init only to keep gcc -Wall quiet */
+    register int n;		/* # words in current page run */
 
 #if KLH10_EXTADR
     src = dst = e;			/* E sets default section & l/g flag */
@@ -467,6 +470,9 @@ insdef(i_blt)
 	}
 	w = vm_pget(vp);		/* Get word, remember it */
 
+	/* Each pass fills the rest of the current destination page at
+	** once, so the mapping (and any page fault) is done per page.
+	*/
 	do {
 	    CLOCKPOLL();		/* Keep clock going */
 	    if (INSBRKTEST()) {		/* Watch for interrupt */
@@ -479,15 +485,29 @@ insdef(i_blt)
 			      va_insect(dst));
 		pag_fail();			/* Take page-fail trap */
 	    }
-	    vm_pset(vp, w);		/* Store word value */
-	    va_linc(src);		/* Do LOCAL increment of addrs! */
-	    va_linc(dst);
-	} while (--cnt >= 0);
+	    if ((n = vm_pagleft(dst)) > cnt+1)
+		n = cnt+1;
+	    if (n == 1)
+		vm_pset(vp, w);		/* Store word value */
+	    else if (op10m_skipe(w))
+		memset((char *)vp, 0, n * sizeof(*vp));
+	    else {
+		register int i = n;
+		do vm_pset(vp++, w);
+		while (--i > 0);
+	    }
+	    va_ladd(src, n);		/* Do LOCAL increment of addrs! */
+	    va_ladd(dst, n);
+	} while ((cnt -= n) >= 0);
     }
     else do {
 
-	/* Normal BLT transfer */
+	/* Normal BLT transfer, a page run at a time.  vm_blkmove() copes
+	** with overlap, and any fault happens at the first word of a run,
+	** so it is taken with the AC exactly as word-by-word would leave it.
+	*/
 	register vmptr_t rp;
+
 	CLOCKPOLL();			/* Keep clock going */
 	if (INSBRKTEST()) {		/* Watch for interrupt */
 	    ac_setlrh(ac, va_insect(src),	/* Oops, save AC */
@@ -501,11 +521,18 @@ insdef(i_blt)
 			  va_insect(dst));
 	    pag_fail();			/* Take page-fail trap */
 	}
-	vm_pset(vp, vm_pget(rp));	/* Copy directly from source */
-	va_linc(src);			/* Add 1 to both addrs */
-	va_linc(dst);			/* Again, LOCAL increment only */
-
-    } while (--cnt >= 0);
+	if ((n = vm_pagleft(src)) > vm_pagleft(dst))
+	    n = vm_pagleft(dst);
+	if (n > cnt+1)
+	    n = cnt+1;
+	if (n > 1)
+	    n = vm_blkmove(vp, rp, n);	/* Copy run directly from source */
+	else
+	    vm_pset(vp, vm_pget(rp));	/* Copy directly from source */
+	va_ladd(src, n);		/* Add n to both addrs */
+	va_ladd(dst, n);		/* Again, LOCAL increment only */
+
+    } while ((cnt -= n) >= 0);
 
 #if 0	/* No longer needed, code done inline to avoid this check */
     /* Broke out of loop, see if page-failed or not */
@@ -210,14 +210,14 @@ camskip(i_camg,  > , op10m_camg(a,b))
 #define testjump(name, relop, ifjump)	\
 	insdef(name)		\
 	{	register w10_t w; w = ac_get(ac); \
-		return ifjump ? (PC_JUMP(e), PCINC_0) : PCINC_1; \
+		return ifjump ? (PC_LOOPJUMP(e), PCINC_0) : PCINC_1; \
 	}
 
 insdef(i_jump) { return PCINC_1; }		/* No-op, never jumps */
 testjump(i_jumpl,  < , skiptestL)
 testjump(i_jumpe,  ==, skiptestE)
 testjump(i_jumple, <=, skiptestLE)
-insdef(i_jumpa) { return (PC_JUMP(e), PCINC_0); }	/* Always jumps */
+insdef(i_jumpa) { return (PC_LOOPJUMP(e), PCINC_0); }	/* Always jumps */
 testjump(i_jumpge, >=, skiptestGE)
 testjump(i_jumpn,  !=, skiptestN)
 testjump(i_jumpg,  > , skiptestG)
@@ -59,6 +59,8 @@
 #include "cmdline.h"
 #include "prmstr.h"
 #include "dvcty.h"	/* For cty_ functions */
+#include "kn10prf.h"	/* For pcp_ functions */
+#include "kn10ckp.h"	/* For ckp_ functions */
 
 #if KLH10_CPU_KS
 # include "dvuba.h"	/* So can get at device info */
@@ -246,6 +248,46 @@ CMDDEF(cd_devdbg,fc_devdbg,    CMRF_TLIN,
 CMDDEF(cd_devwait,fc_devwait,   CMRF_TLIN,
 			"[<devid>] [<secs>]",
 			"Wait for device (or all devs)", "")
+CMDDEF(cd_clkq,   fc_clkq,   CMRF_TLIN,	"[bench [<n>]]",
+			"Show clock timers, or time timer churn", "")
+#if KLH10_OPPROF
+CMDDEF(cd_opprof, fc_opprof, CMRF_TLIN,
+			"[on|cycles|off|reset|show [<n>]|dump <file>]",
+			"Control per-opcode execution profiling", "")
+#endif
+#if KLH10_IDLE
+CMDDEF(cd_idle,   fc_idle,   CMRF_TLIN,	"[on|off|clear|pc <addr> ...]",
+				"Control guest idle loop detection", "")
+#endif
+#if KLH10_PCPROF
+CMDDEF(cd_pcprof, fc_pcprof, CMRF_TLIN,
+	"[on|off|reset|show [<n>]|symbols <file> [exec|user]|flat <file>|folded <file>]",
+			"Control guest PC sampling profiler", "")
+#endif
+#if KLH10_BPCACHE
+CMDDEF(cd_bpcache,fc_bpcache, CMRF_TLIN,	"[reset]",
+				"Show byte pointer cache hit counts", "")
+#endif
+#if KLH10_EACHAIN
+CMDDEF(cd_eachain,fc_eachain, CMRF_TLIN,	"[reset]",
+				"Show indirect EA chain length counts", "")
+#endif
+#if KLH10_HOSTFP
+CMDDEF(cd_hostfp, fc_hostfp, CMRF_TLIN,	"[on|off|reset|test [<n>]]",
+			"Control host floating point engine", "")
+#endif
+#if KLH10_CKPT
+CMDDEF(cd_ckpt,   fc_ckpt,   CMRF_TOKS,	"<file>",
+			"Save entire machine state to checkpoint file", "")
+CMDDEF(cd_ckrest, fc_ckrest, CMRF_TOKS,	"<file>",
+			"Restore machine state from checkpoint file", "")
+CMDDEF(cd_clone,  fc_clone,  CMRF_TOKS,	"<file>",
+		"Restore, sharing checkpoint memory copy-on-write", "")
+#endif
+#if KLH10_PAG_TLB
+CMDDEF(cd_pagtlb, fc_pagtlb, CMRF_TLIN,	"[reset]",
+			"Show retained user page map counts", "")
+#endif
 #if KLH10_DEV_LITES
 CMDDEF(cd_lights,  fc_lights,   CMRF_TLIN,	"<hexaddr>|usb",
 				"Set console lights I/O base address", "")
@@ -288,6 +330,33 @@ KEYSBEGIN(fectbkeys)
 #endif
     KEYDEF("dev",	cd_dev_cmd)
     KEYDEF("devload",	cd_devload)
+    KEYDEF("clkq",	cd_clkq)
+#if KLH10_OPPROF
+    KEYDEF("opprof",	cd_opprof)
+#endif
+#if KLH10_IDLE
+    KEYDEF("idle",	cd_idle)
+#endif
+#if KLH10_PCPROF
+    KEYDEF("pcprof",	cd_pcprof)
+#endif
+#if KLH10_BPCACHE
+    KEYDEF("bpcache",	cd_bpcache)
+#endif
+#if KLH10_EACHAIN
+    KEYDEF("eachain",	cd_eachain)
+#endif
+#if KLH10_HOSTFP
+    KEYDEF("hostfp",	cd_hostfp)
+#endif
+#if KLH10_CKPT
+    KEYDEF("checkpoint",cd_ckpt)
+    KEYDEF("restore",	cd_ckrest)
+    KEYDEF("clone",	cd_clone)
+#endif
+#if KLH10_PAG_TLB
+    KEYDEF("pagtlb",	cd_pagtlb)
+#endif
 #if KLH10_DEV_LITES
     KEYDEF("lights",	cd_lights)
 #endif
@@ -349,9 +418,24 @@ pconfig(FILE *f)
 	    KLH10S_JPC
 	    KLH10S_DEBUG
 	    KLH10S_PCCACHE
+	    KLH10S_EACHAIN
+	    KLH10S_BPCACHE
+	    KLH10S_OPPROF
+	    KLH10S_PCPROF
+	    KLH10S_IDLE
+	    KLH10S_HOSTFP
+	    KLH10S_CKPT
+	    KLH10S_PAG_TLB
+	    KLH10S_MULTI
+	    KLH10S_CLK_WHEEL
+	    KLH10S_CLK_TIMERFD
+	    KLH10S_CLK_ADAPT
 	    KLH10S_CTYIO_INT
 	    KLH10S_IMPIO_INT
 	    KLH10S_EVHS_INT
+	    KLH10S_DP_MSEM
+	    KLH10S_DP_RING
+	    KLH10S_RP_THREAD
 	    );
 
     /* Show peripheral device drivers known at compile time */
@@ -1242,6 +1326,9 @@ klh10_init(void)
 
 
     op_init();		/* Initialize runtime opcode dispatch tables */
+#if KLH10_HOSTFP
+    op10hfpinit();	/* Check host FP, turn on engine if OK */
+#endif
 #if (KLH10_CPU_KS || KLH10_CPU_KL) && (KLH10_SYS_T10 || KLH10_SYS_T20)
   {
     extern void inexts_init(void);
@@ -1310,7 +1397,15 @@ mem_term(void)
     if (cpu.mm_shared) {
 	os_mmkill(cpu.mm_physegid, (char *)cpu.physmem);
 	cpu.mm_physegid = 0;
-    } else {
+    }
+#if KLH10_CKPT
+    else if (cpu.mm_mapped) {
+	os_fmunmap((char *)cpu.physmem,
+		   (size_t)PAG_SIZE * PAG_MAXPHYSPGS * sizeof(w10_t));
+	cpu.mm_mapped = FALSE;
+    }
+#endif
+    else {
 	free((char *)cpu.physmem);
     }
     cpu.physmem = NULL;
@@ -1355,38 +1450,47 @@ extern int tim_debug;	/* From kn10cpu.c */
 extern int ub_debug;	/* From dvuba.c */
 #endif
 
+/* Variable addresses in this table must be constant, so with KLH10_MULTI
+** they refer to the first machine, which is the one the FE runs.
+*/
+#if KLH10_MULTI
+# define FEMACH kn10_mach0
+#else
+# define FEMACH cpu
+#endif
+
 struct prmvar_s fecmvars[] = {
 #if KLH10_CPU_KL || KLH10_CPU_KS
     PRMVAR("serialno", "CPU serial number",
-				PRMVT_DEC, &cpu.mr_serialno,
+				PRMVT_DEC, &FEMACH.mr_serialno,
 							cmvp_serialno, NULL),
 #endif
     PRMVAR("sw", "Data switch word",
-				PRMVT_WRD, &cpu.mr_dsw, NULL, NULL),
+				PRMVT_WRD, &FEMACH.mr_dsw, NULL, NULL),
     PRMVAR("mem_lock", "Set on to attempt locking memory",
-				PRMVT_BOO, &cpu.mm_locked, cmvp_memlock, NULL),
+				PRMVT_BOO, &FEMACH.mm_locked, cmvp_memlock, NULL),
     PRMVAR("proc_pri", "CPU process priority",
 				PRMVT_DEC, &proc_pri, cmvp_setpri, NULL),
     PRMVAR("cpu_debug", "General CPU debug trace",
-				PRMVT_BOO, &cpu.mr_debug, NULL, NULL),
+				PRMVT_BOO, &FEMACH.mr_debug, NULL, NULL),
     PRMVAR("cpu_exsafe", "Enable exec mode safety halts",
-				PRMVT_OCT, &cpu.mr_exsafe, NULL, NULL),
+				PRMVT_OCT, &FEMACH.mr_exsafe, NULL, NULL),
     PRMVAR("fe_intchr", "KLH10 cmd escape char",
-				PRMVT_OCT, &cpu.fe.fe_intchr, NULL, NULL),
+				PRMVT_OCT, &FEMACH.fe.fe_intchr, NULL, NULL),
     PRMVAR("fe_prompt", "KLH10 cmd prompt",
 				PRMVT_STR, &cmdprompt, cmvp_prompt, NULL),
     PRMVAR("fe_runenable", "Enable running KN10 during KLH10 cmd processing",
-				PRMVT_BOO, &cpu.fe.fe_runenable, NULL, NULL),
+				PRMVT_BOO, &FEMACH.fe.fe_runenable, NULL, NULL),
     PRMVAR("fe_debug", "FE debug trace",
-				PRMVT_BOO, &cpu.fe.fe_debug, NULL, NULL),
+				PRMVT_BOO, &FEMACH.fe.fe_debug, NULL, NULL),
     PRMVAR("cty_debug", "CTY debug trace",
-				PRMVT_BOO, &cpu.fe.fe_ctydebug, NULL, NULL),
+				PRMVT_BOO, &FEMACH.fe.fe_ctydebug, NULL, NULL),
 #if KLH10_SYS_T20 && KLH10_CPU_KS
     PRMVAR("cty_iowait", "CTY output delay, usec",
-				PRMVT_DEC, &cpu.fe.fe_iowait, NULL, NULL),
+				PRMVT_DEC, &FEMACH.fe.fe_iowait, NULL, NULL),
 # if KLH10_CTYIO_ADDINT
     PRMVAR("cty_lastint", "CTY last-char extra output int, msec",
-				PRMVT_DEC, &cpu.fe.cty_lastint,	NULL, NULL),
+				PRMVT_DEC, &FEMACH.fe.cty_lastint,	NULL, NULL),
 # endif
 #endif
 #if KLH10_DEBUG && KLH10_CPU_KS
@@ -1402,46 +1506,50 @@ struct prmvar_s fecmvars[] = {
     PRMVAR("ld_debug", "LOAD debug trace",
 				PRMVT_BOO, &ld_debug, NULL, NULL),
     PRMVAR("insbreak", "APR loop interrupt",
-				PRMVT_DEC, &cpu.mr_insbreak, NULL, NULL),
+				PRMVT_DEC, &FEMACH.mr_insbreak, NULL, NULL),
 #if KLH10_CLKTRG_COUNT
     PRMVAR("clk_ipms", "Instrs per virt msec",
-				PRMVT_DEC, &cpu.clk.clk_ipmsrq,
+				PRMVT_DEC, &FEMACH.clk.clk_ipmsrq,
 	  						cmvp_sethz,NULL),
+# if KLH10_CLK_ADAPT
+    PRMVAR("clk_adapt", "Retune clk_ipms to track real time",
+				PRMVT_BOO, &FEMACH.clk.clk_adapt, NULL, NULL),
+# endif
 #endif
 #if 1 /* KLH10_CLKTRG_OSINT */
     PRMVAR("clk_ithz", "OS interval timer - current value in Hz",
-				PRMVT_DEC, &cpu.clk.clk_ithzcmreq,
+				PRMVT_DEC, &FEMACH.clk.clk_ithzcmreq,
 							cmvp_sethz, NULL),
     PRMVAR("clk_ithzfix", "ITimer value fixed at this if non-zero",
-				PRMVT_DEC, &cpu.clk.clk_ithzfix,
+				PRMVT_DEC, &FEMACH.clk.clk_ithzfix,
 							cmvp_sethz, NULL),
     PRMVAR("clk_ithzosreq", "ITimer value last requested by OS",
-				PRMVT_DEC, &cpu.clk.clk_ithzosreq,
+				PRMVT_DEC, &FEMACH.clk.clk_ithzosreq,
 				NULL, NULL),
 #endif
     PRMVAR("pisys_on", "Set if PI sys on",
-				PRMVT_OCT, &cpu.pi.pisys_on, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pisys_on, NULL, NULL),
     PRMVAR("pilev_on", "Levs enabled",
-				PRMVT_OCT, &cpu.pi.pilev_on, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_on, NULL, NULL),
     PRMVAR("pilev_pip", "Levs PI in Progress",
-				PRMVT_OCT, &cpu.pi.pilev_pip, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_pip, NULL, NULL),
     PRMVAR("pilev_preq", "Prog PI reqs",
-				PRMVT_OCT, &cpu.pi.pilev_preq, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_preq, NULL, NULL),
     PRMVAR("pilev_aprreq", "APR PI reqs",
-				PRMVT_OCT, &cpu.pi.pilev_aprreq, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_aprreq, NULL, NULL),
     PRMVAR("pilev_dreq", "Device PI reqs",
-				PRMVT_OCT, &cpu.pi.pilev_dreq, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_dreq, NULL, NULL),
 #if KLH10_CPU_KS
     PRMVAR("pilev_ub1req", "UBA #1 PI reqs",
-				PRMVT_OCT, &cpu.pi.pilev_ub1req, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_ub1req, NULL, NULL),
     PRMVAR("pilev_ub3req", "UBA #3 PI reqs",
-				PRMVT_OCT, &cpu.pi.pilev_ub3req, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_ub3req, NULL, NULL),
 #endif
 #if KLH10_CPU_KL
     PRMVAR("pilev_rhreq", "RH20 PI reqs",
-				PRMVT_OCT, &cpu.pi.pilev_rhreq, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_rhreq, NULL, NULL),
     PRMVAR("pilev_dtereq", "DTE20 PI reqs",
-				PRMVT_OCT, &cpu.pi.pilev_dtereq, NULL, NULL),
+				PRMVT_OCT, &FEMACH.pi.pilev_dtereq, NULL, NULL),
 #endif
     PRMVAR("feiosignulls", "# SIGIOs with no input",
 				PRMVT_DEC, &feiosignulls, NULL, NULL),
@@ -1850,10 +1958,16 @@ fc_devwait(struct cmd_s *cm)
 
     /* OK, now start the wait. */
     OS_STM_SET(stm, totsec);
+#if KLH10_EVHS_BELL
+    os_bellidle((void *)&cpu, TRUE);		/* DP doorbells must end the sleep too */
+#endif
     while (dev_waiting(stdout, dev)) {
 	if (os_msleep(&stm) <= 0)
 	    break;		/* Stop waiting if timed out */
     }
+#if KLH10_EVHS_BELL
+    os_bellidle((void *)&cpu, FALSE);
+#endif
 }
 
 /* FC_DEVBOOT - Boot using specified device.
@@ -2365,6 +2479,626 @@ fc_view(struct cmd_s *cm)
     nextinsprint(stdout, PINSTR_OPS);
 }
 
+/* FC_CLKQ - Show internal clock timers (see kn10clk.c).
+**	"clkq bench [<n>]" times <n> (default 1000000) random timer
+**	re-arms on all the free timer entries.
+*/
+static void
+fc_clkq(struct cmd_s *cm)
+{
+    extern void clk_qshow(FILE *);		/* From kn10clk.c */
+    extern void clk_bench(FILE *, long);
+    long n = 1000000;
+
+    switch (cmdargs_n(cm, 2)) {
+    case 0:
+	clk_qshow(stdout);
+	return;
+    case 2:
+	if (!s_todnum(cm->cmd_argv[1], &n) || n <= 0) {
+	    printf("?Bad count \"%s\"\n", cm->cmd_argv[1]);
+	    return;
+	}
+	/* Drop through */
+    case 1:
+	if (strcmp(cm->cmd_argv[0], "bench") != 0)
+	    break;
+	if (!aprhalted()) {
+	    printf("KN10 still running!  Halt or Reset it first.\n");
+	    return;
+	}
+	clk_bench(stdout, n);
+	return;
+    }
+    printf("?Unknown clkq command \"%s\"\n", cm->cmd_argv[0]);
+}
+
+#if KLH10_OPPROF
+/* FC_OPPROF - Per-opcode execution profiler.
+**	opprof on	Start counting instructions
+**	opprof cycles	Same, plus host cycles per instruction
+**	opprof off	Stop (counts are kept)
+**	opprof reset	Zero all counts
+**	opprof [show [<n>]]	Show top <n> (default 20) opcodes by count
+**	opprof dump <file>	Write all non-zero entries to <file>
+**
+** The dump format is one line per opcode, tab-separated:
+**	<type> <octal opcode> <name> <count> <cycles>
+** where <type> is "op" for a normal opcode or "xop" for an EXTEND sub-op.
+** Note that EXTEND is counted both as itself and as its sub-op.
+*/
+static unsigned long *oppf_cnt;		/* For oppf_cmp */
+
+static int
+oppf_cmp(const void *a, const void *b)
+{
+    register unsigned long ca = oppf_cnt[*(const int *)a];
+    register unsigned long cb = oppf_cnt[*(const int *)b];
+
+    return (ca < cb) ? 1 : ((ca > cb) ? -1 : 0);
+}
+
+static void
+oppf_show(char *typ, unsigned long *cnt, unsigned long *cyc,
+	  struct opdef **defs, int n, long max)
+{
+    int ix[I_N];
+    register int i;
+    double tot = 0;
+
+    for (i = 0; i < n; ++i) {
+	ix[i] = i;
+	tot += cnt[i];
+    }
+    if (tot == 0)
+	return;
+    oppf_cnt = cnt;
+    qsort((void *)ix, (size_t)n, sizeof(ix[0]), oppf_cmp);
+
+    printf("%-4s %-8s %12s %6s %10s\n", typ, "Name", "Count", "%", "Cyc/ins");
+    for (i = 0; i < n && i < max && cnt[ix[i]]; ++i) {
+	printf("%4o %-8s %12lu %6.2f", ix[i],
+		defs[ix[i]] ? defs[ix[i]]->opstr : "?",
+		cnt[ix[i]], (cnt[ix[i]] * 100.0) / tot);
+	if (cyc[ix[i]])
+	    printf(" %10.1f", (double)cyc[ix[i]] / cnt[ix[i]]);
+	putchar('\n');
+    }
+}
+
+static void
+oppf_dump(FILE *f, char *typ, unsigned long *cnt, unsigned long *cyc,
+	  struct opdef **defs, int n)
+{
+    register int i;
+
+    for (i = 0; i < n; ++i)
+	if (cnt[i])
+	    fprintf(f, "%s\t%o\t%s\t%lu\t%lu\n", typ, i,
+		    defs[i] ? defs[i]->opstr : "?", cnt[i], cyc[i]);
+}
+
+static void
+fc_opprof(struct cmd_s *cm)
+{
+    char *cmd = NULL, *arg = NULL;
+    long max = 20;
+    register int i;
+
+    switch (cmdargs_n(cm, 2)) {
+    default:
+	arg = cm->cmd_argv[1];
+	/* Drop through */
+    case 1:
+	cmd = cm->cmd_argv[0];
+    case 0:
+	break;
+    }
+    if (!cmd || strcmp(cmd, "show") == 0) {
+	if (arg && (!s_todnum(arg, &max) || max <= 0)) {
+	    printf("?Bad count \"%s\"\n", arg);
+	    return;
+	}
+	printf("Opcode profiling is %s\n",
+		cpu.mr_opprof ? (cpu.mr_opprof > 1 ? "on with cycles" : "on")
+			      : "off");
+	oppf_show("Op", cpu.pf_opcnt, cpu.pf_opcyc, opcptr, I_N, max);
+	oppf_show("XOp", cpu.pf_xcnt, cpu.pf_xcyc, opcxptr, IX_N, max);
+
+    } else if (strcmp(cmd, "on") == 0) {
+	cpu.mr_opprof = 1;
+    } else if (strcmp(cmd, "cycles") == 0) {
+	if (!OS_HAVECYCLES)
+	    printf("No host cycle counter, only counting instructions\n");
+	cpu.mr_opprof = OS_HAVECYCLES ? 2 : 1;
+    } else if (strcmp(cmd, "off") == 0) {
+	cpu.mr_opprof = 0;
+    } else if (strcmp(cmd, "reset") == 0) {
+	for (i = 0; i < I_N; ++i)
+	    cpu.pf_opcnt[i] = cpu.pf_opcyc[i] = 0;
+	for (i = 0; i < IX_N; ++i)
+	    cpu.pf_xcnt[i] = cpu.pf_xcyc[i] = 0;
+    } else if (strcmp(cmd, "dump") == 0) {
+	FILE *f;
+
+	if (!arg) {
+	    printf("?Need file to dump to\n");
+	    return;
+	}
+	if (!(f = fopen(arg, "w"))) {
+	    syserr(-1, "Cannot open \"%s\"", arg);
+	    return;
+	}
+	oppf_dump(f, "op", cpu.pf_opcnt, cpu.pf_opcyc, opcptr, I_N);
+	oppf_dump(f, "xop", cpu.pf_xcnt, cpu.pf_xcyc, opcxptr, IX_N);
+	fclose(f);
+    } else
+	printf("?Unknown opprof command \"%s\"\n", cmd);
+}
+#endif /* KLH10_OPPROF */
+
+#if KLH10_IDLE
+/* FC_IDLE - Guest idle loop detection (see idl_jump in kn10cpu.c).
+**	idle		Show state and known idle loop PCs
+**	idle on		Detect idle loops and block the host process
+**	idle off	Always spin
+**	idle pc <addr> ...	Add known idle loop PCs (U<addr> for user mode)
+**	idle clear	Forget known idle loop PCs
+** A known idle PC is the target of the jump closing the loop, and is
+** accepted without checking the loop's instructions.
+*/
+static void
+fc_idle(struct cmd_s *cm)
+{
+    vaddr_t va;
+    enum fevmmode mode;
+    register paddr_t pc;
+    register int i, n;
+
+    n = cmdargs_all(cm);
+    if (n == 0) {
+	printf("Idle detection is %s; host idled %lu times\n",
+		cpu.mr_idle ? "on" : "off", cpu.mr_idlens);
+	for (i = 0; i < cpu.mr_nidlpcs; ++i) {
+	    pc = cpu.mr_idlpcs[i];
+	    printf("  %s %lo,,%06lo\n", (pc & IDLE_UPC) ? "user" : "exec",
+		    (long)((pc & ~IDLE_UPC) >> 18), (long)(pc & H10MASK));
+	}
+    } else if (strcmp(cm->cmd_argv[0], "on") == 0) {
+	cpu.mr_idle = TRUE;
+    } else if (strcmp(cm->cmd_argv[0], "off") == 0) {
+	cpu.mr_idle = FALSE;
+    } else if (strcmp(cm->cmd_argv[0], "clear") == 0) {
+	cpu.mr_nidlpcs = 0;
+	cpu.mr_idlepc = IDLE_NOPC;	/* Re-check next loop seen */
+    } else if (strcmp(cm->cmd_argv[0], "pc") == 0) {
+	for (i = 1; i < n; ++i) {
+	    if (!addrparse(cm->cmd_argv[i], &va, &mode)) {
+		printf("?Bad address \"%s\"\n", cm->cmd_argv[i]);
+		return;
+	    }
+	    if (cpu.mr_nidlpcs >= IDLE_NPCS) {
+		printf("?Too many idle PCs, max %d\n", IDLE_NPCS);
+		return;
+	    }
+	    pc = va_30(va);
+	    if (mode == FEVM_USER)
+		pc |= IDLE_UPC;
+	    cpu.mr_idlpcs[cpu.mr_nidlpcs++] = pc;
+	}
+	cpu.mr_idlepc = IDLE_NOPC;
+    } else
+	printf("?Unknown idle command \"%s\"\n", cm->cmd_argv[0]);
+}
+#endif /* KLH10_IDLE */
+
+#if KLH10_PCPROF
+/* FC_PCPROF - Guest PC sampling profiler (see kn10prf.c).
+**	pcprof on	Start sampling PC once per interval tick
+**	pcprof off	Stop (samples are kept)
+**	pcprof reset	Flush all samples
+**	pcprof [show [<n>]]	Show top <n> (default 20) symbols, pages, buckets
+**	pcprof symbols <file> [exec|user]	Load symbols for mode (default exec)
+**	pcprof flat <file>	Write all buckets to <file>
+**	pcprof folded <file>	Write per-symbol totals in folded-stack format
+*/
+static void
+fc_pcprof(struct cmd_s *cm)
+{
+    char *cmd = NULL, *arg = NULL, *arg2 = NULL;
+    long max = 20;
+    FILE *f;
+    int n;
+
+    switch (cmdargs_n(cm, 3)) {
+    default:
+	arg2 = cm->cmd_argv[2];
+	/* Drop through */
+    case 2:
+	arg = cm->cmd_argv[1];
+    case 1:
+	cmd = cm->cmd_argv[0];
+    case 0:
+	break;
+    }
+    if (!cmd || strcmp(cmd, "show") == 0) {
+	if (arg && (!s_todnum(arg, &max) || max <= 0)) {
+	    printf("?Bad count \"%s\"\n", arg);
+	    return;
+	}
+	pcp_show(stdout, (int)max);
+
+    } else if (strcmp(cmd, "on") == 0) {
+	if (!pcp_on())
+	    printf("?Cannot start PC sampling\n");
+    } else if (strcmp(cmd, "off") == 0) {
+	pcp_off();
+    } else if (strcmp(cmd, "reset") == 0) {
+	pcp_reset();
+    } else if (strcmp(cmd, "symbols") == 0) {
+	if (!arg) {
+	    printf("?Need symbol file\n");
+	    return;
+	}
+	if (arg2 && strcmp(arg2, "user") == 0)
+	    n = PCP_USER;
+	else if (!arg2 || strcmp(arg2, "exec") == 0)
+	    n = PCP_EXEC;
+	else {
+	    printf("?Mode must be \"exec\" or \"user\"\n");
+	    return;
+	}
+	if ((n = pcp_symload(arg, n)) < 0) {
+	    syserr(-1, "Cannot open \"%s\"", arg);
+	    return;
+	}
+	printf("Loaded %d symbols\n", n);
+    } else if (strcmp(cmd, "flat") == 0 || strcmp(cmd, "folded") == 0) {
+	if (!arg) {
+	    printf("?Need file to write to\n");
+	    return;
+	}
+	if (!(f = fopen(arg, "w"))) {
+	    syserr(-1, "Cannot open \"%s\"", arg);
+	    return;
+	}
+	if (strcmp(cmd, "flat") == 0)
+	    pcp_flat(f);
+	else
+	    pcp_folded(f);
+	fclose(f);
+    } else
+	printf("?Unknown pcprof command \"%s\"\n", cmd);
+}
+#endif /* KLH10_PCPROF */
+
+#if KLH10_BPCACHE
+/* FC_BPCACHE - Show byte pointer cache hits and misses.
+**	"bpcache reset" also clears them.
+*/
+static void
+fc_bpcache(struct cmd_s *cm)
+{
+    char *arg = cm->cmd_arglin;
+    unsigned long tot = cpu.mr_bphits + cpu.mr_bpmiss;
+
+    printf("ILDB/IDPB byte pointer cache: %lu hits, %lu misses",
+		cpu.mr_bphits, cpu.mr_bpmiss);
+    if (tot)
+	printf(" (%.1f%% hit)", (100.0 * cpu.mr_bphits) / tot);
+    printf("\n");
+    if (arg && *arg && strcmp(arg, "reset") == 0)
+	cpu.mr_bphits = cpu.mr_bpmiss = 0;
+}
+#endif /* KLH10_BPCACHE */
+
+#if KLH10_EACHAIN
+/* FC_EACHAIN - Show histogram of indirect EA chain lengths.
+**	"eachain reset" also clears it.
+*/
+static void
+fc_eachain(struct cmd_s *cm)
+{
+    char *arg = cm->cmd_arglin;
+    register int i;
+
+    printf("Indirect EA chain lengths:\n");
+    for (i = 0; i < EACHAIN_N; ++i)
+	printf("  %d%s %10lu\n", i, (i == EACHAIN_N-1) ? "+" : " ",
+		cpu.mr_eachain[i]);
+    printf("  Longest: %d at PC %lo\n",
+		cpu.mr_eachmax, (long)cpu.mr_eachmaxpc);
+    if (arg && *arg && strcmp(arg, "reset") == 0) {
+	for (i = 0; i < EACHAIN_N; ++i)
+	    cpu.mr_eachain[i] = 0;
+	cpu.mr_eachmax = 0;
+	cpu.mr_eachmaxpc = 0;
+    }
+}
+#endif /* KLH10_EACHAIN */
+
+#if KLH10_PAG_TLB
+/* FC_PAGTLB - Show retained user page map counts (see kn10pag.c).
+**	"pagtlb reset" also clears them.
+*/
+static void
+fc_pagtlb(struct cmd_s *cm)
+{
+    extern void pag_tlbshow(FILE *, int);	/* From kn10pag.c */
+    char *arg = cm->cmd_arglin;
+
+    pag_tlbshow(stdout, (arg && *arg && strcmp(arg, "reset") == 0));
+}
+#endif /* KLH10_PAG_TLB */
+
+#if KLH10_HOSTFP
+/* FC_HOSTFP - Control the host floating-point engine (see kn10ops.c).
+**	"hostfp test [<n>]" runs each op on <n> random operand pairs with
+**	and without the engine, and reports any difference in result or
+**	flags.  Operands are biased toward the hard cases: nearby exponents,
+**	short fractions (exact and halfway results), and all-ones fractions.
+*/
+static unsigned long hfpt_seed = 1;
+
+static unsigned long
+hfpt_rand(void)				/* 32-bit xorshift */
+{
+    hfpt_seed ^= (hfpt_seed << 13) & 0xFFFFFFFFUL;
+    hfpt_seed ^= hfpt_seed >> 17;
+    hfpt_seed ^= (hfpt_seed << 5) & 0xFFFFFFFFUL;
+    return hfpt_seed;
+}
+
+static void
+hfpt_opnd(dw10_t *ad, int fbits, int emax, int ebase)
+{
+    register uint64 f, h, top = (uint64)1 << (fbits-1);
+    register int e, n;
+
+    switch (hfpt_rand() & 037) {
+    case 0:				/* Zero */
+	LRHSET(ad->w[0], 0, 0);
+	LRHSET(ad->w[1], 0, 0);
+	return;
+    case 1:				/* Garbage */
+	LRHSET(ad->w[0], hfpt_rand() & H10MASK, hfpt_rand() & H10MASK);
+	LRHSET(ad->w[1], hfpt_rand() & (H10MASK>>1), hfpt_rand() & H10MASK);
+	return;
+    case 2: case 3: case 4: case 5:	/* Anywhere */
+	e = hfpt_rand() % (emax+1);
+	break;
+    default:				/* Near base */
+	e = ebase + (int)(hfpt_rand() % 9) - 4;
+	break;
+    }
+    f = ((uint64)hfpt_rand() << 32) | hfpt_rand();
+    switch (hfpt_rand() & 07) {
+    case 0:				/* Power of 2 */
+	f = top;
+	break;
+    case 1:				/* All ones */
+	f = (top << 1) - 1;
+	break;
+    case 2: case 3:			/* A few high bits */
+	n = hfpt_rand() % 9;
+	f = top | ((f & (((uint64)1 << n) - 1)) << (fbits-1-n));
+	break;
+    default:				/* Random */
+	f = top | (f & (top-1));
+	break;
+    }
+    if (e < 0) e = 0;
+    else if (e > emax) e = emax;
+
+    if (fbits < 36) {			/* Single */
+	f |= (uint64)e << fbits;
+	LRHSET(ad->w[0], (h10_t)(f >> 18) & H10MASK, (h10_t)f & H10MASK);
+	LRHSET(ad->w[1], 0, 0);
+	if (hfpt_rand() & 1)
+	    op10m_movn(ad->w[0]);
+    } else {
+	h = ((uint64)e << (fbits-35)) | (f >> 35);
+	LRHSET(ad->w[0], (h10_t)(h >> 18) & H10MASK, (h10_t)h & H10MASK);
+	LRHSET(ad->w[1], (h10_t)(f >> 18) & (H10MASK>>1), (h10_t)f & H10MASK);
+	if (hfpt_rand() & 1)
+	    op10m_dmovn(*ad);
+    }
+}
+
+static struct hfpt_op {
+    char *name;
+    w10_t (*sop)(w10_t, w10_t);
+    dw10_t (*dop)(dw10_t, dw10_t);
+    int fbits, emax, excess;
+} hfpt_ops[] = {
+    { "fad",  op10fad,  NULL, 27, 0377, 0200 },
+    { "fadr", op10fadr, NULL, 27, 0377, 0200 },
+    { "fsb",  op10fsb,  NULL, 27, 0377, 0200 },
+    { "fsbr", op10fsbr, NULL, 27, 0377, 0200 },
+    { "fmp",  op10fmp,  NULL, 27, 0377, 0200 },
+    { "fmpr", op10fmpr, NULL, 27, 0377, 0200 },
+    { "fdv",  op10fdv,  NULL, 27, 0377, 0200 },
+    { "fdvr", op10fdvr, NULL, 27, 0377, 0200 },
+    { "dfad", NULL, op10dfad, 62, 0377, 0200 },
+    { "dfsb", NULL, op10dfsb, 62, 0377, 0200 },
+    { "dfmp", NULL, op10dfmp, 62, 0377, 0200 },
+    { "dfdv", NULL, op10dfdv, 62, 0377, 0200 },
+#if KLH10_CPU_KL
+    { "gfad", NULL, op10gfad, 59, 03777, 02000 },
+    { "gfsb", NULL, op10gfsb, 59, 03777, 02000 },
+    { "gfmp", NULL, op10gfmp, 59, 03777, 02000 },
+    { "gfdv", NULL, op10gfdv, 59, 03777, 02000 },
+#endif
+    { NULL }
+};
+
+static void
+hfpt_show(char *s, dw10_t d, h10_t flags, int dbl)
+{
+    printf(" %s %lo,,%lo", s, (long)LHGET(d.w[0]), (long)RHGET(d.w[0]));
+    if (dbl)
+	printf(" %lo,,%lo", (long)LHGET(d.w[1]), (long)RHGET(d.w[1]));
+    if (flags)
+	printf(" [%lo]", (long)flags);
+}
+
+static void
+hfpt_run(long n)
+{
+    register struct hfpt_op *op;
+    register long i;
+    dw10_t a, b, ri, rh;
+    h10_t fi, fh, savflags = cpu.mr_pcflags;
+    int ebase, savon = op10hfpon;
+    unsigned long hits, bad, tbad = 0;
+
+    for (op = hfpt_ops; op->name; ++op) {
+	hits = op10hfphits;
+	bad = 0;
+	for (i = 0; i < n; ++i) {
+	    ebase = (hfpt_rand() & 1)
+		? op->excess + (int)(hfpt_rand() % 33) - 16
+		: (int)(hfpt_rand() % (op->emax+1));
+	    hfpt_opnd(&a, op->fbits, op->emax, ebase);
+	    hfpt_opnd(&b, op->fbits, op->emax, ebase);
+
+	    op10hfpon = FALSE;
+	    cpu.mr_pcflags = 0;
+	    if (op->sop)
+		ri.w[0] = (*op->sop)(a.w[0], b.w[0]), ri.w[1] = a.w[1];
+	    else
+		ri = (*op->dop)(a, b);
+	    fi = cpu.mr_pcflags;
+
+	    op10hfpon = TRUE;
+	    cpu.mr_pcflags = 0;
+	    if (op->sop)
+		rh.w[0] = (*op->sop)(a.w[0], b.w[0]), rh.w[1] = a.w[1];
+	    else
+		rh = (*op->dop)(a, b);
+	    fh = cpu.mr_pcflags;
+
+	    if (fi == fh && !op10m_camn(ri.w[0], rh.w[0])
+	      && !op10m_camn(ri.w[1], rh.w[1]))
+		continue;
+	    if (++bad <= 5) {
+		printf("  %s", op->name);
+		hfpt_show("", a, 0, !op->sop);
+		hfpt_show("", b, 0, !op->sop);
+		hfpt_show("=> int", ri, fi, !op->sop);
+		hfpt_show("host", rh, fh, !op->sop);
+		printf("\n");
+	    }
+	}
+	printf("%-5s %ld ops, %lu on host, %lu mismatches\n",
+		op->name, n, op10hfphits - hits, bad);
+	tbad += bad;
+    }
+    printf("%s\n", tbad ? "FAILED" : "All OK");
+    op10hfpon = savon;
+    cpu.mr_pcflags = savflags;
+}
+
+static void
+fc_hostfp(struct cmd_s *cm)
+{
+    char *cmd = NULL, *arg = NULL;
+    long n = 100000;
+    int on = op10hfpon;
+
+    switch (cmdargs_n(cm, 2)) {
+    default:
+	arg = cm->cmd_argv[1];
+	/* Drop through */
+    case 1:
+	cmd = cm->cmd_argv[0];
+    case 0:
+	break;
+    }
+    if (!cmd) {
+	printf("Host floating point is %s; %lu ops on host, %lu on integer code\n",
+		op10hfpon ? "on" : "off", op10hfphits, op10hfpmiss);
+    } else if (strcmp(cmd, "on") == 0) {
+	if (!op10hfpinit())
+	    printf("?Host long double is not suitable\n");
+    } else if (strcmp(cmd, "off") == 0) {
+	op10hfpon = FALSE;
+    } else if (strcmp(cmd, "reset") == 0) {
+	op10hfphits = op10hfpmiss = 0;
+    } else if (strcmp(cmd, "test") == 0) {
+	if (arg && (!s_todnum(arg, &n) || n <= 0)) {
+	    printf("?Bad count \"%s\"\n", arg);
+	    return;
+	}
+	if (!op10hfpinit()) {
+	    printf("?Host long double is not suitable\n");
+	    return;
+	}
+	op10hfpon = on;			/* Keep user's setting */
+	hfpt_run(n);
+    } else
+	printf("?Unknown hostfp command \"%s\"\n", cmd);
+}
+#endif /* KLH10_HOSTFP */
+
+#if KLH10_CKPT
+
+/* FC_CKPT - Write entire machine state to a checkpoint file.
+** FC_CKREST - Restore it.  The emulator must have been started with the
+**	same configuration (same init file, up through device definitions
+**	and mounts); afterwards "continue" resumes the machine.
+*/
+static void
+fc_ckpt(struct cmd_s *cm)
+{
+    char *farg;
+
+    if (!cmdargs_one(cm, &farg))
+	return;
+    if (!aprhalted()) {
+	printf("KN10 still running!  Halt or Reset it first.\n");
+	return;
+    }
+    if (ckp_save(stdout, farg))
+	printf("Checkpointed to \"%s\", PC = %lo\n", farg, (long) PC_30);
+    else
+	printf("Checkpoint to \"%s\" failed.\n", farg);
+}
+
+/* Restore or clone.  A clone maps the checkpoint's memory image instead
+**	of copying it, so emulators cloned from one file share the pages
+**	none of them has changed.
+*/
+static void
+ckrest(struct cmd_s *cm, int share)
+{
+    char *farg;
+
+    if (!cmdargs_one(cm, &farg))
+	return;
+    if (!aprhalted()) {
+	printf("KN10 still running!  Halt or Reset it first.\n");
+	return;
+    }
+    if (ckp_restore(stdout, farg, share))
+	printf("Restored from \"%s\", PC = %lo\n", farg, (long) PC_30);
+    else
+	printf("Restore from \"%s\" failed.\n", farg);
+}
+
+static void
+fc_ckrest(struct cmd_s *cm)
+{
+    ckrest(cm, FALSE);
+}
+
+static void
+fc_clone(struct cmd_s *cm)
+{
+    ckrest(cm, TRUE);
+}
+#endif /* KLH10_CKPT */
+
 /* FE_TRACEPRINT called from APR loop if tracing and about to execute
 **	an instruction.
 */
@@ -277,6 +277,49 @@
 #ifndef  KLH10_PCCACHE	/* True to include experimental PC cache stuff */
 # define KLH10_PCCACHE 1
 #endif
+#ifndef  KLH10_OPPROF	/* True to include per-opcode execution profiler */
+# define KLH10_OPPROF 0
+#endif
+#ifndef  KLH10_IDLE	/* True to detect guest idle loops */
+# define KLH10_IDLE 0
+#endif
+#ifndef  KLH10_PCPROF	/* True to include guest PC sampling profiler */
+# define KLH10_PCPROF 0
+#endif
+#ifndef  KLH10_BPCACHE	/* True to cache decoded BPs for ILDB/IDPB */
+# define KLH10_BPCACHE 0
+#endif
+#ifndef  KLH10_EACHAIN	/* True to count indirect EA chain lengths */
+# define KLH10_EACHAIN 0
+#endif
+#ifndef  KLH10_HOSTFP	/* True to try host long double for float ops */
+# define KLH10_HOSTFP 0
+#endif
+#ifndef  KLH10_CKPT	/* True to include machine checkpoint/restore */
+# define KLH10_CKPT 0
+#endif
+#ifndef  KLH10_PAG_TLB	/* True to keep T20 user page maps across WRUBR */
+# define KLH10_PAG_TLB 0
+#endif
+#if KLH10_PAG_TLB && !KLH10_PAG_KL	/* Only T20 paging supports it */
+# undef  KLH10_PAG_TLB
+# define KLH10_PAG_TLB 0
+#endif
+#ifndef  KLH10_MULTI	/* True to reach machine state via per-thread ptr */
+# define KLH10_MULTI 0
+#endif
+#ifndef  KLH10_CLK_WHEEL	/* True to keep ITICK timers on a timing wheel */
+# define KLH10_CLK_WHEEL 0
+#endif
+#ifndef  KLH10_CLK_TIMERFD	/* True to drive OSINT clock from timerfd thread */
+# define KLH10_CLK_TIMERFD 0
+#endif
+#ifndef  KLH10_CLK_ADAPT	/* True to retune COUNT clock ipms to real time */
+# define KLH10_CLK_ADAPT 0
+#endif
+#if KLH10_MULTI && !defined(KLH10_TLS)
+# define KLH10_TLS __thread	/* Thread-local storage class */
+#endif
 #ifndef  KLH10_JPC	/* True to include JPC feature */
 # define KLH10_JPC 1	/* For now, always - helps debug! */
 #endif
@@ -392,6 +435,18 @@
 # define KLH10_DEV_DP (KLH10_DEV_DPNI20 \
 		      |KLH10_DEV_DPRPXX|KLH10_DEV_DPTM03|KLH10_DEV_DPIMP)
 #endif
+#ifndef  KLH10_DP_MSEM		/* True to ring NI20 and RPxx subprocs with */
+# define KLH10_DP_MSEM 0	/* eventfds instead of signals (needs EVHS_INT) */
+#endif
+#ifndef  KLH10_DP_RING		/* True to queue NI20 input and RPxx requests */
+# define KLH10_DP_RING 0	/* in DP shared-memory rings */
+#endif
+#ifndef  KLH10_RP_THREAD	/* True to let RPxx drives do I/O from a pool */
+# define KLH10_RP_THREAD 0	/* of threads instead of a subproc (EVHS_INT) */
+#endif
+#ifndef  KLH10_EVHS_BELL	/* True to include DVEV_DPBELL doorbell events */
+# define KLH10_EVHS_BELL (KLH10_DP_MSEM || KLH10_RP_THREAD)
+#endif
 
 /* Miscellaneous config vars */
 
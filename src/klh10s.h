@@ -220,6 +220,66 @@
 #else
 # define KLH10S_PCCACHE ""
 #endif
+#if KLH10_OPPROF
+# define KLH10S_OPPROF " OPPROF"
+#else
+# define KLH10S_OPPROF ""
+#endif
+#if KLH10_IDLE
+# define KLH10S_IDLE " IDLE"
+#else
+# define KLH10S_IDLE ""
+#endif
+#if KLH10_PCPROF
+# define KLH10S_PCPROF " PCPROF"
+#else
+# define KLH10S_PCPROF ""
+#endif
+#if KLH10_EACHAIN
+# define KLH10S_EACHAIN " EACHAIN"
+#else
+# define KLH10S_EACHAIN ""
+#endif
+#if KLH10_BPCACHE
+# define KLH10S_BPCACHE " BPCACHE"
+#else
+# define KLH10S_BPCACHE ""
+#endif
+#if KLH10_HOSTFP
+# define KLH10S_HOSTFP " HOSTFP"
+#else
+# define KLH10S_HOSTFP ""
+#endif
+#if KLH10_CKPT
+# define KLH10S_CKPT " CKPT"
+#else
+# define KLH10S_CKPT ""
+#endif
+#if KLH10_PAG_TLB
+# define KLH10S_PAG_TLB " PAGTLB"
+#else
+# define KLH10S_PAG_TLB ""
+#endif
+#if KLH10_MULTI
+# define KLH10S_MULTI " MULTI"
+#else
+# define KLH10S_MULTI ""
+#endif
+#if KLH10_CLK_WHEEL
+# define KLH10S_CLK_WHEEL " CLKWHEEL"
+#else
+# define KLH10S_CLK_WHEEL ""
+#endif
+#if KLH10_CLK_TIMERFD
+# define KLH10S_CLK_TIMERFD " CLKTFD"
+#else
+# define KLH10S_CLK_TIMERFD ""
+#endif
+#if KLH10_CLK_ADAPT
+# define KLH10S_CLK_ADAPT " CLKADAPT"
+#else
+# define KLH10S_CLK_ADAPT ""
+#endif
 #if KLH10_CTYIO_INT
 # define KLH10S_CTYIO_INT " CTYINT"
 #else
@@ -235,6 +295,21 @@
 #else
 # define KLH10S_EVHS_INT ""
 #endif
+#if KLH10_DP_MSEM
+# define KLH10S_DP_MSEM " DPMSEM"
+#else
+# define KLH10S_DP_MSEM ""
+#endif
+#if KLH10_DP_RING
+# define KLH10S_DP_RING " DPRING"
+#else
+# define KLH10S_DP_RING ""
+#endif
+#if KLH10_RP_THREAD
+# define KLH10S_RP_THREAD " RPTHREAD"
+#else
+# define KLH10S_RP_THREAD ""
+#endif
 
 
 /* Devices included with build
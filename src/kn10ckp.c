@@ -0,0 +1,559 @@
+/* KN10CKP.C - KLH10 machine checkpoint/restore
+*/
+/*  Copyright 2026 The KLH10 contributors
+**  All Rights Reserved
+**
+**  This file is part of the KLH10 Distribution.  Use, modification, and
+**  re-distribution is permitted subject to the terms in the file
+**  named "LICENSE", which contains the full text of the legal notices
+**  and should always accompany this Distribution.
+**
+**  This software is provided "AS IS" with NO WARRANTY OF ANY KIND.
+**
+**  This notice (including the copyright and warranty disclaimer)
+**  must be included in all copies or derivations of this software.
+*/
+
+/*
+	A checkpoint file holds everything needed to resume a halted
+machine later, possibly in a new process: physical memory, the CPU and
+pager registers, the internal clock queues, and the state of every
+defined device.  It is laid out as:
+
+	Header (struct ckphdr), padded to CKP_ALIGN bytes
+	Physical memory image, exactly as in core
+	Sections, each a struct ckpsec followed by its data, ending
+		with an "END" section.  The data is a series of items,
+		each preceded by its length as a long.
+
+The memory image is page-aligned so that restore can map the file and
+copy memory straight out of it; if the file can't be mapped it is just
+read in.  A clone doesn't copy it at all, but uses a private mapping of
+it as physical memory, so that any number of emulators cloned from one
+file share every page none of them has written.  For the sake of such
+clones a checkpoint is written under a temporary name and renamed into
+place when complete, rather than rewriting the old file.
+
+	Only machine state is saved, not configuration.  A restore must be
+done by the same emulator binary, after running the same init file (up
+through its device definitions and mounts) so that the same devices exist;
+the devices then restore their own state from their sections.  Disk and
+tape images are not copied, so a disk must not be written by anything
+else between checkpoint and restore.
+	Everything that can be checked is checked before anything is
+changed, so a failed restore leaves the machine as it was.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "klh10.h"
+#include "osdsup.h"
+#include "kn10def.h"	/* This includes kn10clk.h */
+#include "kn10dev.h"
+#include "kn10cpu.h"	/* For pi_devupd */
+#include "kn10pag.h"	/* For pag_ckprest */
+#include "kn10ckp.h"
+#include "klh10s.h"	/* For build config strings */
+
+#if KLH10_CKPT	/* Moby conditional for entire file */
+
+#define CKP_MAGIC "KLH10CKP"
+#define CKP_VERSION 2
+#define CKP_ALIGN 65536		/* Memory image offset, >= any host page */
+#define CKP_RND 16		/* Section data alignment */
+#define ckp_round(n) (((n) + (CKP_RND-1)) & ~(long)(CKP_RND-1))
+#define ckp_secis(cs, tag) (strncmp((cs)->cs_tag, tag, sizeof((cs)->cs_tag)) == 0)
+
+#define CKP_BUILD "KLH10 " KLH10_VERSION " " \
+		KLH10S_CPU_ " " KLH10S_SYS_ " " KLH10S_PAG_ \
+		" " __DATE__ " " __TIME__
+
+struct ckphdr {
+	char ch_magic[8];	/* CKP_MAGIC */
+	long ch_version;	/* CKP_VERSION */
+	long ch_hdrsiz;		/* sizeof(struct ckphdr) */
+	char ch_build[128];	/* CKP_BUILD */
+	long ch_cpusiz;		/* sizeof(struct machstate) */
+	long ch_wdsiz;		/* sizeof(w10_t) */
+	long ch_npages;		/* # physical memory pages */
+	long ch_time;		/* When written */
+	long ch_memoff;		/* File offset of memory image */
+	long ch_secoff;		/* File offset of first section */
+	long ch_size;		/* Total file size */
+	w10_t *ch_physmem;	/* Memory address at time of save */
+};
+
+struct ckpsec {
+	char cs_tag[8];		/* "CPU", "CLK", "DEV", "END" */
+	char cs_name[32];	/* Name within tag, eg device name */
+	long cs_len;		/* # bytes of data that follow */
+};
+
+struct ckpt_s {
+	FILE *ck_of;		/* Where to complain */
+	char *ck_path;
+	w10_t *ck_omem;		/* Saved physmem address */
+
+	/* Writing */
+	FILE *ck_f;
+	long ck_secpos;		/* File offset of current section header */
+	long ck_seclen;		/* Data bytes in it so far */
+
+	/* Reading */
+	char *ck_base;		/* Entire file in core */
+	long ck_size;
+	int ck_mapped;		/* TRUE if ck_base is a mapping */
+	long ck_secoff;		/* Offset of first section */
+	char *ck_cur;		/* Next data in current section */
+	char *ck_end;		/* End of current section */
+	struct ckpsec *ck_sec;	/* Current section */
+};
+
+static int ckp_read(struct ckpt_s *, FILE *);
+static void ckp_unread(struct ckpt_s *);
+static void ckp_cpurest(struct machstate *);
+static void ckp_memswap(char *);
+
+/* Section writing facilities
+*/
+
+static int
+ckp_wpad(struct ckpt_s *ck, long n)
+{
+    static char zeros[CKP_RND];
+
+    return (n <= 0) || (fwrite(zeros, 1, (size_t)n, ck->ck_f) == (size_t)n);
+}
+
+int
+ckp_secbeg(struct ckpt_s *ck, char *tag, char *name)
+{
+    struct ckpsec cs;
+
+    memset((char *)&cs, 0, sizeof(cs));
+    strncpy(cs.cs_tag, tag, sizeof(cs.cs_tag)-1);
+    strncpy(cs.cs_name, name, sizeof(cs.cs_name)-1);
+    ck->ck_secpos = ftell(ck->ck_f);
+    ck->ck_seclen = 0;
+    return (fwrite((char *)&cs, sizeof(cs), 1, ck->ck_f) == 1)
+	&& ckp_wpad(ck, ckp_round((long)sizeof(cs)) - (long)sizeof(cs));
+}
+
+int
+ckp_put(struct ckpt_s *ck, void *data, size_t len)
+{
+    long n = (long)len;
+
+    if (fwrite((char *)&n, sizeof(n), 1, ck->ck_f) != 1
+      || !ckp_wpad(ck, ckp_round((long)sizeof(n)) - (long)sizeof(n)))
+	return FALSE;
+    if (len && fwrite((char *)data, 1, len, ck->ck_f) != len)
+	return FALSE;
+    ck->ck_seclen += ckp_round((long)sizeof(n)) + ckp_round((long)len);
+    return ckp_wpad(ck, ckp_round((long)len) - (long)len);
+}
+
+int
+ckp_secend(struct ckpt_s *ck)
+{
+    long pos = ftell(ck->ck_f);
+    struct ckpsec cs;
+
+    if (fseek(ck->ck_f, ck->ck_secpos, SEEK_SET)
+      || fread((char *)&cs, sizeof(cs), 1, ck->ck_f) != 1)
+	return FALSE;
+    cs.cs_len = ck->ck_seclen;
+    return !fseek(ck->ck_f, ck->ck_secpos, SEEK_SET)
+	&& (fwrite((char *)&cs, sizeof(cs), 1, ck->ck_f) == 1)
+	&& !fseek(ck->ck_f, pos, SEEK_SET);
+}
+
+/* Section reading facilities
+*/
+
+int
+ckp_secfind(struct ckpt_s *ck, char *tag, char *name)
+{
+    register struct ckpsec *cs;
+    register long off;
+
+    for (off = ck->ck_secoff; off < ck->ck_size; ) {
+	cs = (struct ckpsec *)(ck->ck_base + off);
+	off += ckp_round((long)sizeof(*cs));
+	if (ckp_secis(cs, tag)
+	  && strncmp(cs->cs_name, name, sizeof(cs->cs_name)) == 0) {
+	    ck->ck_cur = ck->ck_base + off;
+	    ck->ck_end = ck->ck_cur + cs->cs_len;
+	    ck->ck_sec = cs;
+	    return TRUE;
+	}
+	off += cs->cs_len;
+    }
+    return FALSE;
+}
+
+void *
+ckp_get(struct ckpt_s *ck, size_t len)
+{
+    char *p = ck->ck_cur;
+    long n;
+
+    if (ckp_round((long)sizeof(n)) + ckp_round((long)len) > (ck->ck_end - p))
+	return NULL;
+    memcpy((char *)&n, p, sizeof(n));
+    if (n != (long)len) {
+	fprintf(ck->ck_of, "Checkpoint %s %.*s: item is %ld bytes, not %ld\n",
+		ck->ck_sec->cs_tag, (int)sizeof(ck->ck_sec->cs_name),
+		ck->ck_sec->cs_name, n, (long)len);
+	return NULL;
+    }
+    p += ckp_round((long)sizeof(n));
+    ck->ck_cur = p + ckp_round((long)len);
+    return (void *)p;
+}
+
+/* CKP_VMPTR - Relocate a pointer into physical memory, as saved in a
+**	device structure, to the current memory.
+*/
+w10_t *
+ckp_vmptr(struct ckpt_s *ck, w10_t *p)
+{
+    return p ? (cpu.physmem + (p - ck->ck_omem)) : NULL;
+}
+
+FILE *
+ckp_outf(struct ckpt_s *ck)
+{
+    return ck->ck_of;
+}
+
+/* CKP_SAVE - Write checkpoint of halted machine to file.
+*/
+int
+ckp_save(FILE *of, char *path)
+{
+    struct ckpt_s ck;
+    struct ckphdr ch;
+    size_t memsiz = (size_t)PAG_SIZE * PAG_MAXPHYSPGS * sizeof(w10_t);
+    char *tpath;
+    int ok;
+
+    if (!dev_ckpready(of, 10))
+	return FALSE;
+
+    memset((char *)&ck, 0, sizeof(ck));
+    ck.ck_of = of;
+    ck.ck_path = path;
+    if (!(tpath = malloc(strlen(path) + sizeof(".tmp")))) {
+	fprintf(of, "Cannot allocate pathname\n");
+	return FALSE;
+    }
+    sprintf(tpath, "%s.tmp", path);
+    if (!(ck.ck_f = fopen(tpath, "w+b"))) {
+	fprintf(of, "Cannot create \"%s\": %s\n", tpath, os_strerror(errno));
+	free(tpath);
+	return FALSE;
+    }
+
+    memset((char *)&ch, 0, sizeof(ch));
+    memcpy(ch.ch_magic, CKP_MAGIC, sizeof(ch.ch_magic));
+    ch.ch_version = CKP_VERSION;
+    ch.ch_hdrsiz = sizeof(ch);
+    strncpy(ch.ch_build, CKP_BUILD, sizeof(ch.ch_build)-1);
+    ch.ch_cpusiz = sizeof(struct machstate);
+    ch.ch_wdsiz = sizeof(w10_t);
+    ch.ch_npages = PAG_MAXPHYSPGS;
+    ch.ch_time = (long) time((time_t *)NULL);
+    ch.ch_memoff = CKP_ALIGN;
+    ch.ch_secoff = CKP_ALIGN + ckp_round((long)memsiz);
+    ch.ch_physmem = cpu.physmem;
+
+    /* Memory first, then sections, then go back for header */
+    ok = !fseek(ck.ck_f, ch.ch_memoff, SEEK_SET)
+	&& (fwrite((char *)cpu.physmem, 1, memsiz, ck.ck_f) == memsiz)
+	&& ckp_wpad(&ck, ch.ch_secoff - ch.ch_memoff - (long)memsiz);
+
+    ok = ok && ckp_secbeg(&ck, "CPU", "")
+	&& ckp_put(&ck, (char *)&cpu, sizeof(cpu))
+	&& ckp_secend(&ck);
+
+    ok = ok && ckp_secbeg(&ck, "CLK", "")
+	&& clk_ckpsave(&ck)
+	&& ckp_secend(&ck);
+
+    ok = ok && dev_ckpsave(of, &ck);
+
+    ok = ok && ckp_secbeg(&ck, "END", "") && ckp_secend(&ck);
+
+    if (ok) {
+	ch.ch_size = ftell(ck.ck_f);
+	ok = !fseek(ck.ck_f, 0L, SEEK_SET)
+	    && (fwrite((char *)&ch, sizeof(ch), 1, ck.ck_f) == 1);
+    }
+    if (fclose(ck.ck_f) != 0)
+	ok = FALSE;
+    if (ok && rename(tpath, path) != 0)
+	ok = FALSE;
+    if (!ok) {
+	fprintf(of, "Error writing \"%s\": %s\n", path, os_strerror(errno));
+	remove(tpath);
+    }
+    free(tpath);
+    return ok;
+}
+
+/* CKP_RESTORE - Restore halted machine from checkpoint file.
+**	If SHARE is set, physical memory becomes a copy-on-write mapping
+**	of the file's memory image instead of a copy of it.
+*/
+int
+ckp_restore(FILE *of, char *path, int share)
+{
+    struct ckpt_s ck;
+    struct ckpsec *cs;
+    struct machstate *ms;
+    size_t memsiz = (size_t)PAG_SIZE * PAG_MAXPHYSPGS * sizeof(w10_t);
+    long off, memoff;
+    char *mem = NULL;
+    int ndevs;
+    FILE *f;
+
+    memset((char *)&ck, 0, sizeof(ck));
+    ck.ck_of = of;
+    ck.ck_path = path;
+    if (!(f = fopen(path, "rb"))) {
+	fprintf(of, "Cannot open \"%s\": %s\n", path, os_strerror(errno));
+	return FALSE;
+    }
+    if (!ckp_read(&ck, f)) {
+	fclose(f);
+	return FALSE;
+    }
+    memoff = ((struct ckphdr *)ck.ck_base)->ch_memoff;
+
+    /* Devices must be idle before their state can be replaced */
+    if (!dev_ckpready(of, 10))
+	goto bad;
+
+    /* Check everything before changing anything */
+    if (!ckp_secfind(&ck, "CPU", "")
+      || !(ms = (struct machstate *)ckp_get(&ck, sizeof(*ms)))) {
+	fprintf(of, "Checkpoint has no CPU state\n");
+	goto bad;
+    }
+    if (!ckp_secfind(&ck, "CLK", "")) {
+	fprintf(of, "Checkpoint has no clock state\n");
+	goto bad;
+    }
+    if (!clk_ckprest(&ck, FALSE))
+	goto bad;
+    if ((ndevs = dev_ckprest(of, &ck, FALSE)) < 0)
+	goto bad;
+    for (off = ck.ck_secoff; off < ck.ck_size; ) {
+	cs = (struct ckpsec *)(ck.ck_base + off);
+	if (ckp_secis(cs, "DEV"))
+	    --ndevs;
+	off += ckp_round((long)sizeof(*cs)) + cs->cs_len;
+    }
+    if (ndevs) {
+	fprintf(of, "Checkpoint has state for devices not defined here\n");
+	goto bad;
+    }
+    if (share) {
+	/* Giving up a shared segment is only safe if no DP has it */
+	if (cpu.mm_shared && os_mmusers(cpu.mm_physegid) != 1) {
+	    fprintf(of, "Memory is in use by a device subprocess;"
+			" to clone, give disks dpdma=0\n");
+	    goto bad;
+	}
+	if (!os_fmmap(fileno(f), memoff, memsiz, TRUE, &mem)) {
+	    fprintf(of, "Cannot map memory of \"%s\": %s\n",
+			path, os_strerror(errno));
+	    goto bad;
+	}
+    }
+    fclose(f);			/* Mappings stay valid */
+
+    /* Commit */
+    if (mem)
+	ckp_memswap(mem);
+    else
+	memcpy((char *)cpu.physmem, ck.ck_base + memoff, memsiz);
+    ckp_cpurest(ms);
+    pag_ckprest();
+
+    if (dev_ckprest(of, &ck, TRUE) < 0)	/* Shouldn't fail now */
+	fprintf(of, "Warning: device restore incomplete!\n");
+    if (!ckp_secfind(&ck, "CLK", "") || !clk_ckprest(&ck, TRUE))
+	fprintf(of, "Warning: clock restore incomplete!\n");
+
+    pi_devupd();		/* Recompute device PI requests */
+    ckp_unread(&ck);
+    return TRUE;
+
+bad:
+    fclose(f);
+    ckp_unread(&ck);
+    return FALSE;
+}
+
+/* CKP_MEMSWAP - Replace physical memory with a mapping of a checkpoint.
+**	Whatever it was before is released.
+*/
+static void
+ckp_memswap(char *mem)
+{
+    if (cpu.mm_shared) {
+	os_mmkill(cpu.mm_physegid, (char *)cpu.physmem);
+	cpu.mm_physegid = 0;
+	cpu.mm_shared = FALSE;
+    } else if (cpu.mm_mapped)
+	os_fmunmap((char *)cpu.physmem,
+		   (size_t)PAG_SIZE * PAG_MAXPHYSPGS * sizeof(w10_t));
+    else
+	free((char *)cpu.physmem);
+    cpu.physmem = (vmptr_t)mem;
+    cpu.mm_mapped = TRUE;
+}
+
+/* CKP_READ - Get entire checkpoint file into core, and verify it.
+*/
+static int
+ckp_read(struct ckpt_s *ck, FILE *f)
+{
+    struct ckphdr ch;
+    register struct ckpsec *cs;
+    register long off;
+    int endok = FALSE;
+
+    if (fread((char *)&ch, sizeof(ch), 1, f) != 1
+      || memcmp(ch.ch_magic, CKP_MAGIC, sizeof(ch.ch_magic)) != 0) {
+	fprintf(ck->ck_of, "\"%s\" is not a checkpoint file\n", ck->ck_path);
+	return FALSE;
+    }
+    ch.ch_build[sizeof(ch.ch_build)-1] = '\0';
+    if (ch.ch_version != CKP_VERSION
+      || ch.ch_hdrsiz != sizeof(ch)
+      || strcmp(ch.ch_build, CKP_BUILD) != 0
+      || ch.ch_cpusiz != sizeof(struct machstate)
+      || ch.ch_wdsiz != sizeof(w10_t)
+      || ch.ch_npages != PAG_MAXPHYSPGS) {
+	fprintf(ck->ck_of,
+		"\"%s\" was written by a different build:\n    %s\n",
+		ck->ck_path, ch.ch_build);
+	return FALSE;
+    }
+
+    ck->ck_size = ch.ch_size;
+    ck->ck_secoff = ch.ch_secoff;
+    ck->ck_omem = ch.ch_physmem;
+    if (os_fmmap(fileno(f), 0L, (size_t)ch.ch_size, FALSE, &ck->ck_base))
+	ck->ck_mapped = TRUE;
+    else {
+	if (!(ck->ck_base = malloc((size_t)ch.ch_size))) {
+	    fprintf(ck->ck_of, "Cannot allocate %ld bytes for \"%s\"\n",
+			ch.ch_size, ck->ck_path);
+	    return FALSE;
+	}
+	if (fseek(f, 0L, SEEK_SET)
+	  || fread(ck->ck_base, 1, (size_t)ch.ch_size, f)
+				!= (size_t)ch.ch_size) {
+	    fprintf(ck->ck_of, "Error reading \"%s\"\n", ck->ck_path);
+	    ckp_unread(ck);
+	    return FALSE;
+	}
+    }
+
+    /* Walk the sections to be sure they're all there */
+    for (off = ck->ck_secoff;
+	 off + ckp_round((long)sizeof(*cs)) <= ck->ck_size; ) {
+	cs = (struct ckpsec *)(ck->ck_base + off);
+	off += ckp_round((long)sizeof(*cs));
+	if (cs->cs_len < 0 || cs->cs_len > ck->ck_size - off)
+	    break;
+	off += cs->cs_len;
+	if (ckp_secis(cs, "END")) {
+	    endok = TRUE;
+	    ck->ck_size = off;
+	    break;
+	}
+    }
+    if (!endok) {
+	fprintf(ck->ck_of, "\"%s\" is truncated or damaged\n", ck->ck_path);
+	ckp_unread(ck);
+	return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+ckp_unread(struct ckpt_s *ck)
+{
+    if (ck->ck_base) {
+	if (ck->ck_mapped)
+	    os_fmunmap(ck->ck_base, (size_t)ck->ck_size);
+	else
+	    free(ck->ck_base);
+	ck->ck_base = NULL;
+    }
+}
+
+/* CKP_CPUREST - Copy machine registers from saved CPU state.
+**	Anything that points into our own address space, belongs to
+**	another module (clock, FE), or is a cache or a statistic, is left
+**	alone; pag_ckprest then rebuilds the internal pager state.
+*/
+static void
+ckp_cpurest(register struct machstate *s)
+{
+    cpu.acs = s->acs;
+    cpu.mr_acbcur = s->mr_acbcur;
+    memcpy((char *)cpu.acblks, (char *)s->acblks, sizeof(cpu.acblks));
+    cpu.mr_pcflags = s->mr_pcflags;
+    cpu.mr_PC = s->mr_PC;
+#if KLH10_JPC
+    cpu.mr_jpc = s->mr_jpc;
+    cpu.mr_ujpc = s->mr_ujpc;
+    cpu.mr_ejpc = s->mr_ejpc;
+#endif
+#if KLH10_CPU_KS
+    cpu.mr_hsb = s->mr_hsb;
+    cpu.io_ctydelay = s->io_ctydelay;
+#elif KLH10_CPU_KL
+    cpu.mr_abk_addr = s->mr_abk_addr;
+    cpu.mr_abk_pagno = s->mr_abk_pagno;
+    cpu.mr_abk_pmmask = s->mr_abk_pmmask;
+    cpu.mr_abk_cond = s->mr_abk_cond;
+#elif KLH10_CPU_KI
+    cpu.mr_adrbrk = s->mr_adrbrk;
+#endif
+    cpu.mr_ebr = s->mr_ebr;
+    cpu.mr_ubr = s->mr_ubr;
+    cpu.mr_paging = s->mr_paging;
+    cpu.mr_usrmode = s->mr_usrmode;
+    cpu.mr_inpxct = s->mr_inpxct;
+#if KLH10_CPU_KLX
+    cpu.mr_pxctpc = s->mr_pxctpc;
+#endif
+    cpu.mr_intrap = s->mr_intrap;
+#if KLH10_ITS_1PROC
+    cpu.mr_in1proc = s->mr_in1proc;
+#elif KLH10_CPU_KI || KLH10_CPU_KL
+    cpu.mr_inafi = s->mr_inafi;
+#endif
+    cpu.mr_injrstf = s->mr_injrstf;
+    cpu.mr_inpi = s->mr_inpi;
+
+    cpu.pag = s->pag;
+    cpu.aprf = s->aprf;
+    cpu.pi = s->pi;
+    cpu.tim = s->tim;
+    cpu.mr_dsw = s->mr_dsw;
+    cpu.mr_haltpc = s->mr_haltpc;
+}
+
+#endif /* KLH10_CKPT */
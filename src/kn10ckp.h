@@ -0,0 +1,47 @@
+/* KN10CKP.H - KLH10 machine checkpoint/restore definitions
+*/
+/*  Copyright 2026 The KLH10 contributors
+**  All Rights Reserved
+**
+**  This file is part of the KLH10 Distribution.  Use, modification, and
+**  re-distribution is permitted subject to the terms in the file
+**  named "LICENSE", which contains the full text of the legal notices
+**  and should always accompany this Distribution.
+**
+**  This software is provided "AS IS" with NO WARRANTY OF ANY KIND.
+**
+**  This notice (including the copyright and warranty disclaimer)
+**  must be included in all copies or derivations of this software.
+*/
+
+#ifndef KN10CKP_INCLUDED
+#define KN10CKP_INCLUDED 1
+
+#if KLH10_CKPT
+
+#include <stdio.h>
+#include "word10.h"
+
+struct ckpt_s;		/* Checkpoint file in progress, private to kn10ckp.c */
+
+extern int ckp_save(FILE *, char *);	/* Write checkpoint file */
+extern int ckp_restore(FILE *, char *, int);	/* Reload machine from one */
+
+/* For the save/restore routines of other modules.
+**	A checkpoint is a series of sections, each holding whatever its
+** owner chose to put there.  While saving, ckp_put appends an item of
+** LEN bytes to the section being written; while restoring, ckp_get
+** returns a pointer to the next item of the current section (suitably
+** aligned for any struct), or NULL if the section is too short or the
+** item wasn't saved with the same LEN, as when a struct has changed.
+*/
+extern int    ckp_secbeg(struct ckpt_s *, char *, char *);
+extern int    ckp_secend(struct ckpt_s *);
+extern int    ckp_secfind(struct ckpt_s *, char *, char *);
+extern int    ckp_put(struct ckpt_s *, void *, size_t);
+extern void  *ckp_get(struct ckpt_s *, size_t);
+extern w10_t *ckp_vmptr(struct ckpt_s *, w10_t *);  /* Relocate ptr to mem */
+extern FILE  *ckp_outf(struct ckpt_s *);	/* Stream for complaints */
+
+#endif /* KLH10_CKPT */
+#endif /* ifndef KN10CKP_INCLUDED */
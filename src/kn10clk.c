@@ -30,15 +30,16 @@
 #if KLH10_CLKTRG_OSINT
 # include "osdsup.h"	/* For os_vtimer */
 #endif
+#include <stdio.h>
+#if KLH10_CKPT
+# include <string.h>
+# include "kn10ckp.h"
+#endif
 
 #ifdef RCSID
  RCSID(kn10clk_c,"$Id: kn10clk.c,v 2.3 2001/11/10 21:28:59 klh Exp $")
 #endif
 
-#ifndef KLH10_CLK_MAXTIMERS		/* Max # of timer entries */
-#  define KLH10_CLK_MAXTIMERS 32
-#endif
-
 /*
 
 The KN10CLK code operates on "cticks" which are internal units of a
@@ -138,6 +139,15 @@ FREE LIST:
 	Singly-linked list of free entries.
 	State CLKENT_ST_FREE.
 
+With KLH10_CLK_WHEEL, the MTICK queue is instead a hashed timing wheel
+of KLH10_CLK_WHSIZE slots, each a doubly-linked list.  An entry's
+cke_ticks holds the absolute ITICK # at which it is due, and it lives
+in the slot that # selects; timers longer than one turn of the wheel
+just sit through the turns that aren't theirs.  Inserting and deleting
+are constant time, and each ITICK only looks at one slot.  Entries due
+on the current ITICK are moved to a firing list before any callout is
+made, so callouts are free to set, quiet or kill any timer.
+
 
 Need to decide:
 	Should ACTIVE drive ITICK, or other way around?
@@ -285,9 +295,10 @@ clk_usec2clk(int32 usec)
     **		<N usec> * <cycles per usec>
     ** which is
     **		<N usec> * (<ipms> / 1000)
-    ** which is rearranged as below to avoid integer roundoff error.
+    ** which is rearranged as below to avoid integer roundoff error,
+    ** and done in double so a large ipms can't overflow the product.
     */
-    val = (usec * cpu.clk.clk_ipms) / 1000;
+    val = ((double)usec * cpu.clk.clk_ipms) / 1000;
 #elif KLH10_CLKTRG_OSINT
     val = ((usec + cpu.clk.clk_htickusec) / cpu.clk.clk_tickusec);
 #endif
@@ -299,7 +310,7 @@ clk_clk2usec(clkval_t clk)
 {
 #if KLH10_CLKTRG_COUNT
     /* Inverse of computation for usec2clk */
-    return  (clk * 1000) / cpu.clk.clk_ipms;
+    return  ((double)clk * 1000) / cpu.clk.clk_ipms;
 #elif KLH10_CLKTRG_OSINT
     return clk * cpu.clk.clk_tickusec;
 #endif
@@ -330,13 +341,57 @@ clk_usec2tick(int32 usec)
 
 /* Clock queue entries (timers)
 */
+#if KLH10_MULTI
+# define clkenttab cpu.clk.clk_tab	/* Each machine has its own */
+#else
 static struct clkent clkenttab[KLH10_CLK_MAXTIMERS];
+#endif
 
 static void clk_stinsert(struct clkent *ce);
 static void clk_stdelete(struct clkent *ce);
 static void clk_qinsert(struct clkent *ce, struct clkent **qh);
+
+/* MTICK queue operations:
+**	clk_mtinsert(e) - Insert, due cke_oticks ITICKs from now.
+**	clk_mtdelete(e) - Remove.
+**	clk_mtleft(e)   - # ITICKs until due.
+*/
+#if KLH10_CLK_WHEEL
+static void clk_whinsert(struct clkent *ce, uint32 due);
+# define clk_mtinsert(e) clk_whinsert((e), cpu.clk.clk_inow + (e)->cke_oticks)
+# define clk_mtdelete(e) clk_2ldelete(e)
+# define clk_mtleft(e) ((clkval_t)((uint32)(e)->cke_ticks - cpu.clk.clk_inow))
+#else
+# define clk_mtinsert(e) clk_qinsert((e), &cpu.clk.clk_itickq)
+# define clk_mtdelete(e) clk_qdelete(e)
+# if KLH10_CKPT
+static clkval_t clk_mtleft(struct clkent *);
+# endif
+#endif
 static void clk_osint(void);
 static void clk_itusset(int32 usec);
+#if KLH10_CLKTRG_COUNT && KLH10_CLK_ADAPT
+static void clk_adtick(void);
+# define clk_adrestart() (cpu.clk.clk_adn = 0, cpu.clk.clk_adbase = 0.0, \
+			  cpu.clk.clk_adstall = FALSE)
+#endif
+
+/* CLK_OSTIMER - Start or stop (usec 0) host interval timer for OSINT.
+*/
+#if KLH10_CLKTRG_OSINT && KLH10_CLK_TIMERFD
+static void clk_tfdint(void *);
+# define clk_ostimer(usec) os_tfdtimer(clk_tfdint, (void *)&cpu, (usec))
+#else
+# define clk_ostimer(usec) os_vtimer((ossighandler_t *)clk_osint, (usec))
+#endif
+
+/* CLK_BELLIDLE - Tell the DP doorbell thread whether we're idling.
+*/
+#if KLH10_EVHS_BELL
+# define clk_bellidle(on) os_bellidle((void *)&cpu, (on))
+#else
+# define clk_bellidle(on)
+#endif
 
 
 void
@@ -355,6 +410,12 @@ clk_init(void)
     cpu.clk.clk_itickq = NULL;
     cpu.clk.clk_itickl = NULL;
     cpu.clk.clk_quiet = NULL;
+#if KLH10_CLK_WHEEL
+    cpu.clk.clk_fireq = NULL;
+    cpu.clk.clk_inow = 0;
+    for (i = 0; i < KLH10_CLK_WHSIZE; ++i)
+	cpu.clk.clk_wheel[i] = NULL;
+#endif
 
 #if KLH10_CLKTRG_OSINT
     /* Currently OSINT mode must always have a default itick interval;
@@ -394,6 +455,13 @@ clk_init(void)
 
     cpu.clk.clk_ipms = 1000;		/* Default 1:1 instrs:usec */
     cpu.clk.clk_ipmsrq = cpu.clk.clk_ipms;
+# if KLH10_CLK_ADAPT
+    cpu.clk.clk_adapt = TRUE;		/* Start from 1:1 and retune */
+    cpu.clk.clk_aderr = 0.0;
+    cpu.clk.clk_adppm = 0;
+    cpu.clk.clk_adnset = cpu.clk.clk_adnskip = 0;
+    clk_adrestart();
+# endif
 
     /* Set up ctick stuff */
     cpu.clk.clk_counter = cpu.clk.clk_ocnt = CLKVAL_NEVER;
@@ -416,14 +484,16 @@ void
 clk_suspend(void)
 {
 #if KLH10_CLKTRG_OSINT
-    os_vtimer((ossighandler_t *)clk_osint, (uint32)0);
+    clk_ostimer((uint32)0);
 #endif
 }
 void
 clk_resume(void)
 {
 #if KLH10_CLKTRG_OSINT
-    os_vtimer((ossighandler_t *)clk_osint, cpu.clk.clk_itickusec);
+    clk_ostimer(cpu.clk.clk_itickusec);
+#elif KLH10_CLK_ADAPT
+    clk_adrestart();		/* Time spent halted is not measured */
 #endif
 }
 
@@ -445,7 +515,7 @@ void
 clk_idle(void)
 {
 #if KLH10_CLKTRG_COUNT
-    uint32 usec;
+    int32 usec;
 
     /* Figure usec to next synchronized interrupt */
     usec = clk_clk2usec(CLK_CTICKS_UNTIL_ITICK());
@@ -456,12 +526,26 @@ clk_idle(void)
     /* Sleep until:
     **	timeout of usec (all gone, restart interval)
     **	or some other interrupt (some left, adjust interval)
+    ** then fast-forward the countdown over the time actually slept,
+    ** so the interval timer sees the same ticks as if we had spun.
     */
-	/* KLH: NEEDS IMPLEMENTATION HERE */
+    clk_bellidle(TRUE);
+    usec = os_rtidle(usec);
+    clk_bellidle(FALSE);
+    cpu.clk.clk_counter =		/* If all slept, trigger at next poll */
+	usec ? clk_usec2clk(usec) : 1;
+
+#elif KLH10_CLKTRG_OSINT && KLH10_CLK_TIMERFD
+
+    clk_bellidle(TRUE);
+    os_tfdidle((void *)&cpu);
+    clk_bellidle(FALSE);
 
 #elif KLH10_CLKTRG_OSINT
 
+    clk_bellidle(TRUE);
     os_v2rt_idle((ossighandler_t *)clk_osint);
+    clk_bellidle(FALSE);
 
 #endif
 }
@@ -474,6 +558,20 @@ clk_osint(void)
     CLK_TRIGGER();	/* For now, macro that triggers synch call */
 }
 
+#if KLH10_CLKTRG_OSINT && KLH10_CLK_TIMERFD
+/* CLK_TFDINT - Same, but called from the host timer thread, which must
+**	first be pointed at the machine that armed the timer.
+*/
+static void
+clk_tfdint(void *m)
+{
+# if KLH10_MULTI
+    kn10_cpu = (struct machstate *)m;
+# endif
+    clk_osint();
+}
+#endif
+
 
 /* CLK_SYNCTIMEOUT - called from synchronization point to invoke clock timeout.
 **	If no sub-iticks supported, always invokes clk_itimeout functionality.
@@ -556,6 +654,11 @@ clk_synctimeout(void)
     /* Reset ctick counter to use a full tick */
     cpu.clk.clk_counter = cpu.clk.clk_ocnt = cpu.clk.clk_icntval;
     cpu.clk.clk_icnter = 0;
+#  if KLH10_CLK_ADAPT
+    if (cpu.clk.clk_adapt
+      && ++cpu.clk.clk_adn * cpu.clk.clk_itickusec >= KLH10_CLK_ADWIN)
+	clk_adtick();		/* End of window, maybe retune */
+#  endif
 # endif
 
     /* Now check for special ITICK callouts */
@@ -574,6 +677,61 @@ clk_synctimeout(void)
 #endif /* KLH10_CLKRES_ITICK */
 
     /* Now check for callouts of ITICK resolution which aren't ITICKs */
+#if KLH10_CLK_WHEEL
+    /* Turn the wheel one slot and move what is due now onto the firing
+    ** list, leaving entries due on later turns where they are.
+    */
+    ++cpu.clk.clk_inow;
+    ce = cpu.clk.clk_wheel[cpu.clk.clk_inow & (KLH10_CLK_WHSIZE-1)];
+    for (; ce; ce = nce) {
+	nce = ce->cke_next;
+	if ((uint32)ce->cke_ticks == cpu.clk.clk_inow) {
+	    clk_2ldelete(ce);
+	    ce->cke_prev = (struct clkent *)&cpu.clk.clk_fireq;
+	    if ((ce->cke_next = cpu.clk.clk_fireq))
+		ce->cke_next->cke_prev = ce;
+	    cpu.clk.clk_fireq = ce;
+	}
+    }
+
+    /* Each entry stays at the head of the firing list while its callout
+    ** runs, so that it can be set or killed there like anywhere else.
+    */
+    while ((ce = cpu.clk.clk_fireq)) {
+	switch ((*(ce->cke_rtn))(ce->cke_arg)) {
+	default:
+	    /* panic?? */
+
+	case CLKEVH_RET_NOP:	/* Do nothing (handler hacked self) */
+	    if (cpu.clk.clk_fireq == ce) {	/* Unless it didn't */
+		clk_2ldelete(ce);		/* then try again next tick */
+		clk_whinsert(ce, cpu.clk.clk_inow + 1);
+	    }
+	    break;
+
+	case CLKEVH_RET_KILL:	/* Kill, put on freelist */
+	    clk_2ldelete(ce);
+	    ce->cke_state = CLKENT_ST_FREE;
+	    ce->cke_next = cpu.clk.clk_free;
+	    cpu.clk.clk_free = ce;
+	    break;
+
+	case CLKEVH_RET_QUIET:	/* Go quiescent */
+	    clk_2ldelete(ce);
+	    ce->cke_state = CLKENT_ST_MQUIET;
+	    ce->cke_prev = (struct clkent *)&cpu.clk.clk_quiet;
+	    if ((ce->cke_next = cpu.clk.clk_quiet))
+		ce->cke_next->cke_prev = ce;
+	    cpu.clk.clk_quiet = ce;
+	    break;
+
+	case CLKEVH_RET_REPEAT:	/* Put back on wheel */
+	    clk_2ldelete(ce);
+	    clk_mtinsert(ce);
+	    break;
+	}
+    }
+#else
     if ((ce = cpu.clk.clk_itickq)
       && --(ce->cke_ticks) <= 0) {
 	do {
@@ -616,6 +774,7 @@ clk_synctimeout(void)
 	    }
 	} while ((ce = nce) && ce->cke_ticks <= 0);
     }
+#endif /* !KLH10_CLK_WHEEL */
 }
 
 
@@ -659,7 +818,7 @@ clk_tmrget(int (*rtn)(void *), void *arg, int32 usec)
 	ce->cke_arg = arg;
 	ce->cke_usec = usec;
 	ce->cke_oticks = clk_usec2tick(usec);	/* Convert time to ITICKS */
-	clk_qinsert(ce, &cpu.clk.clk_itickq);
+	clk_mtinsert(ce);
     }
     return ce;
 }
@@ -740,10 +899,10 @@ clk_tmrset(register struct clkent *ce, int32 usec)
 	break;
 
     case CLKENT_ST_MTICK:
-	clk_qdelete(ce);	/* Take off mtick queue list */
+	clk_mtdelete(ce);	/* Take off mtick queue list */
 	ce->cke_usec = usec;	/* Set new time values */
 	ce->cke_oticks = clk_usec2tick(usec);	/* Convert to iticks */
-	clk_qinsert(ce, &cpu.clk.clk_itickq);	/* Insert back into queue */
+	clk_mtinsert(ce);	/* Insert back into queue */
 	break;
     }
 }
@@ -764,7 +923,7 @@ clk_tmrquiet(register struct clkent *ce)
 	return;
 
     case CLKENT_ST_MTICK:		/* Active on ITICK queue */
-	clk_qdelete(ce);		/* Take off its list */
+	clk_mtdelete(ce);		/* Take off its list */
 	ce->cke_state = CLKENT_ST_MQUIET;
 	break;
 
@@ -811,7 +970,7 @@ clk_tmractiv(register struct clkent *ce)
     case CLKENT_ST_MQUIET:
 	clk_2ldelete(ce);		/* Take off its list */
 	ce->cke_state = CLKENT_ST_MTICK;
-	clk_qinsert(ce, &cpu.clk.clk_itickq);	/* add onto ITICK queue */
+	clk_mtinsert(ce);		/* add onto ITICK queue */
 	break;
 
     case CLKENT_ST_QUIET:
@@ -845,7 +1004,7 @@ clk_tmrkill(register struct clkent *ce)
 	break;
 
     case CLKENT_ST_MTICK:
-	clk_qdelete(ce);		/* Take off clock queue */
+	clk_mtdelete(ce);		/* Take off clock queue */
 	break;
 
     case CLKENT_ST_QUIET:
@@ -897,6 +1056,45 @@ clk_qinsert(register struct clkent *ce,
 
 
 
+#if KLH10_CLK_WHEEL
+
+/* Insert entry into the timing wheel, due on ITICK # "due".
+*/
+static void
+clk_whinsert(register struct clkent *ce,
+	     uint32 due)
+{
+    register struct clkent **qh;
+
+    ce->cke_ticks = (clkval_t)due;
+    qh = &cpu.clk.clk_wheel[due & (KLH10_CLK_WHSIZE-1)];
+    ce->cke_prev = (struct clkent *)qh;
+    if ((ce->cke_next = *qh))
+	ce->cke_next->cke_prev = ce;
+    *qh = ce;
+}
+
+#elif KLH10_CKPT
+
+/* Find # ITICKs until entry on ITICK queue is due.
+**	Only needed to checkpoint the queue.
+*/
+static clkval_t
+clk_mtleft(register struct clkent *ce)
+{
+    register struct clkent *qe;
+    register clkval_t left = 0;
+
+    for (qe = cpu.clk.clk_itickq; qe; qe = qe->cke_next) {
+	left += qe->cke_ticks;
+	if (qe == ce)
+	    break;
+    }
+    return left;
+}
+
+#endif /* !KLH10_CLK_WHEEL && KLH10_CKPT */
+
 /* Insert entry into sub-itick queue.
 **	Needs special hackery to update separate sub-itick counter.
 */
@@ -1055,7 +1253,11 @@ static void
 clk_itusset(int32 usec)
 {
     register struct clkent *ce;
+#if KLH10_CLK_WHEEL
+    register int i;
+#else
     register clkval_t clkval;
+#endif
 
 #if KLH10_CLKRES_ITICK
 # if KLH10_CLKTRG_COUNT
@@ -1076,6 +1278,15 @@ clk_itusset(int32 usec)
     /* Update itick clock queue.
     ** For each entry, convert ticks, then update relative count.
     */
+#if KLH10_CLK_WHEEL
+    /* Same effect here: each entry starts over with its new interval */
+    for (i = 0, ce = clkenttab; i < KLH10_CLK_MAXTIMERS; ++i, ++ce)
+	if (ce->cke_state == CLKENT_ST_MTICK) {
+	    clk_mtdelete(ce);
+	    ce->cke_oticks = clk_usec2tick(ce->cke_usec);
+	    clk_mtinsert(ce);
+	}
+#else
     clkval = 0;
     for (ce = cpu.clk.clk_itickq; ce; ce = ce->cke_next) {
 	ce->cke_oticks = clk_usec2tick(ce->cke_usec);
@@ -1083,6 +1294,7 @@ clk_itusset(int32 usec)
 	    ce->cke_ticks = 0;
 	clkval += ce->cke_ticks;
     }
+#endif
 
     /* Update quiescent list - do all entries that might go back
     ** on itick queue later.
@@ -1100,7 +1312,7 @@ clk_itusset(int32 usec)
 #if KLH10_CLKRES_ITICK
 # if KLH10_CLKTRG_OSINT
     /* Tell OS about new interval! */
-    os_vtimer((ossighandler_t *)clk_osint, cpu.clk.clk_itickusec);
+    clk_ostimer(cpu.clk.clk_itickusec);
 
 # elif KLH10_CLKTRG_COUNT
     /* Now restore state of interval countdown */
@@ -1112,6 +1324,295 @@ clk_itusset(int32 usec)
 #endif /* KLH10_CLKRES_ITICK */
 }
 
+#if KLH10_CKPT
+
+/* Checkpoint and restore of clock state.
+**	Timers belong to devices that are re-created from the init file
+** when the emulator starts, so a saved timer is identified by its callout
+** routine (as an offset from clk_init, which survives address space
+** randomization) plus its rank among the in-use entries having that
+** routine.  Restore finds the live timer so identified and gives it the
+** saved state and remaining time; the callout argument is left alone.
+*/
+struct clkckp {
+	int32 ck_itickusec;	/* Interval in effect */
+	int32 ck_ithzosreq;	/* Last OS request */
+	int32 ck_ipms;		/* COUNT only: instrs per msec */
+	clkval_t ck_counter;	/* COUNT only: interval countdown state */
+	clkval_t ck_ocnt;
+	clkval_t ck_icnter;
+	int ck_nents;		/* # of clkentck records that follow */
+};
+struct clkentck {
+	long cec_rtnoff;	/* Callout addr minus clk_init addr */
+	int cec_rank;		/* Rank among in-use entries with same callout */
+	int cec_state;		/* enum clksta */
+	clkval_t cec_left;	/* Absolute ticks til timeout, if MTICK */
+	clkval_t cec_oticks;
+	int32 cec_usec;
+};
+
+#define clk_rtnoff(ce) ((long)((char *)(ce)->cke_rtn - (char *)clk_init))
+
+static int
+clk_rank(register struct clkent *ce)
+{
+    register struct clkent *e;
+    register int rank = 0;
+
+    for (e = clkenttab; e < ce; ++e)
+	if (e->cke_state != CLKENT_ST_FREE && e->cke_rtn == ce->cke_rtn)
+	    ++rank;
+    return rank;
+}
+
+/* CLK_CKPSAVE - Save clock state into current checkpoint section.
+*/
+int
+clk_ckpsave(struct ckpt_s *ck)
+{
+    struct clkckp cc;
+    struct clkentck ec;
+    register struct clkent *ce;
+    register int i;
+
+    memset((char *)&cc, 0, sizeof(cc));
+    cc.ck_itickusec = cpu.clk.clk_itickusec;
+    cc.ck_ithzosreq = cpu.clk.clk_ithzosreq;
+    cc.ck_ipms = cpu.clk.clk_ipms;
+    cc.ck_counter = cpu.clk.clk_counter;
+    cc.ck_ocnt = cpu.clk.clk_ocnt;
+    cc.ck_icnter = cpu.clk.clk_icnter;
+    for (i = 0, ce = clkenttab; i < KLH10_CLK_MAXTIMERS; ++i, ++ce)
+	if (ce->cke_state != CLKENT_ST_FREE)
+	    ++cc.ck_nents;
+    if (!ckp_put(ck, &cc, sizeof(cc)))
+	return FALSE;
+
+    for (i = 0, ce = clkenttab; i < KLH10_CLK_MAXTIMERS; ++i, ++ce) {
+	if (ce->cke_state == CLKENT_ST_FREE)
+	    continue;
+	memset((char *)&ec, 0, sizeof(ec));
+	ec.cec_rtnoff = clk_rtnoff(ce);
+	ec.cec_rank = clk_rank(ce);
+	ec.cec_state = ce->cke_state;
+	ec.cec_oticks = ce->cke_oticks;
+	ec.cec_usec = ce->cke_usec;
+	if (ce->cke_state == CLKENT_ST_MTICK)
+	    ec.cec_left = clk_mtleft(ce);
+	if (!ckp_put(ck, &ec, sizeof(ec)))
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+/* CLK_CKPREST - Restore clock state from current checkpoint section.
+**	If DOREST is FALSE, only checks that the section is good and that
+**	every saved timer has a live counterpart, changing nothing.
+**	Returns FALSE if not.
+*/
+int
+clk_ckprest(struct ckpt_s *ck, int dorest)
+{
+    struct clkckp *cc;
+    struct clkentck *ec;
+    register struct clkent *ce;
+    register int i, n;
+
+    if (!(cc = (struct clkckp *)ckp_get(ck, sizeof(*cc))))
+	return FALSE;
+
+    if (dorest) {
+	cpu.clk.clk_ithzosreq = cc->ck_ithzosreq;
+	if (!cpu.clk.clk_ithzfix && cc->ck_itickusec
+	  && cc->ck_itickusec != cpu.clk.clk_itickusec)
+	    clk_itusset(cc->ck_itickusec);
+#if KLH10_CLKTRG_COUNT
+	if (cc->ck_ipms == cpu.clk.clk_ipms
+	  && cc->ck_itickusec == cpu.clk.clk_itickusec) {
+	    cpu.clk.clk_counter = cc->ck_counter;
+	    cpu.clk.clk_ocnt = cc->ck_ocnt;
+	    cpu.clk.clk_icnter = cc->ck_icnter;
+	}
+#endif
+    }
+
+    for (n = cc->ck_nents; --n >= 0; ) {
+	if (!(ec = (struct clkentck *)ckp_get(ck, sizeof(*ec))))
+	    return FALSE;
+	for (i = 0, ce = clkenttab; i < KLH10_CLK_MAXTIMERS; ++i, ++ce) {
+	    if (ce->cke_state != CLKENT_ST_FREE
+	      && clk_rtnoff(ce) == ec->cec_rtnoff
+	      && clk_rank(ce) == ec->cec_rank)
+		break;
+	}
+	if (i >= KLH10_CLK_MAXTIMERS) {
+	    fprintf(ckp_outf(ck),
+		"Checkpoint has a timer (callout %+ld #%d) not defined here\n",
+		ec->cec_rtnoff, ec->cec_rank);
+	    return FALSE;
+	}
+	if (!dorest)
+	    continue;
+
+	clk_tmrquiet(ce);		/* Start from a known state */
+	ce->cke_usec = ec->cec_usec;
+	switch (ec->cec_state) {
+	case CLKENT_ST_MTICK:
+	    /* Insert with remaining time, then set real interval */
+	    clk_2ldelete(ce);
+	    ce->cke_state = CLKENT_ST_MTICK;
+	    ce->cke_oticks = ec->cec_left > 0 ? ec->cec_left : 1;
+	    clk_mtinsert(ce);
+	    ce->cke_oticks = clk_usec2tick(ce->cke_usec);
+	    break;
+	case CLKENT_ST_ITICK:
+	    clk_tmractiv(ce);
+	    break;
+	case CLKENT_ST_MQUIET:
+	    ce->cke_oticks = clk_usec2tick(ce->cke_usec);
+	    break;
+	default:			/* Quiet of other kinds */
+	    ce->cke_oticks = ec->cec_oticks;
+	    break;
+	}
+    }
+    return TRUE;
+}
+
+#endif /* KLH10_CKPT */
+
+/* CLK_QSHOW - Show how timers are being used.
+*/
+void
+clk_qshow(FILE *f)
+{
+    register struct clkent *ce;
+    register int i;
+    int nst[CLKENT_ST_MQUIET+1];
+#if KLH10_CLK_WHEEL
+    int n, nused = 0, nmax = 0;
+#endif
+
+    for (i = 0; i <= CLKENT_ST_MQUIET; ++i)
+	nst[i] = 0;
+    for (i = 0, ce = clkenttab; i < KLH10_CLK_MAXTIMERS; ++i, ++ce)
+	if ((int)ce->cke_state <= CLKENT_ST_MQUIET)
+	    ++nst[ce->cke_state];
+    fprintf(f, "Timers: %d of %d free, %d every-itick, %d multi-itick, %d quiet\n",
+		nst[CLKENT_ST_FREE], KLH10_CLK_MAXTIMERS,
+		nst[CLKENT_ST_ITICK], nst[CLKENT_ST_MTICK],
+		nst[CLKENT_ST_IQUIET] + nst[CLKENT_ST_MQUIET]
+		+ nst[CLKENT_ST_QUIET]);
+#if KLH10_CLK_WHEEL
+    for (i = 0; i < KLH10_CLK_WHSIZE; ++i) {
+	for (n = 0, ce = cpu.clk.clk_wheel[i]; ce; ce = ce->cke_next)
+	    ++n;
+	if (n) {
+	    ++nused;
+	    if (n > nmax)
+		nmax = n;
+	}
+    }
+    fprintf(f, "Timing wheel: %d slots, %d in use, at most %d per slot, at itick %lu\n",
+		KLH10_CLK_WHSIZE, nused, nmax, (unsigned long)cpu.clk.clk_inow);
+#else
+    fprintf(f, "Multi-itick timers kept on sorted list\n");
+#endif
+#if KLH10_CLKTRG_COUNT && KLH10_CLK_ADAPT
+    fprintf(f, "Clock rate: %ld instrs per virtual msec, %s (requested %ld)\n",
+		(long)cpu.clk.clk_ipms,
+		cpu.clk.clk_adapt ? "adaptive" : "fixed",
+		(long)cpu.clk.clk_ipmsrq);
+    fprintf(f, "  last window %+ld ppm, virtual time %+.0f usec from real, %lu retunes, %lu windows skipped\n",
+		cpu.clk.clk_adppm, cpu.clk.clk_aderr,
+		cpu.clk.clk_adnset, cpu.clk.clk_adnskip);
+#elif KLH10_CLKTRG_COUNT
+    fprintf(f, "Clock rate: %ld instrs per virtual msec, fixed\n",
+		(long)cpu.clk.clk_ipms);
+#endif
+#if KLH10_CLKTRG_OSINT && KLH10_CLK_TIMERFD
+    {
+	unsigned long nticks, nover;
+	long maxlate;
+
+	os_tfdstats((void *)&cpu, &nticks, &nover, &maxlate);
+	fprintf(f, "Host timer: timerfd thread, %ld usec interval, %lu ticks, %lu missed, at most %ld usec late\n",
+		(long)cpu.clk.clk_itickusec, nticks, nover, maxlate);
+    }
+#endif
+}
+
+/* CLK_BENCH - Time "n" random timer operations.
+**	Takes every free timer entry and churns them the way devices do:
+**	mostly re-arming with a new interval, sometimes quieting and
+**	re-activating.  The clock is not advanced, so none of the bench
+**	timers fire and existing timers are left as they were, apart from
+**	their order on the queues.  Call only while the KN10 is halted.
+*/
+static int
+clk_benchrtn(void *arg)
+{
+    return CLKEVH_RET_REPEAT;
+}
+
+void
+clk_bench(FILE *f, long n)
+{
+    struct clkent *tv[KLH10_CLK_MAXTIMERS];
+    register struct clkent *ce;
+    register unsigned long r = 1;
+    register long i;
+    int nt, nact;
+    osrtm_t rtm0, rtm1;
+    double usec;
+
+    if (!cpu.clk.clk_itickusec) {
+	fprintf(f, "?No interval tick set yet\n");
+	return;
+    }
+    nact = 0;
+    for (i = 0, ce = clkenttab; i < KLH10_CLK_MAXTIMERS; ++i, ++ce)
+	if (ce->cke_state == CLKENT_ST_MTICK)
+	    ++nact;
+    for (nt = 0; nt < KLH10_CLK_MAXTIMERS; ++nt)
+	if (!(tv[nt] = clk_tmrget(clk_benchrtn, (void *)NULL,
+				  (int32)(nt+1) * 10000)))
+	    break;
+    if (!nt) {
+	fprintf(f, "?No free timers\n");
+	return;
+    }
+
+    os_rtmget(&rtm0);
+    for (i = n; --i >= 0; ) {
+	r ^= (r << 13) & 0xFFFFFFFFUL;		/* 32-bit xorshift */
+	r ^= r >> 17;
+	r ^= (r << 5) & 0xFFFFFFFFUL;
+	ce = tv[(r >> 4) % nt];
+	switch (r & 07) {
+	default:		/* Re-arm, up to about 4 sec */
+	    clk_tmrset(ce, (int32)((r >> 10) & 03777777) + 1);
+	    break;
+	case 6:
+	    clk_tmrquiet(ce);
+	    break;
+	case 7:
+	    clk_tmractiv(ce);
+	    break;
+	}
+    }
+    os_rtmget(&rtm1);
+    os_rtmsub(&rtm1, &rtm0);
+
+    for (i = 0; i < nt; ++i)
+	clk_tmrkill(tv[i]);
+
+    usec = ((double)OS_RTM_SEC(rtm1) * 1000000.0) + OS_RTM_USEC(rtm1);
+    fprintf(f, "%ld timer ops on %d timers (%d others active): %.0f usec, %.1f nsec/op\n",
+		n, nt, nact, usec, n ? (usec * 1000.0) / n : 0.0);
+}
+
 #if KLH10_CLKTRG_COUNT
 
 /* Set virtual clock speed - instrs per msec.
@@ -1146,7 +1647,85 @@ clk_ipmsset(int32 ipms)
     cpu.clk.clk_ocnt = cpu.clk.clk_icntval;	/* Assume started with itick */
     cpu.clk.clk_counter =
 		cpu.clk.clk_ocnt - cpu.clk.clk_icnter;
+#if KLH10_CLK_ADAPT
+    cpu.clk.clk_aderr = 0.0;		/* New starting point */
+    clk_adrestart();
+#endif
 }
 
+#if KLH10_CLK_ADAPT
+
+/* CLK_ADTICK - Adaptive clock speed, invoked at the ITICK boundary that
+**	ends each measuring window of KLH10_CLK_ADWIN virtual usec.
+**	Every ITICK counts off exactly clk_icntval instructions, so
+**	comparing the window's virtual length with the real time it took
+**	gives the instruction rate the host actually achieved.  The new
+**	ipms is that rate, nudged to work off a quarter of the accumulated
+**	virtual-vs-real error, and moved only halfway there to damp noise.
+**	A window taking over 8 times its virtual length looks like a host
+**	stall (or a stop that clk_resume didn't see) and is thrown away
+**	along with the error so far, unless the one before it was too;
+**	lost time is not made up.
+**	Retuning happens only here, right after the counter was reloaded,
+**	so the interval in progress is always a whole ITICK and guest time
+**	stays monotonic.
+*/
+static void
+clk_adtick(void)
+{
+    osrtm_t rtm;
+    register double now, real, virt, ipms, fac;
+
+    virt = (double)cpu.clk.clk_adn * cpu.clk.clk_itickusec;
+    cpu.clk.clk_adn = 0;
+    os_rtmget(&rtm);
+    now = ((double)OS_RTM_SEC(rtm) * 1000000.0) + OS_RTM_USEC(rtm);
+    if (cpu.clk.clk_adbase == 0.0) {	/* First window only sets base */
+	cpu.clk.clk_adbase = now;
+	return;
+    }
+    real = now - cpu.clk.clk_adbase;
+    cpu.clk.clk_adbase = now;
+    if (real <= 0.0)
+	return;				/* Host clock went backwards? */
+    if (real > virt*8 && !cpu.clk.clk_adstall) {
+	cpu.clk.clk_adstall = TRUE;	/* Once is a stall, twice is slow */
+	cpu.clk.clk_aderr = 0.0;
+	cpu.clk.clk_adnskip++;
+	return;
+    }
+    cpu.clk.clk_adstall = FALSE;
+    cpu.clk.clk_adppm = (long)(((virt - real) * 1000000.0) / real);
+    cpu.clk.clk_aderr += virt - real;
+    if (cpu.clk.clk_aderr > CLK_USECS_PER_SEC
+      || cpu.clk.clk_aderr < -CLK_USECS_PER_SEC)
+	cpu.clk.clk_aderr = 0.0;	/* Too far gone, start over */
+
+    /* Rate seen, then make the next window that much shorter or
+    ** longer in virtual time.
+    */
+    fac = virt / real;
+    if (fac < 1.0/16 || fac > 16.0)	/* Close in on wild guesses */
+	fac = (fac < 1.0/16) ? 1.0/16 : 16.0;
+    ipms = cpu.clk.clk_ipms * fac;
+    fac = KLH10_CLK_ADWIN / (KLH10_CLK_ADWIN - cpu.clk.clk_aderr/4);
+    if (fac < 0.8 || fac > 1.25)
+	fac = (fac < 0.8) ? 0.8 : 1.25;
+    ipms = cpu.clk.clk_ipms + ((ipms * fac) - cpu.clk.clk_ipms) / 2;
+    if (ipms < 10.0)
+	ipms = 10.0;
+    else if (ipms > 1000000.0)		/* Keeps clk_icntval in range */
+	ipms = 1000000.0;
+    if ((int32)ipms == cpu.clk.clk_ipms)
+	return;
+
+    cpu.clk.clk_ipms = (int32)ipms;
+    cpu.clk.clk_icntval = clk_usec2clk(cpu.clk.clk_itickusec);
+    cpu.clk.clk_counter = cpu.clk.clk_ocnt = cpu.clk.clk_icntval;
+    cpu.clk.clk_adnset++;
+}
+
+#endif /* KLH10_CLK_ADAPT */
+
 #endif /* KLH10_CLKTRG_COUNT */
 
@@ -60,6 +60,18 @@
 #define KLH10_CLKXCT_SYNCH 1			/* Synchronized callouts */
 #define KLH10_CLKXCT_IMMED !KLH10_CLKXCT_SYNCH	/* Can do immediate callouts */
 
+#ifndef KLH10_CLK_MAXTIMERS		/* Max # of timer entries */
+#  define KLH10_CLK_MAXTIMERS 32
+#endif
+
+#ifndef KLH10_CLK_WHSIZE		/* # timing wheel slots (power of 2) */
+#  define KLH10_CLK_WHSIZE 256
+#endif
+
+#ifndef KLH10_CLK_ADWIN			/* Usec of virtual time per ipms */
+#  define KLH10_CLK_ADWIN 250000	/* measuring window (KLH10_CLK_ADAPT) */
+#endif
+
 
 /* Typedef for scalar variable holding # ticks */
 typedef int32 clkval_t;
@@ -82,6 +94,7 @@ struct clkent {
 	int (*cke_rtn)(void *);	/* Callout function, NULL if entry free */
 	void *cke_arg;		/* Argument to function */
 	clkval_t cke_ticks;	/* # relative ticks til timed out */
+				/* (wheel: ITICK # when due) */
 
 	clkval_t cke_oticks;	/* Original # ticks */
 	int32 cke_usec;		/* Original interval in usec */
@@ -103,6 +116,11 @@ struct clkregs {
 	struct clkent *clk_itickl;	/* ITICK list     (doubly-linked) */
 	struct clkent *clk_quiet;	/* Quiescent list (doubly-linked) */
 	struct clkent *clk_free;	/* Freelist (one-way) */
+#if KLH10_CLK_WHEEL
+	struct clkent *clk_fireq;	/* MTICK entries now due (doubly-linked) */
+	uint32 clk_inow;		/* # ITICKs so far, turns the wheel */
+	struct clkent *clk_wheel[KLH10_CLK_WHSIZE];	/* MTICK timing wheel */
+#endif
 
 	clkval_t clk_counter;		/* Countdown: cticks of first entry */
 	clkval_t clk_ocnt;		/* Original countdown value */
@@ -110,6 +128,16 @@ struct clkregs {
 	clkval_t clk_icntval;		/* cticks per itick interval */
 	int32 clk_ipms;			/* # instrs per msec (CLKTRG only) */
 	int32 clk_ipmsrq;		/* Requested val of ipms (sigh) */
+#if KLH10_CLK_ADAPT
+	int clk_adapt;			/* TRUE to retune ipms to real time */
+	int32 clk_adn;			/* # iticks so far in window */
+	int clk_adstall;		/* TRUE if last window was thrown away */
+	double clk_adbase;		/* Real usec at window start, 0 if none */
+	double clk_aderr;		/* Virtual minus real usec, so far */
+	long clk_adppm;			/* Rate error of last window, in ppm */
+	unsigned long clk_adnset;	/* # times ipms was retuned */
+	unsigned long clk_adnskip;	/* # windows thrown away */
+#endif
 	int32 clk_tickusec;		/* # usec per ctick */
 	int32 clk_htickusec;		/* (tickusec/2) for rounding */
 
@@ -120,9 +148,14 @@ struct clkregs {
 	int32 clk_itusfix;		/* Same in usec */
 	int32 clk_ithzosreq;		/* Last OS-requested value in HZ */
 	int32 clk_ithzcmreq;		/* Cmd-requested val of ITHZ (sigh) */
+#if KLH10_MULTI
+	struct clkent clk_tab[KLH10_CLK_MAXTIMERS];	/* Timer entries */
+#endif
 };
 /* Note: The "prev" of first entry on doubly-linked list points back
 ** to appropriate member above.  Last entry's "next" is NULL.
+** With KLH10_CLK_WHEEL, each wheel slot is such a list, and clk_itickq
+** is unused.
 */
 
 
@@ -237,4 +270,10 @@ extern void clk_tmractiv(struct clkent *ce);
 */
 extern void clk_tmrkill(struct clkent *ce);
 
+#if KLH10_CKPT
+struct ckpt_s;
+extern int clk_ckpsave(struct ckpt_s *);	/* Save clock state */
+extern int clk_ckprest(struct ckpt_s *, int);	/* Check or restore it */
+#endif
+
 #endif /* ifndef KN10CLK_INCLUDED */
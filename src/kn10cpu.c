@@ -115,6 +115,9 @@ apr_init(void)
     pi_init();			/* Init the PI system */
     pag_init();			/* Init the pager */
     tim_init();			/* Init the timers/clocks */
+#if KLH10_IDLE
+    cpu.mr_idle = TRUE;		/* Detect guest idle loops by default */
+#endif
 }
 
 
@@ -356,6 +359,48 @@ void apr_halt(enum haltcode haltval)	/* A HALT_xxx value */
 {
     _longjmp(aprhaltbuf, haltval);
 }
+
+#if KLH10_OPPROF
+
+/* OP_PFXCT, OPX_PFXCT - Profiling versions of op_xct and opx_xct.
+**	Count the instruction, and if mr_opprof > 1 also the host cycles
+**	it took.  Nested execution (XCT, EXTEND) is included in the outer
+**	instruction's cycles as well as being counted separately.  An
+**	instruction that aborts by page fault or interrupt is counted,
+**	but its cycles are not.
+*/
+pcinc_t
+op_pfxct(register int op, int ac, vaddr_t e)
+{
+    register pcinc_t i;
+    unsigned long c0, c1;
+
+    ++cpu.pf_opcnt[op];
+    if (cpu.mr_opprof < 2)
+	return (*cpu.opdisp[op])(op, ac, e);
+    OS_CYCLES(c0);
+    i = (*cpu.opdisp[op])(op, ac, e);
+    OS_CYCLES(c1);
+    cpu.pf_opcyc[op] += c1 - c0;
+    return i;
+}
+
+pcinc_t
+opx_pfxct(register int xop, int ac, vaddr_t e0, vaddr_t e1)
+{
+    register pcinc_t i;
+    unsigned long c0, c1;
+
+    ++cpu.pf_xcnt[xop];
+    if (cpu.mr_opprof < 2)
+	return (*opcxrtn[xop])(xop, ac, e0, e1);
+    OS_CYCLES(c0);
+    i = (*opcxrtn[xop])(xop, ac, e0, e1);
+    OS_CYCLES(c1);
+    cpu.pf_xcyc[xop] += c1 - c0;
+    return i;
+}
+#endif /* KLH10_OPPROF */
 
 #if KLH10_EXTADR
 
@@ -407,19 +452,56 @@ apr_creep(void)
     }
 }
 
+#if KLH10_PCCACHE
+/* HOP_PCFETCH - Extended version of apr_fly's cached PC fetch.
+**	The bounds are kept as full 30-bit PC values, so any jump into
+**	another section always misses.  Words 0-17 of every section are ACs
+**	when fetched from a local PC, so those are never cached; nor is
+**	anything fetched while a PXCT is in progress, since the map
+**	pointers may then be faked.  Requires locals vp, pc, cachelo and
+**	cachehi, and relies on PCCACHE_RESET for all map changes.
+*/
+# define hop_pcfetch(iw) \
+	if ((pc = PC_30) <= cachehi && cachelo <= pc			\
+	  && cpu.mr_cachevp) {						\
+	    vp = cpu.mr_cachevp + (pc & PAG_MASK);	/* Win, fast fetch */\
+	} else {							\
+	    vp = vm_PCmap(VMF_FETCH, cpu.acblk.xea, cpu.vmap.xea);	\
+	    if (PC_ISACREF || cpu.mr_inpxct) {				\
+		cachelo = 1;		/* Running in ACs, don't cache */\
+		cachehi = 0;						\
+	    } else {							\
+		cpu.mr_cachevp = vp - (pc & PAG_MASK);			\
+		cachelo = pc & ~(paddr_t)PAG_MASK;			\
+		cachehi = cachelo | PAG_MASK;				\
+		if (!(cachelo & H10MASK))	/* Page 0 of section */	\
+		    cachelo |= AC_17+1;		/* so skip ACs */	\
+	    }								\
+	}								\
+	iw = vm_pget(vp)
+#else
+# define hop_pcfetch(iw) iw = vm_PCfetch()
+#endif
+
 /* APR_HOP - EXTENDED version of APR_FLY.
 **	Fast loop, hobbled by XA operations.
-**	No PC Cache stuff to begin with -- keep simple for now.
 */
 static void
 apr_hop(void)
 {
     register w10_t instr;
+#if KLH10_PCCACHE
+    register vmptr_t vp;
+    register paddr_t pc;
+    register paddr_t cachelo = 1;	/* Lower & upper bounds of PC */
+    register paddr_t cachehi = 0;
+#endif
 
+    PCCACHE_RESET();		/* Robustness: invalidate cached PC info */
     for (;;) {
 	if (INSBRKTEST())	/* Check and handle all possible "asynchs" */
 	    apr_check();
-	instr = vm_PCfetch();	/* Fetch next instr */
+	hop_pcfetch(instr);	/* Fetch next instr */
 
 	PC_ADDXCT(op_xct(iw_op(instr), iw_ac(instr),
 				xea_calc(instr, PC_SECT)));
@@ -434,7 +516,7 @@ apr_hop(void)
     }
 }
 #endif /* EXTADR */
-
+
 
 /* APR_CHECK - Check all possible "interrupt" conditions to see what
 **	needs to be done, and do it.
@@ -482,8 +564,12 @@ apr_check(void)
 	/* Check for PI requests */
 	{
 	    register int pilev;
-	    if ((pilev = pi_check()))	/* If PI interrupt requested, */
+	    if ((pilev = pi_check())) {	/* If PI interrupt requested, */
+#if KLH10_IDLE
+		cpu.mr_idlecnt = 0;	/* Guest may have work now */
+#endif
 		pi_xct(pilev);		/* handle it! */
+	    }
 	}
 
 	/* Make sure no further asynchs have come in.  This macro will
@@ -532,6 +618,112 @@ apr_check(void)
 	break;
     }
 }
+
+#if KLH10_IDLE
+
+/* Idle loop detection.
+**	A guest with nothing to do sits in its null job, typically a
+**	short loop that re-tests some memory word or AC until an interrupt
+**	routine changes it.  Spinning there burns host CPU for nothing.
+**
+**	PC_LOOPJUMP calls IDL_JUMP for each short backward JRST or JUMPx.
+**	The loop from the jump target up to the jump is checked once, by
+**	IDL_LOOPOK, and the result kept until a different loop is seen or
+**	the address space changes (PCCACHE_RESET).  After IDLE_NLOOPS
+**	trips around an idle loop with no PI taken, CLK_IDLE is called to
+**	block the process until the next clock tick or device event;
+**	it accounts for the time slept, so guest time is unaffected.
+**
+**	A loop is considered idle if every instruction in it is one that,
+**	given unchanged memory, does the same thing each time around:
+**	no memory stores, no AC read-modify-writes, no IO or UUOs, and no
+**	jumps other than JRST and JUMPx.  ACs may be loaded (MOVE, SKIPx
+**	with non-zero AC, etc) but then may not be used for indexing.
+**	Loops at a known idle PC (set with the FE "idle pc" command) are
+**	accepted without checking.
+*/
+static int
+idl_loopok(register vaddr_t e)
+{
+    register vmptr_t vp;
+    register w10_t w;
+    register struct opdef *opdf;
+    register int op, ac, i, n;
+    register paddr_t pc = va_30(e);
+    unsigned int loaded = 0;
+
+    if (cpu.mr_usrmode)
+	pc |= IDLE_UPC;
+    for (i = 0; i < cpu.mr_nidlpcs; ++i)
+	if (cpu.mr_idlpcs[i] == pc)
+	    return TRUE;
+
+    /* Only check loops entirely within one page, and not in the ACs,
+    ** so the words can be had from the page the jump was fetched from.
+    */
+    if (va_insect(e) <= AC_17
+      || (va_30(e) & ~(paddr_t)PAG_MASK) != (PC_30 & ~(paddr_t)PAG_MASK))
+	return FALSE;
+#if KLH10_EXTADR
+    vp = vm_PCmap(VMF_FETCH, cpu.acblk.xea, cpu.vmap.xea);
+#else
+    vp = vm_xeamap(PC_VADDR, VMF_FETCH);
+#endif
+    n = (int)(PC_30 - va_30(e)) + 1;
+    vp -= n - 1;
+
+    for (i = 0; i < n; ++i) {
+	w = vm_pget(vp + i);
+	op = iw_op(w);
+	ac = iw_ac(w);
+	if (op == I_JRST) {
+	    if (ac)
+		return FALSE;
+	    continue;
+	}
+	if (op < I_MOVE || op >= 0700		/* No UUOs or IO */
+	  || !(opdf = opcptr[op]) || !opdf->opflg
+	  || (opdf->opflg & (IF_SPEC|IF_IO|IF_MW))
+	  || ((opdf->opflg & IF_JMP) && (op < I_JUMP || I_JUMPG < op)))
+	    return FALSE;
+	if (opdf->opflg & IF_AW) {
+	    if (opdf->opflg & IF_AR)		/* Modifies AC, not idle */
+		return FALSE;
+	    switch (opdf->opflg & IF_AFMASK) {
+	    case IF_A0:	if (ac) loaded |= 1 << ac;	break;
+	    case IF_A1:	loaded |= 1 << ac;		break;
+	    case IF_A2:	loaded |= 03 << ac;		break;
+	    default:	return FALSE;
+	    }
+	}
+    }
+    for (i = 0; i < n; ++i) {		/* Loaded ACs can't index */
+	w = vm_pget(vp + i);
+	if (iw_x(w) && (loaded & (1 << iw_x(w))))
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+void
+idl_jump(vaddr_t e)
+{
+    if (PC_30 != cpu.mr_idlepc || cpu.mr_usrmode != cpu.mr_idleusr) {
+	cpu.mr_idlepc = PC_30;		/* New loop, check it out */
+	cpu.mr_idleusr = cpu.mr_usrmode;
+	cpu.mr_idlecnt = 0;
+	cpu.mr_idleok = idl_loopok(e);
+    }
+    if (cpu.mr_idleok && ++cpu.mr_idlecnt >= IDLE_NLOOPS) {
+	cpu.mr_idlecnt = 0;
+	if (!INSBRKTEST()) {		/* Unless something already pending */
+	    ++cpu.mr_idlens;
+	    clk_idle();
+	}
+    }
+}
+
+#endif /* KLH10_IDLE */
 
 /* Effective Address Calculation.
 **	The routines here are full-blown functions called when the
@@ -564,6 +756,23 @@ ea_wcalc(register w10_t iw,
     }
 }
 
+/* EA_CHAINNOTE - Record length of an indirect chain just followed.
+**	Bucket 0 counts calls that needed no indirection at all (X in a
+**	non-zero section); the last bucket collects all long chains.
+**	The longest chain seen, and the PC that used it, are remembered
+**	to help find pathological guest code.
+*/
+#if KLH10_EACHAIN
+# define EA_CHAINNOTE(n) { \
+	++cpu.mr_eachain[((n) < EACHAIN_N) ? (n) : EACHAIN_N-1];	\
+	if ((n) > cpu.mr_eachmax) {					\
+	    cpu.mr_eachmax = (n);					\
+	    cpu.mr_eachmaxpc = PC_30;					\
+	} }
+#else
+# define EA_CHAINNOTE(n)
+#endif
+
 #if 1
 
 vaddr_t
@@ -573,6 +782,9 @@ ea_fncalc(register w10_t iw,
 {
     register vaddr_t ea;
     register h10_t tmp;
+#if KLH10_EACHAIN
+    register int nind = 0;
+#endif
 
     tmp = LHGET(iw);
     for (;;) {
@@ -585,10 +797,15 @@ ea_fncalc(register w10_t iw,
 	} else					/* Not indexing, just use Y */
 	    va_lmake(ea, 0, RHGET(iw));
 
-	if (!(tmp & IW_I))			/* Indirection? */
+	if (!(tmp & IW_I)) {			/* Indirection? */
+	    EA_CHAINNOTE(nind);
 	    return ea;				/* Nope, return now! */
+	}
 
 	/* Indirection, do it */
+#if KLH10_EACHAIN
+	++nind;
+#endif
 	iw = vm_pget(vm_xmap(ea, VMF_READ, acp, map));
 	if ((tmp = LHGET(iw)) & IW_I) {		/* If new word also indirect */
 	    CLOCKPOLL();
@@ -611,6 +828,9 @@ xea_xcalc(register w10_t iw,	/* IFIW to evaluate */
 	register pment_t *map)	/* Page table mapping */
 {
     register vaddr_t e;		/* Address to return */
+#if KLH10_EACHAIN
+    register int nind = 0;
+#endif
 
     for (;;) {
 	if (op10m_tlnn(iw, IW_X)) {		/* Indexing? */
@@ -633,8 +853,10 @@ xea_xcalc(register w10_t iw,	/* IFIW to evaluate */
 	} else {
 	    va_lmake(e, sect, RHGET(iw));	/* No X, just use Y */
 	}
-	if (!op10m_tlnn(iw, IW_I))		/* Indirection? */
+	if (!op10m_tlnn(iw, IW_I)) {		/* Indirection? */
+	    EA_CHAINNOTE(nind);
 	    return e;				/* Nope, done! */
+	}
 
 	/* Indirection, enter subloop.
 	** Allow one indirect fetch before checking for PI.
@@ -649,6 +871,9 @@ xea_xcalc(register w10_t iw,	/* IFIW to evaluate */
 	** is really necessary or not.  Decision gets hairy though.
 	*/
 	for (;;) {
+#if KLH10_EACHAIN
+	    ++nind;
+#endif
 	    iw = vm_pget(vm_xmap(e,		/* Get c(E), may fault */
 				VMF_READ,
 				acp, map));
@@ -678,8 +903,10 @@ xea_xcalc(register w10_t iw,	/* IFIW to evaluate */
 	    } else {
 		va_gmake30(e, va_30frword(iw));	/* No X, just Y */
 	    }
-	    if (!op10m_tlnn(iw, IW_EI))	/* Bits 0,1 == 00 or 01? */
+	    if (!op10m_tlnn(iw, IW_EI)) {	/* Bits 0,1 == 00 or 01? */
+		EA_CHAINNOTE(nind);
 		return e;		/* = 00, Done!  Global E */
+	    }
 					/* = 01, get another indirect word */
 
 	    /* Looping with another EFIW. */
@@ -695,6 +922,32 @@ xea_xcalc(register w10_t iw,	/* IFIW to evaluate */
     }
 }
 
+/* XEA_IXCALC - EA calc for an IFIW with X but no I, in a non-zero section.
+**	Just the first step of xea_xcalc, without its loop or any of the
+**	indirection tests.
+*/
+vaddr_t
+xea_ixcalc(register w10_t iw,	/* IFIW to evaluate */
+	register unsigned sect,	/* Current section, non-zero */
+	register acptr_t acp)	/* AC block mapping */
+{
+    register w10_t xw;
+    register vaddr_t e;
+
+    xw = ac_xget(iw_x(iw), acp);	/* Get c(X) */
+    if (op10m_skipge(xw) && op10m_tlnn(xw, VAF_SMSK)) {
+	/* Global index, Y is a signed displacement */
+	va_gmake30(e, VAF_30MSK & (va_30frword(xw)
+			+ (op10m_trnn(iw, H10SIGN)
+				? (RHGET(iw) | (VAF_SMSK<<H10BITS))
+				: RHGET(iw))));
+    } else {
+	va_lmake(e, sect, (RHGET(xw)+RHGET(iw)) & VAF_NMSK);
+    }
+    EA_CHAINNOTE(0);
+    return e;
+}
+
 #endif /* KLH10_EXTADR */
 
 /* Device APR - Instructions & support */
@@ -2712,7 +2965,9 @@ pi_xct(register int lev)
     } else if (lev & cpu.pi.pilev_dreq) {
 	/* External device of some kind.  Scan to find which one.
 	*/
+#if !KLH10_MULTI
 	extern struct device *devrh20[8], *devdte20[4];
+#endif
 	register int i;
 	register struct device *dv = NULL;
 
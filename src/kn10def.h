@@ -227,6 +227,25 @@ typedef int     pcinc_t;	/* Type of all instruction routines */
 # define PC_JUMP(e) PC_SET(e)
 #endif
 
+/* PC_LOOPJUMP - Same as PC_JUMP, used by the jumps that can close a
+**	loop (JRST, JUMPx).  If idle detection is on, a short backward
+**	jump is checked to see whether it closes a guest idle loop.
+*/
+#if KLH10_IDLE
+# define IDLE_LOOPMAX 8		/* Max # words in a detectable idle loop */
+# define IDLE_NLOOPS 64		/* # times around it before idling */
+# define IDLE_NPCS 8		/* Max # of known idle loop PCs */
+# define IDLE_UPC (((paddr_t)1)<<30)	/* Flags user-mode known PC */
+# define IDLE_NOPC (~(paddr_t)0)
+# define PC_LOOPJUMP(e) \
+	((void)(cpu.mr_idle && va_30(e) <= PC_30		\
+		&& PC_30 - va_30(e) < IDLE_LOOPMAX		\
+		&& (idl_jump(e), 1)),				\
+	 PC_JUMP(e))
+#else
+# define PC_LOOPJUMP(e) PC_JUMP(e)
+#endif
+
 /* Special macro to increment PC based on instruction execution.
 ** This must NOT be replaced by an expression such as
 **		(PC = (PC+(x)) & H10MASK)
@@ -260,10 +279,20 @@ typedef int     pcinc_t;	/* Type of all instruction routines */
 **	change the address space mapping, either the page map or
 **	AC block selection.
 */
+#if KLH10_IDLE
+# define IDLE_RESET() (cpu.mr_idlepc = IDLE_NOPC)
+#else
+# define IDLE_RESET() ((void)0)
+#endif
+#if KLH10_BPCACHE
+# define BPCACHE_RESET() (++cpu.mr_bpgen)
+#else
+# define BPCACHE_RESET() ((void)0)
+#endif
 #if KLH10_PCCACHE
-# define PCCACHE_RESET() (cpu.mr_cachevp = NULL)
+# define PCCACHE_RESET() (cpu.mr_cachevp = NULL, IDLE_RESET(), BPCACHE_RESET())
 #else
-# define PCCACHE_RESET()
+# define PCCACHE_RESET() (IDLE_RESET(), BPCACHE_RESET())
 #endif
 
 /* Processor PC Flag (PCF) macros */
@@ -315,6 +344,37 @@ typedef int     pcinc_t;	/* Type of all instruction routines */
 #include "opdefs.h"	/* PDP-10 instruction opcodes and declarations */
 			/* Includes IW_ facilities */
 
+/* Byte pointer cache
+**	Remembers, for a byte pointer location recently used by ILDB or
+**	IDPB, how the pointer decodes and the host pointers to both the BP
+**	word and the word it points to.  Entries are indexed by the low bits
+**	of the BP address and tagged with that address and with the BP word
+**	itself, so any store into the pointer by whatever means simply
+**	causes a miss.  The host pointers are only trusted while the map
+**	generation (mr_bpgen, bumped by PCCACHE_RESET) is unchanged.
+**	Only simple pointers are cached: one-word local BPs without I or X,
+**	and one-word global BPs, never under PXCT or for AC references.
+*/
+#if KLH10_BPCACHE
+# ifndef BPCACHE_BITS
+#  define BPCACHE_BITS 3	/* 8 entries */
+# endif
+# define BPCACHE_N (1<<BPCACHE_BITS)
+# define BPCACHE_MASK (BPCACHE_N-1)
+
+struct bpcent {
+	unsigned long bc_gen;	/* Map generation entry is good for */
+	vaddr_t bc_e;		/* Address of BP word (tag) */
+	w10_t bc_w;		/* BP word as last stored (tag) */
+	vmptr_t bc_bpvp;	/* Host pointer to BP word, write access */
+	vmptr_t bc_vp;		/* Host pointer to word BP points to */
+	int bc_acc;		/* Access verified for bc_vp (VMF_xxx) */
+	int bc_left;		/* # words after bc_vp left in its page */
+	int bc_ps;		/* OWGBP P&S, or 0 if local BP */
+	int bc_p, bc_s;		/* Local BP: current P and S */
+};
+#endif /* KLH10_BPCACHE */
+
 
 /* Processor/microcode configuration */
 
@@ -864,6 +924,9 @@ struct feregs {
 **	On other architectures it doesn't matter but doesn't hurt either.
 */
 
+struct device;		/* Defined in kn10dev.h */
+struct dvdef_s;		/* Private to kn10dev.c */
+
 struct machstate {
 	/* Current ACs; at start of struct to make indexing faster.
 	** This block is swapped with cpu.acblks[n]
@@ -951,20 +1014,87 @@ struct machstate {
 	int mm_shared;		/* TRUE if using shared phys memory */
 	int mm_locked;		/* TRUE if want memory locked */
 	osmm_t mm_physegid;	/* Phys memory shared segment ID (can be 0) */
+#if KLH10_CKPT
+	int mm_mapped;		/* TRUE if phys memory mapped from ckpt file */
+#endif
 	struct feregs fe;	/* FE stuff */
 #if KLH10_CPU_KS
 	int io_ctydelay;	/* Ugh.  To emulate I/O device delays. */
 #endif
 
+#if KLH10_MULTI
+	/* Device bindings, maintained by kn10dev.c; for one machine
+	** these are plain globals there instead.
+	*/
+	struct device *dv_tab[128];	/* Device for each dev-IO device # */
+#if KLH10_CPU_KL
+	struct device *dv_rh20[8+1];	/* RH20s in order of binding, */
+					/*	plus a terminating null */
+	struct device *dv_dte20[4+1];	/* DTE20s, same */
+	struct device *dv_dia20;	/* One DIA20 for random devs */
+#endif
+	struct dvdef_s *dv_deftab;	/* Device definitions */
+	int dv_defcnt;			/* # of them in use */
+#endif
+
 	/* Bulk storage, at end so it's less annoying when debugging. */
 
 	w10_t acblks[ACBLKS_N][16];	/* Actual AC blocks!  16 wds each */
 	opfp_t opdisp[I_N];		/* I_xxx Routine dispatch table */
+#if KLH10_OPPROF
+	int mr_opprof;			/* Profiling: 0 off, 1 on, 2 +cycles */
+	unsigned long pf_opcnt[I_N];	/* Execution counts by opcode */
+	unsigned long pf_opcyc[I_N];	/* Host cycles by opcode */
+	unsigned long pf_xcnt[IX_N];	/* Same for EXTEND sub-ops */
+	unsigned long pf_xcyc[IX_N];
+#endif
+#if KLH10_EACHAIN
+# define EACHAIN_N 8			/* Last bucket is 7 or more */
+	unsigned long mr_eachain[EACHAIN_N]; /* Indirect chain length counts */
+	int mr_eachmax;			/* Longest chain seen */
+	paddr_t mr_eachmaxpc;		/*   and PC_30 of instr using it */
+#endif
+#if KLH10_IDLE
+	int mr_idle;			/* TRUE to detect guest idle loops */
+	paddr_t mr_idlepc;		/* PC_30 of loop jump last checked */
+	int mr_idleusr;			/*   its mode */
+	int mr_idleok;			/*   TRUE if it is an idle loop */
+	int mr_idlecnt;			/*   # times around it so far */
+	unsigned long mr_idlens;	/* # times host was idled */
+	int mr_nidlpcs;			/* # known idle loop PCs */
+	paddr_t mr_idlpcs[IDLE_NPCS];	/* PC_30s, plus IDLE_UPC if user */
+#endif
+#if KLH10_BPCACHE
+	unsigned long mr_bpgen;		/* Map generation, see PCCACHE_RESET */
+	unsigned long mr_bphits;	/* # ILDB/IDPB done from cache */
+	unsigned long mr_bpmiss;	/* # that took the slow path */
+	struct bpcent bpcache[BPCACHE_N]; /* Byte pointer cache */
+#endif
 	pment_t pr_umap[PAG_MAXVIRTPGS]; /* Internal user mode map table */
 	pment_t pr_emap[PAG_MAXVIRTPGS]; /*   "      exec  "    "    "   */
+#if KLH10_PAG_TLB
+	struct pagtlb_s *pr_tlb;	/* Retained user maps (see kn10pag.c) */
+#endif
 };
 
+#if KLH10_MULTI
+/* Each thread reaches the machine it is running through kn10_cpu, which
+** starts out pointing at the first machine; code just says "cpu" as
+** always.  Static initializers can't use "cpu" then, and must name a
+** specific machine.
+*/
+EXTDEF struct machstate kn10_mach0;		/* First machine */
+extern KLH10_TLS struct machstate *kn10_cpu;	/* This thread's machine */
+# define cpu (*kn10_cpu)
+
+/* Device binding tables, globals in kn10dev.c for a single machine */
+# define devtab   cpu.dv_tab
+# define devrh20  cpu.dv_rh20
+# define devdte20 cpu.dv_dte20
+# define devdia20 cpu.dv_dia20
+#else
 EXTDEF struct machstate cpu;
+#endif
 
 
 /* Processor function declarations - from kn10cpu.c */
@@ -974,6 +1104,9 @@ extern void apr_pcfcheck(void);		/* Check PC flags for side effects */
 extern void apr_int(void);		/* Invoke interrupt system */
 extern void apr_halt(enum haltcode);	/* Halt processor */
 extern void pi_dismiss(void);		/* Dismiss current interrupt */
+#if KLH10_IDLE
+extern void idl_jump(vaddr_t);		/* Check possible idle loop jump */
+#endif
 #if KLH10_CPU_KL
 extern void mtr_update(void);		/* Update accounts */
 #endif
@@ -39,6 +39,9 @@
 #include "kn10ops.h"
 #include "prmstr.h"
 #include "kn10cpu.h"
+#if KLH10_CKPT
+# include "kn10ckp.h"
+#endif
 
 #if KLH10_CPU_KS && KLH10_DEV_TM03
 # include "dvtm03.h"	/* For setting up FECOM_BOOTP with magtape params */
@@ -157,6 +160,11 @@ iodv_setnull(register struct device *d)
     d->dv_powon  = dvnull_v;	/* "Power on" */
     d->dv_reset  = dvnull_v;	/* System reset */
     d->dv_powoff = dvnull_v;	/* "Power off" */
+
+#if KLH10_CKPT
+    d->dv_ckpt   = NULL;	/* Checkpoint not supported */
+    d->dv_ckrest = NULL;
+#endif
 }
 
 
@@ -227,8 +235,13 @@ struct dvdef_s {
     struct device *dev_dv;	/* Pointer to active device structure */
     struct dvdrv_s *dev_drv;	/* Pointer to selected driver code */
 };
+#if KLH10_MULTI
+# define dvdefcnt cpu.dv_defcnt		/* Each machine has its own */
+# define dvdeftab cpu.dv_deftab		/* Allocated by dev_init */
+#else
 int dvdefcnt = 0;
 struct dvdef_s dvdeftab[KLH10_DEVMAX+1];
+#endif
 
 #define DVDF_EXTERN 01		/* Device is dynamically loaded library */
 #define DVDF_STATIC 02		/* Device is statically linked module */
@@ -344,8 +357,12 @@ static struct dvdrv_s dvdrvtab[KLH10_DEVMAX+1] = {
 struct device dvnull;		/* Null device - default vector */
 
 /* Actual binding of dev-IO devices!
+**	With KLH10_MULTI, this and the KL sub-binding tables below are in
+**	each machine's state instead; see kn10def.h.
 */
+#if !KLH10_MULTI
 struct device *devtab[128];
+#endif
 
 /* Sub-binding tables.  On the KL, all devices ultimately belong to one
 ** of the following three groups: RH20, DTE, or DIA.
@@ -353,13 +370,14 @@ struct device *devtab[128];
 #if KLH10_CPU_KL
 # define NRH20 8
 # define DEVRH20(n) (0540+((n)<<2))	/* Cvt 0-7 into RH20 devs 540-574 */
+# define NDTE20 4
+# define DEVDTE20(n) (0200+((n)<<2))
+# if !KLH10_MULTI
 struct device *devrh20[8+1];	/* Up to 8 RH20 channels, in order of binding
 				** (NOT indexed by device number!)
 				** Plus one terminating null pointer.
 				** Code assumes all entries null initially!
 				*/
-# define NDTE20 4
-# define DEVDTE20(n) (0200+((n)<<2))
 struct device *devdte20[4+1];	/* 4 DTE20s, devs 200-214 */
 				/* Same format as devrh20 table */
 
@@ -367,6 +385,7 @@ struct device *devdte20[4+1];	/* 4 DTE20s, devs 200-214 */
 ** hookup to a traditional IO bus to support all other random device #s.
 */
 struct device *devdia20;	/* One DIA20 for random devs */
+# endif /* !KLH10_MULTI */
 #endif /* KL */
 
 
@@ -504,8 +523,14 @@ dviob_add(FILE *of,			/* Error output */
 void
 dev_init(void)
 {
+#if KLH10_MULTI
+    if (!dvdeftab
+      && !(dvdeftab = (struct dvdef_s *)
+		malloc((KLH10_DEVMAX+1) * sizeof(struct dvdef_s))))
+	panic("dev_init: Cannot allocate device table");
+#endif
     dvdefcnt = 0;
-    memset((char *)dvdeftab, 0, sizeof(dvdeftab));
+    memset((char *)dvdeftab, 0, (KLH10_DEVMAX+1) * sizeof(struct dvdef_s));
 
 #if KLH10_EVHS_INT
     dev_evinit();
@@ -1477,6 +1502,12 @@ Some notes on specific events:
 	Like DVEV_NSIG but handler only invoked if flag is non-zero
 	(flag is cleared just prior to invoking handler).
 
+    DVEV_DPBELL - Device subProcess doorbell, an eventfd specified by
+	eva_int, with flag pointer in eva_ip as for DVEV_DPSIG.
+	Only with KLH10_EVHS_BELL.  A thread rings the bell on the 10's
+	behalf (see os_bellwatch), so no signal is involved.  The eventfd
+	may also be written by a thread of our own (see KLH10_RP_THREAD).
+
     DVEV_CLOCK - Periodic clock callout.  Time in eva_int is # msec.
 	The time will be converted to some # of internal clock ticks
 	by rounding to the nearest tick (but no less than 1).
@@ -1506,6 +1537,13 @@ struct dvevsig_s evsigtab[SIGMAX];		/* Registered signals */
 struct dvevreg_s *evregfree;
 struct dvevreg_s evregtab[KLH10_EVHS_MAX];	/* Registered handlers */
 
+#if KLH10_EVHS_BELL
+# if !KLH10_DEV_DP
+#  error "KLH10_EVHS_BELL needs KLH10_DEV_DP"
+# endif
+struct dvevbel_s evbeltab[KLH10_EVHS_MAX];	/* Registered doorbells */
+#endif
+
 static void dev_evunreg(struct device *);
 
 /* DEV_EVINIT - Initialize event stuff
@@ -1519,6 +1557,15 @@ dev_evinit(void)
     evsiglist = NULL;
     memset((char *)evsigtab, 0, sizeof(evsigtab));
     memset((char *)evregtab, 0, sizeof(evregtab));
+#if KLH10_EVHS_BELL
+  {
+    register struct dvevbel_s *eb;
+
+    memset((char *)evbeltab, 0, sizeof(evbeltab));
+    for (eb = evbeltab; eb < &evbeltab[KLH10_EVHS_MAX]; ++eb)
+	eb->dveb_fd = -1;
+  }
+#endif
 
     /* Set up handler entry freelist */
     evregfree = evregtab;
@@ -1537,7 +1584,29 @@ dev_sighan(int sig)
     }
 }
 
+#if KLH10_EVHS_BELL
+/* Doorbell callout, invoked from the doorbell thread.  Does what
+** dev_sighan does for a signal.
+*/
+static void
+dev_belhan(void *arg)
+{
+    register struct dvevbel_s *eb = (struct dvevbel_s *)arg;
+
+# if KLH10_MULTI
+    kn10_cpu = eb->dveb_cpu;
+# endif
+    INTF_SET(eb->dveb_intf);		/* Say this bell rung */
+    INTF_SET(cpu.intf_evsig);		/* Say some event seen */
+    INSBRKSET();			/* Interrupt instr loop */
+}
+#endif
+
 /* DEV_EVCHECK - Called at INSBRK to process any valid events
+**	With KLH10_MULTI the registries are shared, so only this machine's
+**	handlers are invoked.  A signal can be caught by any machine's
+**	thread; if it was meant for another one, that machine is poked
+**	to look for itself.
 */
 
 void
@@ -1545,14 +1614,30 @@ dev_evcheck(void)
 {
     register struct dvevsig_s *evs;
     register struct dvevreg_s *evr;
+#if KLH10_MULTI
+    int others;
+#endif
 
     /* Check all signals to see which ones went off */
     for (evs = evsiglist; evs; evs = evs->dves_next) {
 	if (INTF_TEST(evs->dves_intf)) {
+#if KLH10_MULTI
+	    others = FALSE;
+#endif
 	    INTF_ACTBEG(evs->dves_intf);
 
 	    /* Process all handlers registered for this signal */
 	    for (evr = evs->dves_reglist; evr; evr = evr->dver_next) {
+#if KLH10_MULTI
+		if (evr->dver_cpu != kn10_cpu) {
+		    if (*(evr->dver_ev.dvev_arg2.eva_ip)) {
+			INTF_SET(evr->dver_cpu->intf_evsig);
+			INTF_SET(evr->dver_cpu->mr_insbreak);
+			others = TRUE;
+		    }
+		    continue;		/* Leave flag for its owner */
+		}
+#endif
 		if (*(evr->dver_ev.dvev_arg2.eva_ip)) {
 		    /* If this handler's flag shows it really does want
 		    ** the call, invoke handler after clearing flag!
@@ -1563,8 +1648,35 @@ dev_evcheck(void)
 	    }
 
 	    INTF_ACTEND(evs->dves_intf);
+#if KLH10_MULTI
+	    if (others)			/* So the owner sees it too */
+		INTF_SET(evs->dves_intf);
+#endif
+	}
+    }
+
+#if KLH10_EVHS_BELL
+  {
+    register struct dvevbel_s *eb;
+
+    /* Then all doorbells, each of which has just one handler */
+    for (eb = evbeltab; eb < &evbeltab[KLH10_EVHS_MAX]; ++eb) {
+# if KLH10_MULTI
+	if (eb->dveb_cpu != kn10_cpu)
+	    continue;			/* Another machine's bell */
+# endif
+	if (eb->dveb_fd >= 0 && INTF_TEST(eb->dveb_intf)) {
+	    INTF_ACTBEG(eb->dveb_intf);
+	    evr = eb->dveb_reg;
+	    if (*(evr->dver_ev.dvev_arg2.eva_ip)) {
+		*(evr->dver_ev.dvev_arg2.eva_ip) = 0;
+		(*(evr->dver_hdlr))(evr->dver_d, &(evr->dver_ev));
+	    }
+	    INTF_ACTEND(eb->dveb_intf);
 	}
     }
+  }
+#endif
 }
 
 /* DEV_EVREG - Called by devices through device vector.
@@ -1608,6 +1720,9 @@ dev_evreg(register struct device *d,
     evr->dver_hdlr = rtn;		/* Remember callback rtn */
     evr->dver_d = d;			/* Remember device */
     evr->dver_ev = *evp;		/* Remember event & args */
+#if KLH10_MULTI
+    evr->dver_cpu = kn10_cpu;		/* Only its machine may call it */
+#endif
 
     switch (evp->dvev_type) {
 
@@ -1654,6 +1769,42 @@ dev_evreg(register struct device *d,
 	(void) os_sigsetmask(&oldmask, (ossigset_t *)NULL);
 	return TRUE;
 
+#if KLH10_EVHS_BELL
+    case DVEV_DPBELL:
+      {
+	register struct dvevbel_s *eb;
+
+	if (! evp->dvev_arg2.eva_ip) {
+	    fprintf(stderr, "[dev_evreg: Bad DPBELL pointer]\r\n");
+	    break;		/* Fail... */
+	}
+	*(evp->dvev_arg2.eva_ip) = 0;	/* Clear request flag */
+
+	for (eb = evbeltab; eb < &evbeltab[KLH10_EVHS_MAX]; ++eb)
+	    if (eb->dveb_fd < 0)
+		break;
+	if (eb >= &evbeltab[KLH10_EVHS_MAX]) {
+	    fprintf(stderr, "[dev_evreg: out of doorbell entries!]\r\n");
+	    break;		/* Fail... */
+	}
+	INTF_INIT(eb->dveb_intf);
+	eb->dveb_reg = evr;
+# if KLH10_MULTI
+	eb->dveb_cpu = kn10_cpu;
+# endif
+	eb->dveb_fd = evp->dvev_arg.eva_int;
+	if (!os_bellwatch(eb->dveb_fd, dev_belhan, (void *)eb,
+						(void *)&cpu)) {
+	    eb->dveb_fd = -1;
+	    break;		/* Fail... */
+	}
+	evr->dver_next = evr->dver_prev = NULL;	/* Not on any list */
+
+	(void) os_sigsetmask(&oldmask, (ossigset_t *)NULL);
+	return TRUE;
+      }
+#endif
+
     default:
 	/* Can't handle any other event type, break out to fail */
 	break;
@@ -1721,6 +1872,23 @@ dev_evunreg(register struct device *d)
 	    evs->dves_sig = 0;		/* No signal in effect */
 	}
     }
+
+#if KLH10_EVHS_BELL
+  {
+    register struct dvevbel_s *eb;
+
+    /* Doorbells must be unwatched before the device closes them */
+    for (eb = evbeltab; eb < &evbeltab[KLH10_EVHS_MAX]; ++eb) {
+	if (eb->dveb_fd >= 0 && eb->dveb_reg->dver_d == d) {
+	    os_bellunwatch(eb->dveb_fd);
+	    eb->dveb_fd = -1;
+	    evr = eb->dveb_reg;
+	    evr->dver_next = evregfree;	/* Flist is one-way, no prev */
+	    evregfree = evr;
+	}
+    }
+  }
+#endif
 }
 
 
@@ -1785,6 +1953,25 @@ dev_evshow(FILE *of,
 		fputc('\n', of);
 	    }
 	}
+#if KLH10_EVHS_BELL
+      {
+	register struct dvevbel_s *eb;
+
+	for (eb = evbeltab; eb < &evbeltab[KLH10_EVHS_MAX]; ++eb) {
+	    if (eb->dveb_fd < 0)
+		continue;
+	    evr = eb->dveb_reg;
+	    for (def = dvdeftab; def->dev_name; ++def)
+		if (def->dev_dv == evr->dver_d)
+		    break;
+	    fprintf(of, "  Doorbell: fd %d, intf=%ld, hdlr 0x%lx (dev \"%s\"), Flag=%o\n",
+			eb->dveb_fd, (long)eb->dveb_intf,
+			(long)(evr->dver_hdlr),
+			def->dev_name ? def->dev_name : "?",
+			*(evr->dver_ev.dvev_arg2.eva_ip));
+	}
+      }
+#endif
     }
     return TRUE;
 }
@@ -1928,6 +2115,26 @@ dev_dpwaiting(void)
 		++cnt;
 	}
     }
+#if KLH10_EVHS_BELL
+  {
+    register struct dvevbel_s *eb;
+
+    /* Likewise for doorbells */
+    for (eb = evbeltab; eb < &evbeltab[KLH10_EVHS_MAX]; ++eb) {
+	if (eb->dveb_fd < 0)
+	    continue;
+	evr = eb->dveb_reg;
+	if (*(evr->dver_ev.dvev_arg2.eva_ip)) {
+	    dev_evcheck();
+	    return -1;
+	}
+	/* A bell with no DP behind it (RPxx I/O thread) has only its flag */
+	if (evr->dver_d->dv_dpp
+	  && !dp_xstest(dp_dpxto(evr->dver_d->dv_dpp)))
+	    ++cnt;
+    }
+  }
+#endif
     return cnt;
 #elif KLH10_DEV_DP
     register struct dvdef_s *df;
@@ -1976,3 +2183,97 @@ dev_waiting(FILE *of, char *dstr)
 #endif /* KLH10_DEV_DP */
     return FALSE;
 }
+
+#if KLH10_CKPT
+
+/* Device checkpoint/restore.
+**	Each defined device gets its own checkpoint section, tagged "DEV"
+** and named with the device name, holding whatever its dv_ckpt routine
+** saves.  A restore requires the same set of devices to have been defined
+** (normally by running the same init file), since only device state, not
+** configuration, is saved.
+*/
+
+/* DEV_CKPREADY - Quiesce devices for a checkpoint.
+**	Waits up to SECS seconds for all DPs to finish what they were doing
+**	(which also processes any completion events they've signalled),
+**	then verifies every defined device can be checkpointed.
+*/
+int
+dev_ckpready(FILE *of, int secs)
+{
+    register struct dvdef_s *df;
+    osstm_t stm;
+
+    OS_STM_SET(stm, secs);
+    while (dev_waiting(of, (char *)NULL)) {
+	if (os_msleep(&stm) <= 0) {
+	    fprintf(of, "Devices still busy after %d sec, try again\n", secs);
+	    return FALSE;
+	}
+    }
+
+    for (df = dvdeftab; df < &dvdeftab[KLH10_DEVMAX]; ++df) {
+	if (df->dev_name && !df->dev_dv->dv_ckpt) {
+	    fprintf(of, "Device \"%s\" cannot be checkpointed\n",
+			df->dev_name);
+	    return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+/* DEV_CKPSAVE - Save all device state.
+*/
+int
+dev_ckpsave(FILE *of, struct ckpt_s *ck)
+{
+    register struct dvdef_s *df;
+
+    for (df = dvdeftab; df < &dvdeftab[KLH10_DEVMAX]; ++df) {
+	if (!df->dev_name)
+	    continue;
+	if (!ckp_secbeg(ck, "DEV", df->dev_name)
+	  || !(*df->dev_dv->dv_ckpt)(df->dev_dv, ck)
+	  || !ckp_secend(ck)) {
+	    fprintf(of, "Checkpoint of device \"%s\" failed\n",
+			df->dev_name);
+	    return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+/* DEV_CKPREST - Restore all device state.
+**	If DOREST is FALSE, only checks that a restore would succeed,
+**	without changing anything.
+**	Returns # of devices, or -1 if failed.
+*/
+int
+dev_ckprest(FILE *of, struct ckpt_s *ck, int dorest)
+{
+    register struct dvdef_s *df;
+    int ndevs = 0;
+
+    for (df = dvdeftab; df < &dvdeftab[KLH10_DEVMAX]; ++df) {
+	if (!df->dev_name)
+	    continue;
+	if (!df->dev_dv->dv_ckrest) {
+	    fprintf(of, "Device \"%s\" cannot be restored\n", df->dev_name);
+	    return -1;
+	}
+	if (!ckp_secfind(ck, "DEV", df->dev_name)) {
+	    fprintf(of, "Checkpoint has no state for device \"%s\"\n",
+			df->dev_name);
+	    return -1;
+	}
+	if (!(*df->dev_dv->dv_ckrest)(df->dev_dv, ck, dorest)) {
+	    fprintf(of, "Restore of device \"%s\" failed\n", df->dev_name);
+	    return -1;
+	}
+	++ndevs;
+    }
+    return ndevs;
+}
+
+#endif /* KLH10_CKPT */
@@ -111,6 +111,7 @@ Issues not addressed:
 **	created struct.
 */
 #define dv_t struct device	/* Temporary local def */
+struct ckpt_s;			/* See kn10ckp.h */
 struct device {
 
 	/* All IO */
@@ -183,6 +184,15 @@ struct device {
     void  (*dv_powon) (dv_t *);		/* "Power on" */
     void  (*dv_reset) (dv_t *);		/* System reset */
     void  (*dv_powoff)(dv_t *);		/* "Power off" */
+
+#if KLH10_CKPT
+	/* Checkpoint/restore (NULL if device can't be checkpointed) */
+
+    int (*dv_ckpt)  (dv_t *,		/* Save state */
+		     struct ckpt_s *);
+    int (*dv_ckrest)(dv_t *,		/* Restore, or just check if 0 */
+		     struct ckpt_s *, int);
+#endif
 };
 #undef dv_t	/* Was only temporary */
 
@@ -227,6 +237,11 @@ extern int  dev_show(FILE *, char *, char *);
 extern int  dev_status(FILE *, char *, char *);
 extern int  dev_waiting(FILE *, char *);
 extern int  dev_dpchk_ctl(int);
+#if KLH10_CKPT
+extern int  dev_ckpready(FILE *, int);
+extern int  dev_ckpsave(FILE *, struct ckpt_s *);
+extern int  dev_ckprest(FILE *, struct ckpt_s *, int);
+#endif
 
 extern int iodv_version(void);		/* Return current ver of dev struct */
 extern int iodv_nullinit(struct device *, int);	/* For initing to null dev */
@@ -241,6 +256,7 @@ enum dveventtype {
 	DVEV_NSIG,	/* Multiplexed signal */
 	DVEV_ASIG,	/* Allocated signal */
 	DVEV_DPSIG,	/* Dev subproc comm signal */
+	DVEV_DPBELL,	/* Dev subproc comm doorbell (eventfd) */
 	DVEV_N		/* #+1 of event types */
 };
 
@@ -274,6 +290,9 @@ struct dvevreg_s {
     void (*dver_hdlr)(struct device *, struct dvevent_s *);
     struct device *dver_d;		/* Remember its device */
     struct dvevent_s dver_ev;		/* and args */
+#if KLH10_MULTI
+    struct machstate *dver_cpu;		/* Machine that registered it */
+#endif
 };
 extern struct dvevreg_s *evregfree;	/* Head of reg entry free list */
 extern struct dvevreg_s evregtab[];
@@ -285,6 +304,17 @@ struct dvevsig_s {
 	int dves_sig;			/* Signal # */
 	struct dvevreg_s *dves_reglist;	/* List of event hndlrs for this sig */
 };
+
+#if KLH10_EVHS_BELL
+struct dvevbel_s {
+	osintf_t dveb_intf;		/* Set when bell rung */
+	int dveb_fd;			/* Its eventfd, -1 if entry free */
+	struct dvevreg_s *dveb_reg;	/* The one handler for it */
+# if KLH10_MULTI
+	struct machstate *dveb_cpu;	/* Machine to interrupt */
+# endif
+};
+#endif
 extern struct dvevsig_s *evsiglist;	/* Head of reg'd signal list */
 extern struct dvevsig_s evsigtab[];
 
@@ -95,6 +95,11 @@
     /* Determine behavior of FDV */
 # ifndef OP10_FDV_KL
 #  define OP10_FDV_KL (KLH10_CPU_KL || KLH10_CPU_KS)
+# endif
+
+    /* Determine whether to try host floating point first */
+# ifndef OP10_HOSTFP
+#  define OP10_HOSTFP KLH10_HOSTFP
 # endif
 
 #endif
@@ -119,6 +124,14 @@
 **	If not defined, acts like KA/KI and always fails for cases of 1 and +1.
 ** OP10_FDV_KL - Defined 1 to specify KL+KS behavior on FDV.
 **	If 0 or undefined, uses KA+KI behavior.
+** OP10_INT128 - Defined 1 to do fixed-point multiply and divide with the
+**	host's unsigned __int128 type (GCC, Clang) instead of 16-bit digit
+**	vectors and bit-serial division.  Results and flags are identical.
+**	If undefined, defaults to 1 if the compiler provides the type.
+** OP10_HOSTFP - Defined 1 to try the host's long double first for the
+**	single, D and G format add, subtract, multiply and divide ops.
+**	See "Host floating-point engine" below.  If 0 or undefined, the
+**	integer code is always used.
 */
 
 #include "kn10ops.h"	/* Get defs and macro facilities */
@@ -148,6 +161,41 @@
 #ifndef OP10_KCCOPS		/* Default is not to include KCC stuff */
 # define OP10_KCCOPS 0
 #endif
+#ifndef OP10_INT128		/* Default is to use host 128-bit ints if any */
+# if defined(__SIZEOF_INT128__) && defined(WORD10_INT64)
+#  define OP10_INT128 1
+# else
+#  define OP10_INT128 0
+# endif
+#endif
+
+#ifndef OP10_HOSTFP		/* Default is integer-only floating point */
+# define OP10_HOSTFP 0
+#endif
+
+#if OP10_INT128 || OP10_HOSTFP
+/* Host 64-bit integer facilities.
+**	Words are converted via LH and RH so that any word model works.
+*/
+# define U35MASK ((((uint64)1)<<35)-1)
+# define U36MASK ((((uint64)1)<<36)-1)
+# define x_wtou64(w) (((uint64)LHGET(w) << H10BITS) | RHGET(w))
+# define x_u64tow(w,v) LRHSET(w, (h10_t)((v) >> H10BITS) & H10MASK, \
+				(h10_t)(v) & H10MASK)
+#endif
+
+#if OP10_INT128
+/* Host 128-bit integer facilities.
+**	Double and quad values are built from 35-bit pieces since the sign
+**	bits of their low-order words are not part of the value.
+*/
+typedef unsigned __int128 uint128;
+
+# define x_dtou128(d) (((uint128)x_wtou64((d).HI) << 35) \
+				| (x_wtou64((d).LO) & U35MASK))
+# define x_u128tod(d,v) (x_u64tow((d).HI, (uint64)((v) >> 35) & U36MASK), \
+			 x_u64tow((d).LO, (uint64)(v) & U35MASK))
+#endif /* OP10_INT128 */
 
 
 /* Determine whether DIV() or LDIV() is available from C */
@@ -340,7 +388,7 @@ w10_t op10utow(uint32 u)
 /* Convert w10_t to signed base integer */
 int32 op10wtos(register w10_t w)
 {
-    return ((((int32)LHGET(w))|(~H10MASK)) << HBITS) | RHGET(w);
+    return ((((int32)LHGET(w))|(~H10MASK)) << H10BITS) | RHGET(w);
 }
 
 
@@ -1166,6 +1214,17 @@ dw10_t op10mul(register w10_t a, register w10_t b)
 /* OP10XMUL - Special unsigned multiplication of 36-bit integers.
 **	Returns a 71-bit product, with the low order sign bit clear.
 */
+#if OP10_INT128
+dw10_t op10xmul(register w10_t a, register w10_t b)
+{
+    register dw10_t d;
+    register uint128 p;
+
+    p = (uint128)x_wtou64(a) * x_wtou64(b);
+    x_u128tod(d, p);
+    return d;
+}
+#else
 dw10_t op10xmul(register w10_t a, register w10_t b)
 {
     register int ai, bi;
@@ -1228,6 +1287,7 @@ dw10_t op10xmul(register w10_t a, register w10_t b)
 #endif
     return d;
 }
+#endif /* !OP10_INT128 */
 
 /* IDIV and DIV.  Note that if these routines are used for instruction
 **	emulation, some provision must be made for aborting the instruction
@@ -1368,7 +1428,22 @@ static int x_div(
 	d.LO = op10utow(num%den);
 	DEBUGPRF(("idivquick: %o/%o Q: %lo,%lo R: %lo,%lo\n",
 		numsign, densign, DBGV_W(d.HI), DBGV_W(d.LO)));
-    } else {
+    }
+#if OP10_INT128
+    else if (!wskipl(d.HI) && !wskipl(w) && op10m_ucmpl(d.HI, w)) {
+	/* Host division is exact when the high word is less than the
+	** divisor.  Overflow and the max-neg cases go to ddivstep below.
+	*/
+	register uint128 num;
+	register uint64 den;
+
+	num = x_dtou128(d);
+	den = x_wtou64(w);
+	x_u64tow(d.HI, (uint64)(num / den));
+	x_u64tow(d.LO, (uint64)(num % den));
+    }
+#endif
+    else {
 	/* Ugh, hack big numbers */
 	/* Divide them, get double result */
 	if (!ddivstep(&d, w, 35, numsign != densign))
@@ -1604,6 +1679,35 @@ qw10_t op10dmul(register dw10_t da, register dw10_t db)
 
 /* Unsigned double-int multiply */
 
+#if OP10_INT128
+static qw10_t x_dmul(register dw10_t da, register dw10_t db)
+{
+    register qw10_t q;		/* Quad-length result */
+    register uint128 t;
+    register uint64 a1, a0, b1, b0;
+
+    /* Split 71-bit args into high word and 35-bit low magnitude, then
+    ** add up partial products a 35-bit result word at a time.
+    */
+    a1 = x_wtou64(da.HI), a0 = x_wtou64(da.LO) & U35MASK;
+    b1 = x_wtou64(db.HI), b0 = x_wtou64(db.LO) & U35MASK;
+
+    t = (uint128)a0 * b0;
+    x_u64tow(q.D1.LO, (uint64)t & U35MASK);
+    t = (t >> 35) + (uint128)a1 * b0 + (uint128)a0 * b1;
+    x_u64tow(q.D1.HI, (uint64)t & U35MASK);
+    t = (t >> 35) + (uint128)a1 * b1;
+    x_u128tod(q.D0, t);
+
+    /* Must duplicate sign bit in all low-order words. */
+    if (wskipl(q.D0.HI)) {
+	op10m_signset(q.D0.LO);
+	op10m_signset(q.D1.HI);
+	op10m_signset(q.D1.LO);
+    }
+    return q;
+}
+#else
 static qw10_t x_dmul(register dw10_t da, register dw10_t db)
 {
     register qw10_t q;		/* Quad-length result */
@@ -1679,6 +1783,7 @@ static qw10_t x_dmul(register dw10_t da, register dw10_t db)
     }
     return q;
 }
+#endif /* !OP10_INT128 */
 
 /* Note returns quadword! High double is quotient */
 
@@ -1688,6 +1793,9 @@ qw10_t op10ddiv(
 {
     qw10_t origq;
     int numsign, densign;
+#if OP10_INT128
+    uint128 num, den;
+#endif
 
     origq = qw;			/* Save original arg in case of error */
 
@@ -1719,7 +1827,27 @@ qw10_t op10ddiv(
 	}
 	qw.D0.LO = qw.D1.HI;		/* Quotient here, qw.D0.HI already 0 */
 	op10m_setz(qw.D1.HI);		/* Remainder already in qw.D1.LO */
-    } else {
+    }
+#if OP10_INT128
+    else if (!wskipl(qw.D0.HI) && !wskipl(d.HI)
+	  && (num = x_dtou128(qw.D0)) < (den = x_dtou128(d))) {
+	/* Host division, exact when the high double is less than the
+	** divisor.  Done as two 35-bit steps so no dividend exceeds 105
+	** bits.  Overflow and the max-neg cases go to qdivstep below.
+	*/
+	register uint128 x;
+	register uint64 q1;
+
+	x = (num << 35) | (x_wtou64(qw.D1.HI) & U35MASK);
+	q1 = (uint64)(x / den);
+	x = ((x % den) << 35) | (x_wtou64(qw.D1.LO) & U35MASK);
+	num = ((uint128)q1 << 35) | (x / den);
+	x %= den;
+	x_u128tod(qw.D0, num);		/* Quotient */
+	x_u128tod(qw.D1, x);		/* Remainder */
+    }
+#endif
+    else {
 	/* Ugh, must hack big numbers */
 	if (!qdivstep(&qw, d, 70)) {		/* Divide, get 70 bits */
 	    OP10_PCFSET(PCF_ARO+PCF_TR1+PCF_DIV);
@@ -1887,6 +2015,368 @@ qw10_t op10ddiv(
 
 
 #endif /* OP10_GFMT */
+
+#if OP10_HOSTFP
+
+/* Host floating-point engine.
+**
+**	The single, D and G format add, subtract, multiply and divide
+** routines first try to do the operation in the host's long double.
+** Operands are unpacked into integer fractions (which a 64-bit long
+** double holds exactly), the host operation is done, and an error-free
+** transformation (Knuth's TwoSum, or Dekker's product for MP and DV)
+** gives the sign of the host's rounding error.  The host result plus
+** that sign is enough to decide exactly how the PDP-10 would truncate
+** or round, so the packed result and flags are bit-for-bit identical
+** to the integer code.
+**	Anything that could come out differently is left to the integer
+** code: unnormalized or non-canonical operands, exponent overflow or
+** underflow, No Divide, and results that fall exactly halfway between
+** two fractions (the PDP-10 has several peculiar rules for those).
+**
+**	This needs a long double with at least 64 fraction bits whose
+** operations are rounded once, ie not fused or contracted (x87 extended
+** precision qualifies).  OP10HFPINIT checks that at runtime and leaves
+** OP10HFPON clear if not; the FE "hostfp test" command compares both
+** engines on random operands.
+*/
+
+#include <float.h>
+#include <math.h>
+
+#if !defined(WORD10_INT64)
+# error "OP10_HOSTFP needs a 64-bit integer type"
+#endif
+#if LDBL_MANT_DIG < 64
+# error "OP10_HOSTFP needs a long double with at least 64 fraction bits"
+#endif
+
+typedef long double hfp_t;
+
+int op10hfpon = 0;		/* TRUE to use engine (set by op10hfpinit) */
+unsigned long op10hfphits;	/* # ops done by host */
+unsigned long op10hfpmiss;	/* # ops left to integer code */
+
+#define HFP_SPLIT 4294967297.0L	/* 2^32+1, Dekker splitter for 64 bits */
+#define HFP_DMAX (62+3)		/* Max useful exponent difference for add */
+static hfp_t hfp_p2m[HFP_DMAX+1];	/* 2^-N table */
+
+/* Format parameters */
+struct hfpfmt {
+    int fbits;		/* # fraction bits */
+    int emax;		/* Max exponent value */
+    int excess;		/* The N in excess-N */
+    hfp_t fscale;	/* 2^fbits */
+};
+static struct hfpfmt hfp_sfmt = { 27, 0377, 0200, 134217728.0L };
+static struct hfpfmt hfp_dfmt = { 62, 0377, 0200, 4611686018427387904.0L };
+#if OP10_GFMT
+static struct hfpfmt hfp_gfmt = { 59, 03777, 02000, 576460752303423488.0L };
+#endif
+
+/* Host operation result */
+struct hfpres {
+    int neg;		/* TRUE if negative */
+    int inexact;	/* TRUE if bits were lost */
+    int exp;		/* Exponent, in range */
+    uint64 frac;	/* Normalized fraction magnitude, or 0 */
+};
+
+#define HFP_ADD 0	/* Ops */
+#define HFP_SUB 1
+#define HFP_MUL 2
+#define HFP_DIV 3
+
+#define HFP_TRUNC 0	/* Modes: Truncate magnitude */
+#define HFP_ONES  1	/* Truncate magnitude, ones-complement if inexact */
+#define HFP_FLOOR 2	/* Truncate toward minus infinity */
+#define HFP_ROUND 3	/* Round (halfway cases never get here) */
+#if OP10_FDV_KL
+# define HFP_FDVMODE HFP_ONES	/* See PRM note for FDV */
+#else
+# define HFP_FDVMODE HFP_TRUNC
+#endif
+
+/* OP10HFPINIT - Set up tables and check that the host is suitable.
+**	Returns new value of op10hfpon.
+*/
+int op10hfpinit(void)
+{
+    volatile hfp_t one, eps;
+    hfp_t v = 1;
+    int i;
+
+    for (i = 0; i <= HFP_DMAX; ++i) {
+	hfp_p2m[i] = v;
+	v *= 0.5L;
+    }
+
+    /* 1+2^-63 must be exact, and 1+2^-64 must round to even */
+    one = 1;
+    eps = hfp_p2m[63];
+    op10hfpon = ((one + eps) != one) && ((one + eps*0.5L) == one);
+    return op10hfpon;
+}
+
+/* Unpack single-precision word.  Returns FALSE if not normalized.
+*/
+static int hfp_sunpk(register w10_t w, hfp_t *av, int *ae)
+{
+    register uint64 u = x_wtou64(w);
+    register int neg = 0;
+
+    if (!u) {
+	*av = 0, *ae = 0;
+	return TRUE;
+    }
+    if (u & (U36MASK ^ U35MASK)) {	/* Negative? */
+	u = (0 - u) & U36MASK;		/* Get positive form */
+	if (u & (U36MASK ^ U35MASK))	/* Max neg, can't */
+	    return FALSE;
+	neg = TRUE;
+    }
+    if (!(u & ((uint64)1 << 26)))	/* Must be normalized */
+	return FALSE;
+    *ae = (int)(u >> 27);
+    *av = (hfp_t)(u & ((((uint64)1) << 27)-1));
+    if (neg)
+	*av = -*av;
+    return TRUE;
+}
+
+/* Unpack D or G format double.  Returns FALSE if not normalized.
+**	Low word sign must be clear, as all double ops leave it.
+*/
+static int hfp_dunpk(register dw10_t d, register struct hfpfmt *fp,
+		     hfp_t *av, int *ae)
+{
+    register uint64 hi = x_wtou64(d.HI);
+    register uint64 lo = x_wtou64(d.LO);
+    register int hbits = fp->fbits - 35;	/* # fract bits in high wd */
+    register int neg = 0;
+
+    if (lo & (U36MASK ^ U35MASK))
+	return FALSE;
+    if (!hi && !lo) {
+	*av = 0, *ae = 0;
+	return TRUE;
+    }
+    if (hi & (U36MASK ^ U35MASK)) {	/* Negative? Do DMOVN */
+	if (lo) {
+	    lo = (U35MASK + 1) - lo;
+	    hi = ~hi & U36MASK;
+	} else
+	    hi = (0 - hi) & U36MASK;
+	if (hi & (U36MASK ^ U35MASK))	/* Max neg, can't */
+	    return FALSE;
+	neg = TRUE;
+    }
+    if (!(hi & ((uint64)1 << (hbits-1))))	/* Must be normalized */
+	return FALSE;
+    *ae = (int)(hi >> hbits);
+    *av = (hfp_t)(((hi & ((((uint64)1) << hbits)-1)) << 35) | lo);
+    if (neg)
+	*av = -*av;
+    return TRUE;
+}
+
+/* Return error of the host product P = A*B (Dekker).
+*/
+static hfp_t hfp_mulerr(register hfp_t a, register hfp_t b, register hfp_t p)
+{
+    register hfp_t t, ah, al, bh, bl;
+
+    t = HFP_SPLIT * a;
+    ah = t - (t - a);
+    al = a - ah;
+    t = HFP_SPLIT * b;
+    bh = t - (t - b);
+    bl = b - bh;
+    return ((ah*bh - p) + ah*bl + al*bh) + al*bl;
+}
+
+/* Do operation on unpacked operands (integer fractions and exponents).
+**	Returns FALSE if the integer code must be used.
+*/
+static int hfp_op(int op, register struct hfpfmt *fp,
+		  hfp_t a, int ea, hfp_t b, int eb,
+		  int mode, register struct hfpres *rp)
+{
+    register hfp_t r, t, err;
+    register uint64 k;
+    int e, i;
+
+    switch (op) {
+    case HFP_SUB:
+	b = -b;
+	/* Drop through */
+    case HFP_ADD:
+	if (ea < eb) {		/* Get larger exponent in A */
+	    t = a, a = b, b = t;
+	    i = ea, ea = eb, eb = i;
+	}
+	/* Align B.  If it is shifted entirely below A's LSB, only its sign
+	** matters, so limit the shift to keep it representable.
+	*/
+	if ((i = ea - eb) > fp->fbits + 3)
+	    i = fp->fbits + 3;
+	b *= hfp_p2m[i];
+	r = a + b;
+	t = r - a;			/* TwoSum */
+	err = (a - (r - t)) + (b - t);
+	e = ea - fp->fbits;
+	break;
+
+    case HFP_MUL:
+	r = a * b;
+	err = r ? hfp_mulerr(a, b, r) : 0;
+	e = ea + eb - fp->excess - 2*fp->fbits;
+	break;
+
+    case HFP_DIV:
+	if (b == 0)
+	    return FALSE;		/* No Divide */
+	r = a / b;
+	if (r) {			/* Get sign of remainder */
+	    t = r * b;
+	    err = (a - t) - hfp_mulerr(r, b, t);
+	    if (b < 0)
+		err = -err;
+	} else
+	    err = 0;
+	e = ea - eb + fp->excess;
+	break;
+
+    default:
+	return FALSE;
+    }
+
+    if (r == 0) {			/* Zero result is exact */
+	rp->neg = rp->inexact = rp->exp = 0;
+	rp->frac = 0;
+	return TRUE;
+    }
+    if ((rp->neg = (r < 0))) {		/* Work with magnitude */
+	r = -r;
+	err = -err;
+    }
+
+    /* Scale R so integer part is the fraction.  If R is a power of 2
+    ** and the true value is below it, it belongs to the next binade down.
+    */
+    r = frexpl(r, &i) * fp->fscale;
+    e += i;
+    if (err < 0 && r == fp->fscale * 0.5L) {
+	r = fp->fscale;
+	--e;
+    }
+    k = (uint64)r;
+    r -= (hfp_t)k;			/* Get fraction lost, exactly */
+
+    /* Find where the true value lies: exact, below half an LSB, or above.
+    ** The host error is at most half the host LSB, so only matters if
+    ** R itself lands on 0 or 1/2.
+    */
+    if (r == 0) {
+	if (err == 0)
+	    i = 0;
+	else if (err > 0)
+	    i = 1;
+	else
+	    --k, i = 2;
+    } else if (r != 0.5L)
+	i = (r < 0.5L) ? 1 : 2;
+    else if (err != 0)
+	i = (err > 0) ? 2 : 1;
+    else
+	return FALSE;			/* Exactly halfway */
+
+    /* The PDP-10 normalizes a negative sum by its twos-complement form,
+    ** which treats a value just above -2^n as still in the binade of
+    ** -2^n, and rounds it there.  Leave those to the integer code.
+    */
+    if (rp->neg && mode == HFP_ROUND && op <= HFP_SUB
+      && (k == (((uint64)2) << (fp->fbits-1)) - 1
+	|| (k == (((uint64)2) << (fp->fbits-1)) - 2 && i)))
+	return FALSE;
+
+    switch (mode) {
+    case HFP_FLOOR:
+	if (rp->neg && i)
+	    ++k;
+	break;
+    case HFP_ROUND:
+	if (i == 2)
+	    ++k;
+	break;
+    }
+    if (k >> fp->fbits) {		/* Carried out of fraction? */
+	k >>= 1;
+	++e;
+    }
+    if (e < 0 || e > fp->emax)
+	return FALSE;			/* Let integer code set flags */
+    rp->inexact = (i != 0);
+    rp->exp = e;
+    rp->frac = k;
+    return TRUE;
+}
+
+/* Single-precision op.  Returns FALSE if the integer code must be used.
+*/
+static int hfp_sop(int op, register w10_t a, register w10_t b, int mode,
+		   w10_t *aw)
+{
+    struct hfpres res;
+    hfp_t va, vb;
+    int ea, eb;
+    register uint64 u;
+
+    if (!hfp_sunpk(a, &va, &ea) || !hfp_sunpk(b, &vb, &eb)
+      || !hfp_op(op, &hfp_sfmt, va, ea, vb, eb, mode, &res)) {
+	++op10hfpmiss;
+	return FALSE;
+    }
+    u = ((uint64)res.exp << 27) | res.frac;
+    x_u64tow(*aw, u);
+    if (res.neg) {
+	if (mode == HFP_ONES && res.inexact)
+	    op10m_setcm(*aw);
+	else
+	    op10m_movn(*aw);
+    }
+    ++op10hfphits;
+    return TRUE;
+}
+
+/* D or G format op, always rounded.
+**	Returns FALSE if the integer code must be used.
+*/
+static int hfp_dop(int op, register dw10_t a, register dw10_t b,
+		   register struct hfpfmt *fp, dw10_t *ad)
+{
+    struct hfpres res;
+    hfp_t va, vb;
+    int ea, eb;
+    register uint64 u;
+
+    if (!hfp_dunpk(a, fp, &va, &ea) || !hfp_dunpk(b, fp, &vb, &eb)
+      || !hfp_op(op, fp, va, ea, vb, eb, HFP_ROUND, &res)) {
+	++op10hfpmiss;
+	return FALSE;
+    }
+    u = ((uint64)res.exp << (fp->fbits - 35)) | (res.frac >> 35);
+    x_u64tow(ad->HI, u);
+    u = res.frac & U35MASK;
+    x_u64tow(ad->LO, u);
+    if (res.neg)
+	op10m_dmovn(*ad);
+    ++op10hfphits;
+    return TRUE;
+}
+
+#endif /* OP10_HOSTFP */
+
 
 /* Floating-point Single-precision arithmetic */
 
@@ -1921,6 +2411,15 @@ static w10_t ffadr(register w10_t a, register w10_t b, int flg)
     register int i, expa, expb;
     register uint18 rbit;		/* May be 1<<17 */
 
+#if OP10_HOSTFP
+    if (op10hfpon && !(flg & FADF_NONORM)) {
+	w10_t w;
+	if (hfp_sop(((flg & FADF_NEGB) ? HFP_SUB : HFP_ADD), a, b,
+		    ((flg & FADF_NORND) ? HFP_FLOOR : HFP_ROUND), &w))
+	    return w;
+    }
+#endif
+
     SFSETUP(expa, a);		/* Set up exponent and fraction for A */
     SFSETUP(expb, b);		/* Ditto for B */
 
@@ -2089,6 +2588,14 @@ static w10_t ffmpr(register w10_t a, register w10_t b, int dornd)
     register dw10_t d;
     register int sign, exp, i, expb;
 
+#if OP10_HOSTFP
+    if (op10hfpon) {
+	w10_t w;
+	if (hfp_sop(HFP_MUL, a, b, (dornd ? HFP_ROUND : HFP_ONES), &w))
+	    return w;
+    }
+#endif
+
     /* Make operands positive and remember sign of result */
     SF_POSSETUP(sign, exp, a);		/* Get positive exp and fract */
 
@@ -2192,6 +2699,12 @@ int op10xfdv(w10_t *aw,
     dw10_t d;
     register int sign, exp, i, expb;
 
+#if OP10_HOSTFP
+    if (op10hfpon && hfp_sop(HFP_DIV, a, b,
+			     (dornd ? HFP_ROUND : HFP_FDVMODE), aw))
+	return TRUE;
+#endif
+
     /* Make operands positive and remember sign of result */
 
     if ((sign = wskipl(a))) {	/* Negative? */
@@ -2782,6 +3295,14 @@ static dw10_t dfad(register dw10_t a,
     register uint18 rbit;		/* May be 1<<17 */
     register dw10_t rd;
 
+#if OP10_HOSTFP
+    if (op10hfpon) {
+	dw10_t d;
+	if (hfp_dop((negb ? HFP_SUB : HFP_ADD), a, b, &hfp_dfmt, &d))
+	    return d;
+    }
+#endif
+
     SFSETUP(expa, a.HI);		/* Set up exponent and fraction */
     SFSETUP(expb, b.HI);		/* Ditto for other arg */
 
@@ -2976,6 +3497,14 @@ dw10_t op10dfmp(register dw10_t a, register dw10_t b)
     register int sign;
     int signb;
 
+#if OP10_HOSTFP
+    if (op10hfpon) {
+	dw10_t d;
+	if (hfp_dop(HFP_MUL, a, b, &hfp_dfmt, &d))
+	    return d;
+    }
+#endif
+
     /* Make operands positive and remember sign of result
     ** These macros guarantee a positive number of at most 62 magnitude bits,
     ** even for the max-neg-# case.
@@ -3072,6 +3601,14 @@ dw10_t op10dfdv(register dw10_t a, register dw10_t b)
     register int exp, i;
     register int expb, sign, signb;
 
+#if OP10_HOSTFP
+    if (op10hfpon) {
+	dw10_t d;
+	if (hfp_dop(HFP_DIV, a, b, &hfp_dfmt, &d))
+	    return d;
+    }
+#endif
+
 #if 1	/* New code */
     /* Make operands positive and remember sign of result */
     /* The KLX appears to have a peculiarly rigid filter for the
@@ -3349,6 +3886,14 @@ static dw10_t x_gfad(register dw10_t a, register dw10_t b, int negb)
     register uint18 rbit;		/* May be 1<<17 */
     register dw10_t rd;
 
+#if OP10_HOSTFP
+    if (op10hfpon) {
+	dw10_t d;
+	if (hfp_dop((negb ? HFP_SUB : HFP_ADD), a, b, &hfp_gfmt, &d))
+	    return d;
+    }
+#endif
+
     GFSETUP(expa, a.HI);	/* Set up exp & fract for A */
     GFSETUP(expb, b.HI);	/* Set up exp & fract for B */
 
@@ -3657,6 +4202,14 @@ dw10_t op10gfmp(register dw10_t a, register dw10_t b)
     register int sign;
     int signb;
 
+#if OP10_HOSTFP
+    if (op10hfpon) {
+	dw10_t d;
+	if (hfp_dop(HFP_MUL, a, b, &hfp_gfmt, &d))
+	    return d;
+    }
+#endif
+
     /* Make operands positive and remember sign of result */
     GF_DPOSSETUP(sign, exp, a);
     GF_DPOSSETUP(signb, expb, b);
@@ -3738,6 +4291,14 @@ dw10_t op10gfdv(register dw10_t a, register dw10_t b)
     register int expb, sign, signb;
     dw10_t origa;
 
+#if OP10_HOSTFP
+    if (op10hfpon) {
+	dw10_t d;
+	if (hfp_dop(HFP_DIV, a, b, &hfp_gfmt, &d))
+	    return d;
+    }
+#endif
+
     /* Make operands positive and remember sign of result */
     /* The odd code here is similar to that for DFDV for the same reasons.
     */
@@ -236,6 +236,13 @@ extern int		/* Operations that can abort */
 extern int		/* Miscellaneous */
 	op10ffo(w10_t);
 
+extern int		/* Host floating-point engine (OP10_HOSTFP) */
+	op10hfpon,
+	op10hfpinit(void);
+extern unsigned long
+	op10hfphits,
+	op10hfpmiss;
+
 #endif /* !WORD10_USENAT */
 
 /* Define op10m_* macros for optimizing in-line coding if possible.
@@ -26,6 +26,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>	/* For malloc */
 #include <string.h>
 
 #include "klh10.h"
@@ -52,6 +53,21 @@ static void pag_clear(void);
 static void pag_mapclr(pment_t *);
 static void pag_segclr(pment_t *);
 static void pag_nxmfail(paddr_t, pment_t, char *);
+#if KLH10_PAG_TLB
+struct pagtlb_s;
+static void pag_tlbinit(void);
+static void pag_tlbstart(struct pagtlb_s *);
+static void pag_tlbclr(struct pagtlb_s *);
+static void pag_tlbflush(void);
+static void pag_tlbswitch(paddr_t);
+static void pag_tlbwatch(struct pagtlb_s *, pagno_t);
+static void pag_scwatch(struct pagtlb_s *, struct pagtlb_s *, pagno_t);
+static void pag_scclr(struct pagtlb_s *);
+static void pag_scinv(struct pagtlb_s *, pagno_t);
+static void pag_tlbdrop(struct pagtlb_s *, pagno_t);
+static void pag_tlbset(pment_t *, pagno_t, pagno_t, h10_t, pment_t, pment_t);
+static int pag_tlbreval(pagno_t, pment_t, pagno_t *, h10_t *);
+#endif
 
 /* Pager code */
 /*
@@ -93,6 +109,10 @@ pag_init(void)
 {
     register int i;
 
+#if KLH10_PAG_TLB
+    pag_tlbinit();
+#endif
+
     /* Initialize externally visible registers */
 #if KLH10_CPU_KS
     LRHSET(cpu.mr_ebr, 0,
@@ -238,6 +258,34 @@ pag_enable(int onf)
     }
 }
 
+#if KLH10_CKPT
+/* PAG_CKPREST - Rebuild internal pager state after the externally visible
+**	registers (EBR, UBR, pager regs, mr_paging, AC blocks) have been
+**	copied in from a checkpoint.
+*/
+void
+pag_ckprest(void)
+{
+    int onf = cpu.mr_paging;
+
+    cpu.mr_paging = FALSE;	/* Force pag_enable to do everything */
+    pag_enable(onf);
+    pag_clear();
+
+    /* pag_enable set the maps for exec mode; fix up if not there */
+    if (cpu.mr_usrmode)
+	vmap_set(cpu.vmap.user, cpu.vmap.user);
+    else
+	vmap_set(cpu.vmap.exec,
+		(PCFTEST(PCF_UIO) ? cpu.vmap.user : cpu.vmap.exec));
+#if KLH10_CPU_KL
+    cpu.mr_abk_pmap = (cpu.mr_abk_cond & ABK_USER) ? cpu.pr_umap : cpu.pr_emap;
+#endif
+    cpu.pag.pr_fmap = NULL;	/* Old page fail info is meaningless */
+    cpu.pag.pr_fstr = NULL;
+}
+#endif /* KLH10_CKPT */
+
 /* PAG_CLEAR - Invalidate all pager maps by clearing all internal entries.
 **	Perhaps optimize by keeping count of refills?  If count zero,
 **	don't need to re-clear the table.
@@ -246,7 +294,11 @@ static void
 pag_clear(void)
 {
     PCCACHE_RESET();		/* Invalidate cached PC info */
+#if KLH10_PAG_TLB
+    pag_tlbflush();		/* Also drops retained user maps */
+#else
     pag_mapclr(cpu.pr_umap);
+#endif
     pag_mapclr(cpu.pr_emap);
 }
 
@@ -268,7 +320,598 @@ pag_segclr(register pment_t *p)
     cpu.mr_abk_pmflags = 0;
 #endif
 }
+
+#if KLH10_PAG_TLB
+
+/* Retained user maps (software TLB)
+
+	TOPS-20 writes the UBR on every process switch, which clears
+the user map; the new process then refills each page it touches by
+walking its section pointer, SPT, page map and CST entries again.
+With KLH10_PAG_TLB the user map is instead saved in one of a few slots
+tagged by UPT address when the UBR changes, and brought back when that
+UPT is selected again.
+
+	A saved entry is only good while the tables it was built from
+are unchanged.  Each frame holding an SPT entry, section table or page
+map that a user refill reads is "watched": no internal map entry for
+it keeps VMF_WRITE, so any store into it comes back through pag_refill,
+which unwatches the frame and drops every set (including the live one)
+that depended on it.  The UPT is written far too often to watch; its
+section pointers are saved with each set and compared instead, as are
+the SPT and CST base addresses.  Anything that does a full pag_clear
+(WREBR, paging on/off) retires all sets.  Device transfers into memory
+never go through the maps, so the disk channels report each one with
+PAG_IOWRITE when it completes, and it counts as a store.  So do the
+NI20 for received datagrams and the DTE20 for to-10 data, which can run
+past the page it mapped.  Their other stores (queue and BSD words, EPT
+and comm region) are into monitor tables that a refill never reads.
+
+	The CST is not watched either, since the monitor is always
+changing it.  Entries come back without access bits, and on first
+touch are revalidated by repeating just the CST part of the refill for
+the page map and the page (age trap, CSTM and PUR, M bit).  So the
+monitor sees the same CST traffic as with a cleared map, but the rest
+of the walk is skipped.  The exec map is still cleared on every switch,
+since per-process monitor pages are mapped through the UPT.
+
+	The same watch also backs a memo of the section part of the walk,
+for both maps: a small table, hashed on the UPT or EPT section pointer,
+of the page map pointer and access bits each pointer led to through the
+SPT and any indirect section tables.  A refill that finds the same
+section pointer (and SPT base) takes the page map pointer straight from
+the memo.  Hashing on the pointer rather than the section # lets the
+memos for several processes live side by side.  A store into any frame
+the walk read, a CLRPT of a page in that section, or pag_clear forgets
+it.
+*/
+
+#define PAGTLB_NSETS	16	/* # of retained user maps */
+#define PAGTLB_SETMAX	1024	/* Max entries kept per map */
+#define PAGTLB_LOGMAX	4096	/* Max fills tracked in live map */
+#define PAGTLB_NSECT	(PAG_MAXVIRTPGS >> (PAG_NABITS-PAG_BITS))
+#define PAGTLB_NOFRM	((pment_t)-1)	/* ti_mfrm: entry can't be kept */
+#define PAGTLB_BMSIZ	((PAG_MAXPHYSPGS+7)/8)	/* Bytes in frame bitmap */
+#define PAGSC_MAXFRM	4	/* Max frames a memoized section walk reads */
+#define PAGSC_N		256	/* # section memos, power of 2 */
+#define PAGSC_HASH(w) ((RHGET(w) ^ (LHGET(w) >> 6)) & (PAGSC_N-1))
+
+/* Store CST entry only if it changed.  Most refills find the age and
+** use bits already as CSTM/PUR would leave them, and skipping those
+** stores keeps the CST from being dirtied on every refill.
+*/
+#define PAG_CSTSET(pa, w) \
+	(op10m_camn(*vm_physmap(pa), w) ? (void)vm_pset(vm_physmap(pa), w) \
+					: (void)0)
+
+#define pag_tlbbit(bm,pg)  ((bm)[(pg)>>3] & (1<<((pg)&07)))
+#define pag_tlbbset(bm,pg) ((bm)[(pg)>>3] |= (1<<((pg)&07)))
+#define pag_tlbbclr(bm,pg) ((bm)[(pg)>>3] &= ~(1<<((pg)&07)))
+
+struct pagtlbi {		/* What a user map entry was built from */
+	pment_t ti_pme;		/* Phys page | VMF_READ, or 0 if unused */
+	pment_t ti_mfrm;	/* Phys page of page map, or PAGTLB_NOFRM */
+	h10_t ti_acc;		/* Access bits from walk, less M */
+};
+
+struct pagsc {			/* Memoized section pointer walk */
+	w10_t sc_ptr;		/* Section pointer in UPT or EPT */
+	w10_t sc_w;		/* Page map pointer it led to */
+	h10_t sc_acc;		/* Access bits along the way */
+	paddr_t sc_spb;		/* SPT base used */
+	int sc_nfrm;		/* # frames below, -1 if entry unused */
+	pagno_t sc_frm[PAGSC_MAXFRM];	/* SPT and section table frames */
+};
+
+struct pagtlbset {
+	paddr_t ts_ubr;		/* Tag: UPT phys addr, 0 if slot free */
+	paddr_t ts_spb;		/* SPT base it was built with */
+	paddr_t ts_csb;		/* CST base  "   "    "    "  */
+	unsigned long ts_gen;	/* Good only while this matches tl_gen */
+	unsigned long ts_used;	/* For LRU replacement */
+	w10_t ts_sect[PAGTLB_NSECT];	/* UPT section pointers */
+	unsigned char ts_dep[PAGTLB_BMSIZ];	/* Frames it depends on */
+	int ts_cnt;			/* # entries below */
+	struct pagtlbe {
+	    pagno_t te_vpag;
+	    struct pagtlbi te_i;
+	} ts_ent[PAGTLB_SETMAX];
+};
+
+struct pagtlb_s {
+	unsigned long tl_gen;	/* Bumped by pag_clear */
+	unsigned long tl_stamp;	/* tl_gen when live map was started */
+	unsigned long tl_clock;	/* LRU clock */
+	int tl_ok;		/* Live map can be kept */
+	paddr_t tl_spb;		/* SPT base live map was started with */
+	paddr_t tl_csb;		/* CST base  "   "    "     "     "   */
+	w10_t tl_sect[PAGTLB_NSECT];	/* UPT section pointers, ditto */
+	unsigned char tl_dep[PAGTLB_BMSIZ];	/* Frames live map reads */
+	unsigned char tl_watch[PAGTLB_BMSIZ];	/* Frames being watched */
+	int tl_cnt;			/* # in tl_log, > LOGMAX if overflow */
+	pagno_t tl_log[PAGTLB_LOGMAX];	/* User map entries in use */
+	struct pagtlbi tl_info[PAG_MAXVIRTPGS];
+	struct pagtlbset tl_set[PAGTLB_NSETS];
+	struct pagsc tl_sc[PAGSC_N];	/* Section memos, by pointer */
+	int tl_nscfrm;			/* Frames read by current section */
+	pagno_t tl_scfrm[PAGSC_MAXFRM];	/*  walk; -1 if too many */
+
+	unsigned long tl_nswitch;	/* Statistics: # UBR switches */
+	unsigned long tl_nhit;		/* # that brought back a map */
+	unsigned long tl_nmiss;		/* # that didn't */
+	unsigned long tl_nreval;	/* # entries revalidated */
+	unsigned long tl_nfill;		/* # full user refills */
+	unsigned long tl_nwatch;	/* # frames newly watched */
+	unsigned long tl_nwrite;	/* # stores into watched frames */
+	unsigned long tl_nkill;		/* # maps dropped by those stores */
+	unsigned long tl_nschit;	/* # section walks from memo */
+	unsigned long tl_nscmiss;	/* # done the long way */
+};
+
+static void
+pag_tlbinit(void)
+{
+    if (!cpu.pr_tlb
+      && !(cpu.pr_tlb = (struct pagtlb_s *)malloc(sizeof(struct pagtlb_s))))
+	panic("pag_init: Cannot allocate retained user maps");
+    memset((char *)cpu.pr_tlb, 0, sizeof(struct pagtlb_s));
+    cpu.pr_tlb->tl_gen = 1;			/* So no slot is current */
+    cpu.pr_tlb->tl_cnt = PAGTLB_LOGMAX+1;	/* Force full clear */
+    pag_scclr(cpu.pr_tlb);
+}
+
+/* PAG_SCCLR - Forget all memoized section walks.
+*/
+static void
+pag_scclr(register struct pagtlb_s *t)
+{
+    register struct pagsc *sc = t->tl_sc;
+    register int i = PAGSC_N;
+
+    for (; --i >= 0; ++sc)
+	sc->sc_nfrm = -1;
+}
+
+/* PAG_SCINV - Forget the section memos for vpag's section, as reached
+**	through the current UPT and EPT.  Other sections are left alone.
+*/
+static void
+pag_scinv(register struct pagtlb_s *t,
+	  pagno_t vpag)
+{
+    register struct pagsc *sc;
+    register paddr_t pa;
+    register w10_t w;
+    register int i;
+
+    for (i = 0; i < 2; ++i) {
+	pa = (i ? cpu.mr_ebraddr : cpu.mr_ubraddr) + UPT_SC0
+		+ (vpag >> (PAG_NABITS-PAG_BITS));
+	if (pa >= cpu.pag.pr_physnxm)
+	    continue;
+	w = vm_pget(vm_physmap(pa));
+	sc = &t->tl_sc[PAGSC_HASH(w)];
+	if (!op10m_camn(w, sc->sc_ptr))
+	    sc->sc_nfrm = -1;
+    }
+}
+
+/* PAG_TLBSTART - Start a new live user map for the current UPT.
+*/
+static void
+pag_tlbstart(register struct pagtlb_s *t)
+{
+    register paddr_t pa = cpu.mr_ubraddr + UPT_SC0;
+    register int i;
+
+    t->tl_stamp = t->tl_gen;
+    t->tl_spb = PAG_PR_SPBPA;
+    t->tl_csb = PAG_PR_CSBPA;
+    memset((char *)t->tl_dep, 0, sizeof(t->tl_dep));
+    if ((t->tl_ok = (pa + PAGTLB_NSECT <= cpu.pag.pr_physnxm)))
+	for (i = 0; i < PAGTLB_NSECT; ++i)
+	    t->tl_sect[i] = vm_pget(vm_physmap(pa + i));
+}
+
+/* PAG_TLBCLR - Clear the live user map, touching only entries in use.
+*/
+static void
+pag_tlbclr(register struct pagtlb_s *t)
+{
+    register int i;
+    register pagno_t v;
+
+    if (t->tl_cnt > PAGTLB_LOGMAX) {
+	memset((char *)cpu.pr_umap, 0, sizeof(cpu.pr_umap));
+	memset((char *)t->tl_info, 0, sizeof(t->tl_info));
+    } else {
+	for (i = 0; i < t->tl_cnt; ++i) {
+	    v = t->tl_log[i];
+	    cpu.pr_umap[v] = 0;
+	    t->tl_info[v].ti_pme = 0;
+	}
+    }
+    t->tl_cnt = 0;
+#if KLH10_CPU_KL
+    cpu.mr_abk_pmflags = 0;
+#endif
+}
+
+/* PAG_TLBFLUSH - Clear the user map for pag_clear, retiring all saved ones.
+*/
+static void
+pag_tlbflush(void)
+{
+    ++cpu.pr_tlb->tl_gen;
+    pag_tlbclr(cpu.pr_tlb);
+    pag_tlbstart(cpu.pr_tlb);
+    pag_scclr(cpu.pr_tlb);
+}
+
+/* PAG_TLBSWITCH - Called by WRUBR instead of pag_clear when the UPT is
+**	set.  Saves the live user map under the old UPT address, if still
+**	good, and brings back any saved map for the new one.
+*/
+static void
+pag_tlbswitch(paddr_t oubr)
+{
+    register struct pagtlb_s *t = cpu.pr_tlb;
+    register struct pagtlbset *s, *ts;
+    register paddr_t pa;
+    register pagno_t v;
+    register int i, n;
+
+    PCCACHE_RESET();		/* Invalidate cached PC info */
+    ++t->tl_nswitch;
+
+    /* Save the live map if nothing it was built from has changed */
+    pa = oubr + UPT_SC0;
+    if (t->tl_ok && t->tl_stamp == t->tl_gen && t->tl_cnt <= PAGTLB_LOGMAX
+      && t->tl_spb == PAG_PR_SPBPA && t->tl_csb == PAG_PR_CSBPA) {
+	for (i = 0; i < PAGTLB_NSECT; ++i)
+	    if (op10m_camn(vm_pget(vm_physmap(pa + i)), t->tl_sect[i]))
+		break;
+	s = NULL;
+	if (i >= PAGTLB_NSECT) {	/* Find slot: same UPT, free, or LRU */
+	    for (ts = t->tl_set; ts < &t->tl_set[PAGTLB_NSETS]; ++ts) {
+		if (ts->ts_ubr == oubr) {
+		    s = ts;
+		    break;
+		}
+		if (!s || (s->ts_ubr && s->ts_gen == t->tl_gen
+			   && (!ts->ts_ubr || ts->ts_gen != t->tl_gen
+			       || ts->ts_used < s->ts_used)))
+		    s = ts;
+	    }
+	}
+	if (s) {
+	    for (i = n = 0; i < t->tl_cnt && n < PAGTLB_SETMAX; ++i) {
+		v = t->tl_log[i];
+		if (t->tl_info[v].ti_pme
+		  && t->tl_info[v].ti_mfrm != PAGTLB_NOFRM) {
+		    s->ts_ent[n].te_vpag = v;
+		    s->ts_ent[n++].te_i = t->tl_info[v];
+		}
+	    }
+	    s->ts_ubr = n ? oubr : 0;
+	    s->ts_cnt = n;
+	    s->ts_spb = t->tl_spb;
+	    s->ts_csb = t->tl_csb;
+	    s->ts_gen = t->tl_gen;
+	    s->ts_used = ++t->tl_clock;
+	    memcpy((char *)s->ts_sect, (char *)t->tl_sect, sizeof(s->ts_sect));
+	    memcpy((char *)s->ts_dep, (char *)t->tl_dep, sizeof(s->ts_dep));
+	}
+    }
+
+    pag_tlbclr(t);		/* Clear user map */
+    pag_mapclr(cpu.pr_emap);	/* and exec map */
+    pag_tlbstart(t);
+
+    /* Bring back a saved map for the new UPT */
+    for (s = t->tl_set; s < &t->tl_set[PAGTLB_NSETS]; ++s)
+	if (s->ts_ubr == cpu.mr_ubraddr)
+	    break;
+    if (s >= &t->tl_set[PAGTLB_NSETS] || !t->tl_ok
+      || s->ts_gen != t->tl_gen
+      || s->ts_spb != t->tl_spb || s->ts_csb != t->tl_csb
+      || memcmp((char *)s->ts_sect, (char *)t->tl_sect, sizeof(s->ts_sect))) {
+	++t->tl_nmiss;
+	return;
+    }
+    for (i = 0; i < s->ts_cnt; ++i) {
+	v = s->ts_ent[i].te_vpag;
+	t->tl_info[v] = s->ts_ent[i].te_i;	/* Pending until touched */
+	t->tl_log[i] = v;
+    }
+    t->tl_cnt = s->ts_cnt;
+    memcpy((char *)t->tl_dep, (char *)s->ts_dep, sizeof(t->tl_dep));
+    s->ts_used = ++t->tl_clock;
+    ++t->tl_nhit;
+}
+
+/* PAG_TLBWATCH - If frame pg isn't already watched, start watching it
+**	by taking away write access to it in both internal maps.
+*/
+static void
+pag_tlbwatch(register struct pagtlb_s *t,
+	     register pagno_t pg)
+{
+    register pment_t *p;
+    register int i;
+
+    if (pag_tlbbit(t->tl_watch, pg))
+	return;
+    pag_tlbbset(t->tl_watch, pg);
+    ++t->tl_nwatch;
+    for (p = cpu.pr_umap, i = PAG_MAXVIRTPGS; --i >= 0; ++p)
+	if ((*p & (PAG_PAMSK|VMF_WRITE)) == (pg|VMF_WRITE))
+	    *p &= ~VMF_WRITE;
+    for (p = cpu.pr_emap, i = PAG_MAXVIRTPGS; --i >= 0; ++p)
+	if ((*p & (PAG_PAMSK|VMF_WRITE)) == (pg|VMF_WRITE))
+	    *p &= ~VMF_WRITE;
+#if KLH10_CPU_KL
+    if (cpu.mr_abk_pagno != -1
+      && (cpu.mr_abk_pmap[cpu.mr_abk_pagno] & PAG_PAMSK) == pg)
+	cpu.mr_abk_pmflags &= ~VMF_WRITE;
+#endif
+    PCCACHE_RESET();		/* Cached pointers may allow writes */
+}
+
+/* PAG_SCWATCH - Watch frame pg, read by the section part of a walk,
+**	and note it for the section memo; also for the live user map if
+**	tlb is set.
+*/
+static void
+pag_scwatch(register struct pagtlb_s *t,
+	    struct pagtlb_s *tlb,
+	    register pagno_t pg)
+{
+    pag_tlbwatch(t, pg);
+    if (tlb)
+	pag_tlbbset(tlb->tl_dep, pg);
+    if (t->tl_nscfrm >= 0) {
+	if (t->tl_nscfrm < PAGSC_MAXFRM)
+	    t->tl_scfrm[t->tl_nscfrm++] = pg;
+	else
+	    t->tl_nscfrm = -1;		/* Too many, don't memoize */
+    }
+}
+
+/* PAG_TLBDROP - Frame pag, being watched, has been stored into.
+**	Stop watching it and drop every user map and section memo that
+**	was built from it.
+*/
+static void
+pag_tlbdrop(register struct pagtlb_s *t,
+	    register pagno_t pag)
+{
+    register struct pagtlbset *s;
+    register struct pagsc *sc;
+    register int i;
+
+    pag_tlbbclr(t->tl_watch, pag);
+    ++t->tl_nwrite;
+    if (pag_tlbbit(t->tl_dep, pag))
+	t->tl_ok = FALSE;
+    for (s = t->tl_set; s < &t->tl_set[PAGTLB_NSETS]; ++s)
+	if (s->ts_ubr && pag_tlbbit(s->ts_dep, pag)) {
+	    s->ts_ubr = 0;
+	    ++t->tl_nkill;
+	}
+    for (sc = t->tl_sc; sc < &t->tl_sc[PAGSC_N]; ++sc)
+	for (i = 0; i < sc->sc_nfrm; ++i)
+	    if (sc->sc_frm[i] == pag) {
+		sc->sc_nfrm = -1;
+		break;
+	    }
+}
+
+/* PAG_IOWRITE - A device has stored NWDS words into physical memory
+**	starting at PA, without going through the maps.  Any watched
+**	frame in that range is treated as stored into.
+*/
+void
+pag_iowrite(paddr_t pa,
+	    long nwds)
+{
+    register struct pagtlb_s *t = cpu.pr_tlb;
+    register pagno_t pg, lim;
+
+    if (nwds <= 0 || pa >= cpu.pag.pr_physnxm)
+	return;
+    pg = pag_patopg(pa);
+    lim = (pagno_t)((pa + nwds - 1) >> PAG_BITS);
+    if (lim >= PAG_MAXPHYSPGS)
+	lim = PAG_MAXPHYSPGS - 1;
+    for (; pg <= lim; ++pg)
+	if (pag_tlbbit(t->tl_watch, pg))
+	    pag_tlbdrop(t, pg);
+}
+
+/* PAG_TLBSET - Finish a refill of p[vpag] with phys page pag.
+**	A store into a watched frame drops whatever depends on it;
+**	any other access to one leaves the entry without write access.
+**	User map entries are also logged for saving and clearing.
+*/
+static void
+pag_tlbset(register pment_t *p,
+	   pagno_t vpag,
+	   register pagno_t pag,
+	   h10_t acc,
+	   pment_t mfrm,
+	   pment_t f)
+{
+    register struct pagtlb_s *t = cpu.pr_tlb;
+    register struct pagtlbi *ti;
+
+    if ((p[vpag] & VMF_WRITE) && pag_tlbbit(t->tl_watch, pag)) {
+	if (f & VMF_WRITE)
+	    pag_tlbdrop(t, pag);
+	else
+	    p[vpag] &= ~VMF_WRITE;	/* Make stores come back here */
+    }
+
+    if (p == cpu.pr_umap) {
+	ti = &t->tl_info[vpag];
+	if (!ti->ti_pme) {		/* Log it if not already there */
+	    if (t->tl_cnt < PAGTLB_LOGMAX)
+		t->tl_log[t->tl_cnt++] = vpag;
+	    else
+		t->tl_cnt = PAGTLB_LOGMAX+1;	/* Overflow, clear it all */
+	}
+	ti->ti_pme = pag | VMF_READ;
+	ti->ti_mfrm = mfrm;
+	ti->ti_acc = acc & ~CST_MBIT;	/* M must come from CST each time */
+    }
+}
+
+/* PAG_TLBREVAL - Revalidate a pending user map entry by doing the CST
+**	part of a refill for its page map and page.  Returns FALSE if
+**	a full refill is needed, including any case that would fail, so
+**	that the normal code reports it.
+*/
+static int
+pag_tlbreval(pagno_t vpag,
+	     pment_t f,
+	     pagno_t *apag,
+	     h10_t *aacc)
+{
+    register struct pagtlbi *ti = &cpu.pr_tlb->tl_info[vpag];
+    register pagno_t pag = ti->ti_pme & PAG_PAMSK;
+    register h10_t accbits = ti->ti_acc;
+    register w10_t w;
+
+    if (ti->ti_mfrm == PAGTLB_NOFRM)
+	return FALSE;
+    if (PAG_PR_CSBPA) {
+	w = vm_pget(vm_physmap(PAG_PR_CSBPA + ti->ti_mfrm));
+	if ((LHGET(w) & CST_AGE) == 0)
+	    return FALSE;			/* Map age trap */
+	op10m_and(w, PAG_PR_CSTMWD);
+	op10m_ior(w, PAG_PR_PURWD);
+	PAG_CSTSET(PAG_PR_CSBPA + ti->ti_mfrm, w);
+
+	w = vm_pget(vm_physmap(PAG_PR_CSBPA + pag));
+	if ((LHGET(w) & CST_AGE) == 0
+	  || (!(accbits & PT_WACC) && (f & VMF_WRITE)))
+	    return FALSE;			/* Page age trap or W in RO */
+	op10m_and(w, PAG_PR_CSTMWD);
+	op10m_ior(w, PAG_PR_PURWD);
+	if (accbits & PT_WACC) {
+	    if (f & VMF_WRITE)
+		op10m_iori(w, CST_MBIT);
+	    accbits |= RHGET(w) & CST_MBIT;
+	}
+	PAG_CSTSET(PAG_PR_CSBPA + pag, w);
+    } else {
+	if (accbits & PT_WACC)
+	    accbits |= CST_MBIT;
+	else if (f & VMF_WRITE)
+	    return FALSE;
+    }
+    *apag = pag;
+    *aacc = accbits;
+    return TRUE;
+}
+
+/* PAG_TLBSHOW - Show statistics, for the FE "pagtlb" command.
+*/
+void
+pag_tlbshow(FILE *f, int reset)
+{
+    register struct pagtlb_s *t = cpu.pr_tlb;
+    register int i, n = 0;
+    unsigned long tot = t->tl_nhit + t->tl_nmiss;
+
+    for (i = 0; i < PAGTLB_NSETS; ++i)
+	if (t->tl_set[i].ts_ubr && t->tl_set[i].ts_gen == t->tl_gen)
+	    ++n;
+    fprintf(f, "Retained user maps: %d of %d in use\n", n, PAGTLB_NSETS);
+    fprintf(f, "  UBR switches: %lu, %lu kept a map", t->tl_nswitch, t->tl_nhit);
+    if (tot)
+	fprintf(f, " (%.1f%% of lookups)", (100.0 * t->tl_nhit) / tot);
+    fprintf(f, "\n  Entries revalidated: %lu, full user refills: %lu\n",
+		t->tl_nreval, t->tl_nfill);
+    fprintf(f, "  Frames watched: %lu, stores to them: %lu, maps dropped: %lu\n",
+		t->tl_nwatch, t->tl_nwrite, t->tl_nkill);
+    fprintf(f, "  Section walks: %lu from memo, %lu long way\n",
+		t->tl_nschit, t->tl_nscmiss);
+    if (reset)
+	t->tl_nswitch = t->tl_nhit = t->tl_nmiss = t->tl_nreval
+	    = t->tl_nfill = t->tl_nwatch = t->tl_nwrite = t->tl_nkill
+	    = t->tl_nschit = t->tl_nscmiss = 0;
+}
+
+#endif /* KLH10_PAG_TLB */
 
+/* VM_BLKMOVE - Move up to n words from svp to dvp, ascending, with the
+**	same result as moving them one at a time.  Both blocks must lie
+**	within a single page of physical memory (see vm_pagleft).
+**	Returns # of words actually moved, which may be less than n if
+**	the destination overlaps the source from above; the caller just
+**	comes back for the rest.  The common dvp == svp+1 case (propagate
+**	one word, eg to clear a page) is done as a fill.
+*/
+int
+vm_blkmove(register vmptr_t dvp,
+	   register vmptr_t svp,
+	   register int n)
+{
+    if (n > 1 && dvp == svp + 1) {
+	register w10_t w;
+
+	w = vm_pget(svp);
+	if (op10m_skipe(w))
+	    memset((char *)dvp, 0, n * sizeof(*dvp));
+	else {
+	    register int i = n;
+	    do vm_pset(dvp++, w);
+	    while (--i > 0);
+	}
+	return n;
+    }
+    if (svp < dvp && dvp < svp + n)	/* Overlap would ripple */
+	n = dvp - svp;
+    if (n == 1)
+	vm_pset(dvp, vm_pget(svp));
+    else
+	memmove((char *)dvp, (char *)svp, n * sizeof(*dvp));
+    return n;
+}
+
+/* VM_BLKMOVR - Same but descending; svp and dvp point to the highest
+**	word of each block, and the move ends at svp-(n-1).
+*/
+int
+vm_blkmovr(register vmptr_t dvp,
+	   register vmptr_t svp,
+	   register int n)
+{
+    if (n > 1 && dvp == svp - 1) {
+	register w10_t w;
+
+	w = vm_pget(svp);
+	dvp -= n - 1;
+	if (op10m_skipe(w))
+	    memset((char *)dvp, 0, n * sizeof(*dvp));
+	else {
+	    register int i = n;
+	    do vm_pset(dvp++, w);
+	    while (--i > 0);
+	}
+	return n;
+    }
+    if (dvp < svp && svp < dvp + n)	/* Overlap would ripple */
+	n = svp - dvp;
+    if (n == 1)
+	vm_pset(dvp, vm_pget(svp));
+    else
+	memmove((char *)(dvp - (n-1)), (char *)(svp - (n-1)),
+		n * sizeof(*dvp));
+    return n;
+}
+
 /* Common IO instructions that manipulate the paging system */
 
 /* IO_RDEBR (70124 = CONI PAG,) - Read Executive Base Register
@@ -414,6 +1057,9 @@ ioinsdef(io_wrubr)
 
     /* Select new UPT? */
     if (LHGET(w) & UBR_SET) {
+#if KLH10_PAG_TLB
+	paddr_t oubr = cpu.mr_ubraddr;
+#endif
 
 #if KLH10_CPU_KL
 	/* Unless explicitly suppressed, setting a new user base address
@@ -437,7 +1083,11 @@ ioinsdef(io_wrubr)
 	/* Also must reset cache and page table.
 	** KLH10 also resets its PC cache if any.
 	*/
+#if KLH10_PAG_TLB
+	pag_tlbswitch(oubr);	/* Same, but keep old user map */
+#else
 	pag_clear();		/* Or?  pag_mapclr(cpu.pr_umap); */
+#endif
     }
 #if KLH10_DEBUG
     if (cpu.mr_debug) {
@@ -469,6 +1119,10 @@ ioinsdef(io_clrpt)
     PCCACHE_RESET();			/* Invalidate cached PC info */
     cpu.pr_umap[va_page(e)] = 0;	/* Zapo! */
     cpu.pr_emap[va_page(e)] = 0;
+#if KLH10_PAG_TLB
+    cpu.pr_tlb->tl_info[va_page(e)].ti_pme = 0;	/* Don't bring it back */
+    pag_scinv(cpu.pr_tlb, va_page(e));
+#endif
 #if KLH10_CPU_KL
     if (va_page(e) == cpu.mr_abk_pagno)
 	cpu.mr_abk_pmflags = 0;
@@ -1352,6 +2006,7 @@ ioinsdef(io_do_apr)
 	cpu.mr_abk_pmflags = cpu.mr_abk_pmap[cpu.mr_abk_pagno] & VMF_ACC;
 	cpu.mr_abk_pmap[cpu.mr_abk_pagno] &= cpu.mr_abk_pmmask;
     }
+    PCCACHE_RESET();		/* Page access flags changed */
 
     return PCINC_1;
 }
@@ -1660,6 +2315,25 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
     register h10_t accbits = 0;
     register paddr_t paddr;
     register pagno_t pag, pgn;
+#if KLH10_PAG_TLB
+    register struct pagtlb_s *t = cpu.pr_tlb;
+    register struct pagtlb_s *tlb = NULL;	/* Set if user map */
+    pment_t mfrm = PAGTLB_NOFRM;	/* Page map frame, if only one */
+    int nmaps = 0;
+    paddr_t upa;			/* UPT/EPT section pointer addr */
+    int isc;				/* and its section # */
+    struct pagsc *sc = NULL;		/* Section memo to fill in */
+    pagno_t rpag;			/* Revalidated page and access */
+    h10_t racc;
+    register int i;
+# define PAGSC_WATCH(pa) pag_scwatch(t, tlb, pag_patopg(pa))
+# define PAGTLB_WATCH(pa) (tlb ? (pag_tlbbset(tlb->tl_dep, pag_patopg(pa)), \
+				  pag_tlbwatch(tlb, pag_patopg(pa))) : (void)0)
+#else
+# define PAGSC_WATCH(pa)
+# define PAGTLB_WATCH(pa)
+# define PAG_CSTSET(pa, w) vm_pset(vm_physmap(pa), w)
+#endif
 
     accbits = PT_WACC | PT_CACHE /* | PT_PACC */ ;	/* Start with these */
 
@@ -1668,6 +2342,20 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
     */
     if (p == cpu.pr_umap) {	/* Assume user map (most common) - UBR */
 	paddr = cpu.mr_ubraddr + UPT_SC0;
+#if KLH10_PAG_TLB
+	tlb = cpu.pr_tlb;
+	if (vpag < PAG_MAXVIRTPGS && tlb->tl_info[vpag].ti_pme
+	  && pag_tlbreval(vpag, f, &rpag, &racc)) {
+	    pag = rpag;
+	    accbits = racc;
+	    mfrm = tlb->tl_info[vpag].ti_mfrm;
+	    ++tlb->tl_nreval;
+	    goto won;			/* Kept entry still good */
+	}
+	++tlb->tl_nfill;
+	if (tlb->tl_spb != PAG_PR_SPBPA || tlb->tl_csb != PAG_PR_CSBPA)
+	    tlb->tl_ok = FALSE;		/* Bases changed under live map */
+#endif
     } else if (p == cpu.pr_emap) {	/* Else must be exec map - EBR */
 	paddr = cpu.mr_ebraddr + UPT_SC0;
     } else if (p == pr_pmap) {		/* If phys map, trigger NXM */
@@ -1694,6 +2382,10 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 #endif
 	pag = vpag;			/* Get page # for table lookup */
 
+#if KLH10_PAG_TLB
+    upa = paddr;
+    isc = vpag >> (PAG_NABITS-PAG_BITS);
+#endif
     for (;;) {
 	if (paddr >= cpu.pag.pr_physnxm) {
 	    cpu.pag.pr_flh = PMF_NXMERR;
@@ -1702,6 +2394,30 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 	    return NULL;	    /* Fail - NXM fetching section pointer */
 	}
 	w = vm_pget(vm_physmap(paddr));	/* Get section pointer */
+#if KLH10_PAG_TLB
+	if (paddr == upa) {		/* From UPT or EPT */
+	    upa = (paddr_t)-1;		/* Only the first one */
+	    if (tlb && op10m_camn(w, tlb->tl_sect[isc]))
+		tlb->tl_ok = FALSE;	/* Doesn't match live user map */
+	    sc = &t->tl_sc[PAGSC_HASH(w)];
+	    if (sc->sc_nfrm >= 0 && !op10m_camn(w, sc->sc_ptr)
+	      && sc->sc_spb == PAG_PR_SPBPA) {
+		++t->tl_nschit;		/* Walked this one before */
+		accbits &= sc->sc_acc;
+		w = sc->sc_w;
+		if (tlb)
+		    for (i = 0; i < sc->sc_nfrm; ++i)
+			pag_tlbbset(tlb->tl_dep, sc->sc_frm[i]);
+		sc = NULL;		/* Nothing new to remember */
+		break;			/* Have page map pointer */
+	    }
+	    ++t->tl_nscmiss;
+	    sc->sc_nfrm = -1;		/* Start over on this one */
+	    sc->sc_ptr = w;
+	    t->tl_nscfrm = 0;
+	} else
+	    PAGSC_WATCH(paddr);		/* From a section table */
+#endif
 
 	switch (LHGET(w) >> 15) {	/* Find pointer type */
 	default:
@@ -1723,6 +2439,7 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 		cpu.pag.pr_fstr = "NXM for sect SPT ent";
 		return NULL;		    /* Fail - NXM fetching SPT entry */
 	    }
+	    PAGSC_WATCH(paddr);
 	    w = vm_pget(vm_physmap(paddr));	/* Get SPT entry */
 	    break;				/* Won, have page addr */
 
@@ -1740,6 +2457,7 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 		cpu.pag.pr_fstr = "NXM for @ sect SPT ent";
 		return NULL;		    /* Fail - NXM fetching SPT entry */
 	    }
+	    PAGSC_WATCH(paddr);
 	    w = vm_pget(vm_physmap(paddr));	/* Get SPT entry */
 	    if (LHGET(w) & SPT_MDM) {
 		cpu.pag.pr_flh = PMF_OTHERR;
@@ -1752,6 +2470,17 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 	break;		/* Break from switch is break from loop */
     }
 
+#if KLH10_PAG_TLB
+    if (sc && t->tl_nscfrm >= 0) {	/* Remember walk for next time */
+	sc->sc_w = w;
+	sc->sc_acc = accbits;
+	sc->sc_spb = PAG_PR_SPBPA;
+	for (i = 0; i < t->tl_nscfrm; ++i)
+	    sc->sc_frm[i] = t->tl_scfrm[i];
+	sc->sc_nfrm = t->tl_nscfrm;
+    }
+#endif
+
     /* Now have the page address of the page map to use!
     ** w contains the final pointer word.
     ** pag is the page # to look up in the page map.
@@ -1782,11 +2511,15 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 	    }
 	    op10m_and(w, PAG_PR_CSTMWD);		/* AND it with CSTM */
 	    op10m_ior(w, PAG_PR_PURWD);			/* IOR with PUR */
-	    vm_pset(vm_physmap(PAG_PR_CSBPA+pgn), w);	/* Store back in CST */
+	    PAG_CSTSET(PAG_PR_CSBPA+pgn, w);		/* Store back in CST */
 	}
 
 	/* OK, now pluck out page map entry */
 	paddr = pag_pgtopa(pgn) + pag;
+#if KLH10_PAG_TLB
+	PAGTLB_WATCH(paddr);
+	mfrm = (nmaps++ ? PAGTLB_NOFRM : (pment_t)pgn);
+#endif
 	w = vm_pget(vm_physmap(paddr));		/* Get page map entry */
 
 	/* Handle map pointer */
@@ -1810,6 +2543,7 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 		cpu.pag.pr_fstr = "NXM for page SPT ent";
 		return NULL;		/* Fail - NXM fetching SPT entry */
 	    }
+	    PAGTLB_WATCH(paddr);
 	    w = vm_pget(vm_physmap(paddr));	/* Get SPT entry */
 	    break;			/* Won, drop out with page addr */
 
@@ -1825,6 +2559,7 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 		cpu.pag.pr_fstr = "NXM for @ page SPT ent";
 		return NULL;		/* Fail - NXM fetching SPT entry */
 	    }
+	    PAGTLB_WATCH(paddr);
 	    w = vm_pget(vm_physmap(paddr));	/* Get SPT entry */
 	    continue;				/* Loop to handle it */
 	}
@@ -1873,7 +2608,7 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 	    cpu.pag.pr_fstr = "W in RO Page";
 	    return NULL;			/* Fail, page not writable */
 	}
-	vm_pset(vm_physmap(PAG_PR_CSBPA+pag), w);	/* Store back in CST */
+	PAG_CSTSET(PAG_PR_CSBPA+pag, w);		/* Store back in CST */
 
     } else {
 	/* CST doesn't exist (this can happen for TOPS-10 using T20 paging).
@@ -1897,6 +2632,9 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
 	    return NULL;			/* Fail, page not writable */
 	}
     }
+#if KLH10_PAG_TLB
+ won:
+#endif
     cpu.pag.pr_flh = accbits;		/* Remember bits in case MAP */
 
     /* Won completely, update internal page map!
@@ -1908,6 +2646,9 @@ pag_t20map(register pment_t *p,	/* Page map pointer */
     */
     p[vpag] = pag | VMF_READ
 		 | ((accbits & CST_MBIT) ? VMF_WRITE : 0);
+#if KLH10_PAG_TLB
+    pag_tlbset(p, vpag, pag, accbits, mfrm, f);
+#endif
 
 #if KLH10_CPU_KL
     /* If page vpag contains the address break address, clear its
@@ -369,12 +369,20 @@ extern w10_t ea_wcalc(w10_t, acptr_t, pment_t *);
 #define va_xeabpcalc(va,iw,s) \
 	((va) = xea_mxcalc(iw, s, cpu.acblk.xbea, cpu.vmap.xbea))
 
+/* In section 0 every indirect word is an IFIW, so an indirect chain
+** there can use the plain non-extended routine.  X without I in a
+** non-zero section only needs the global-index check, not the full loop.
+*/
 #define xea_mxcalc(iw, s, acp, m) \
   (op10m_tlnn(iw, IW_I|IW_X) \
-     ? ((op10m_tlnn(iw,IW_I) || (s)) \
-	? xea_xcalc(iw, (unsigned)s, acp, m)	/* I, or X in NZ S, use fn */\
-	: va_Vmake(VAF_LOCAL, s, H10MASK &	/* Has X only, add in */\
-			(RHGET(iw) + ac_xgetrh(iw_x(iw),acp))))		\
+     ? ((s) \
+	? (op10m_tlnn(iw,IW_I)						\
+	    ? xea_xcalc(iw, (unsigned)s, acp, m) /* I in NZ S, use fn */\
+	    : xea_ixcalc(iw, (unsigned)s, acp))	 /* X only in NZ S */	\
+	: (op10m_tlnn(iw,IW_I)						\
+	    ? ea_fncalc(iw, acp, m)		/* I in S 0, IFIWs only */\
+	    : va_Vmake(VAF_LOCAL, 0, H10MASK &	/* Has X only, add in */\
+			(RHGET(iw) + ac_xgetrh(iw_x(iw),acp)))))	\
      : va_Vmake(VAF_LOCAL, s, RHGET(iw)))	/* Simple case, no I or X */
 
 /* Extended EA calc if starting with EFIW */
@@ -389,6 +397,8 @@ extern w10_t ea_wcalc(w10_t, acptr_t, pment_t *);
 
 	/* Normal full EA calculation, extended */
 extern vaddr_t xea_xcalc(w10_t, unsigned, acptr_t, pment_t *);
+	/* EA calc for X but no I, in NZ section */
+extern vaddr_t xea_ixcalc(w10_t, unsigned, acptr_t);
 	/* Special EA calc for PXCT */
 extern vaddr_t xea_pxctcalc(w10_t, unsigned, acptr_t, pment_t *, int, int);
 	/* Special for byte ptr EFIWS */
@@ -551,6 +561,19 @@ struct vmregs {
 #define vm_xbeamap(v,f) vm_xmap(v,f,cpu.acblk.xbea,cpu.vmap.xbea)
 #define vm_xbrwmap(v,f) vm_xmap(v,f,cpu.acblk.xbrw,cpu.vmap.xbrw)
 
+/* VM_PAGLEFT - # words from va to the end of its page, for bulk BLT/XBLT.
+**	Returns 1 if the word must be done by itself: an AC reference, or
+**	(KL) on the address break page, where each reference is checked.
+*/
+#if KLH10_CPU_KL
+# define vm_pagleft(va) ((va_insect(va) <= AC_17		\
+			  || va_page(va) == cpu.mr_abk_pagno)	\
+			 ? 1 : (int)(PAG_SIZE - va_pagoff(va)))
+#else
+# define vm_pagleft(va) (va_insect(va) <= AC_17			\
+			 ? 1 : (int)(PAG_SIZE - va_pagoff(va)))
+#endif
+
 #define vm_execmap(v,f)	vm_xmap(v,f,cpu.acs.ac,cpu.vmap.exec)
 #define vm_usermap(v,f)	vm_xmap(v,f,cpu.acs.ac,cpu.vmap.user)
 #define vm_physmap(a) (&cpu.physmem[(a)])	/* Physical address mapping */
@@ -969,6 +992,21 @@ extern vmptr_t pag_refill(pment_t *, vaddr_t, pment_t);
 
 extern void pag_fail(void);	/* Effect page-fail trap */
 
+#if KLH10_CKPT
+extern void pag_ckprest(void);	/* Rebuild pager after checkpoint restore */
+#endif
+
+	/* Bulk word moves within a page, as if done one word at a time */
+extern int vm_blkmove(vmptr_t, vmptr_t, int);	/* Ascending */
+extern int vm_blkmovr(vmptr_t, vmptr_t, int);	/* Descending */
+
+#if KLH10_PAG_TLB		/* Device stored into phys memory */
+extern void pag_iowrite(paddr_t, long);
+# define PAG_IOWRITE(pa, n) pag_iowrite(pa, n)
+#else
+# define PAG_IOWRITE(pa, n) ((void)0)
+#endif
+
 #if KLH10_CPU_KS
 extern void pag_iofail(paddr_t, int);	/* PF trap for IO unibus ref */
 #endif
@@ -0,0 +1,530 @@
+/* KN10PRF.C - KLH10 guest PC sampling profiler
+*/
+/*  Copyright 2026 The KLH10 contributors
+**  All Rights Reserved
+**
+**  This file is part of the KLH10 Distribution.  Use, modification, and
+**  re-distribution is permitted subject to the terms in the file
+**  named "LICENSE", which contains the full text of the legal notices
+**  and should always accompany this Distribution.
+**
+**  This software is provided "AS IS" with NO WARRANTY OF ANY KIND.
+**
+**  This notice (including the copyright and warranty disclaimer)
+**  must be included in all copies or derivations of this software.
+*/
+
+/*
+	The PC sampler hangs a permanent ITICK callout on the internal
+clock (see kn10clk.c).  Each interval tick, from the CPU's synchronous
+clock check, it notes the PC about to be executed together with the
+processor mode, and bumps a counter for the 16-word bucket containing it.
+Nothing is done to the guest's own timers or to the clock queues beyond
+adding one itick entry, so guest timekeeping is unchanged; the only cost
+while sampling is one hash probe per tick.
+
+	Buckets live in a fixed-size open hash table, so the sampler never
+allocates.  If the table fills up, further samples for new buckets are
+counted as "lost".  Page totals and per-symbol totals are derived from
+the buckets at report time.
+
+	Symbols may be loaded separately for exec and user mode from a
+text file.  Each line is expected to hold a symbol name and an octal
+value in either order, as found in a MACRO or LINK symbol map or a DDT
+symbol listing; anything else on the line is ignored, as are lines
+lacking either.  A value may be written as <lh>,,<rh>.  A sample is
+attributed to the closest symbol at or below it in the same section.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "klh10.h"
+#include "kn10def.h"	/* This includes kn10clk.h */
+#include "kn10prf.h"
+
+#if KLH10_PCPROF	/* Moby conditional for entire file */
+
+#define PCP_HBITS 14			/* Log2 of hash table size */
+#define PCP_HSIZE (1<<PCP_HBITS)
+#define PCP_HMAX ((PCP_HSIZE/4)*3)	/* Stop adding when this full */
+
+#define PCP_MODSHF (30-PCP_BKTSHF)	/* Mode bit position in key */
+#define PCP_BKTMSK ((((uint32)1)<<PCP_MODSHF)-1)
+
+/* A bucket key is 1 + <mode,,bucket #> so that 0 means "unused".
+** Aggregated entries (pages, symbols) use their own key encoding
+** and are never stored in the hash table.
+*/
+#define PCP_KEY(m, va) \
+	((((uint32)(m) << PCP_MODSHF) | ((uint32)(va) >> PCP_BKTSHF)) + 1)
+#define PCP_KMODE(k) ((int)(((k)-1) >> PCP_MODSHF))
+#define PCP_KADDR(k) ((((k)-1) & PCP_BKTMSK) << PCP_BKTSHF)
+
+#define PCP_AGMODE(k) ((int)((k) >> 31))	/* Aggregate key fields */
+#define PCP_AGPAGE (((uint32)1)<<30)		/* Flags page, not symbol */
+#define PCP_AGVAL(k) ((k) & (PCP_AGPAGE-1))
+
+struct pcpent {
+    uint32 pe_key;
+    unsigned long pe_cnt;
+};
+
+struct pcpsym {
+    uint32 ps_val;
+    char *ps_name;
+};
+
+static struct pcpent *pcp_tab;		/* Bucket hash table */
+static int pcp_nent;			/* # buckets in use */
+static unsigned long pcp_nsamp;		/* Total samples taken */
+static unsigned long pcp_lost;		/* Samples dropped, table full */
+static struct clkent *pcp_tmr;		/* Our itick callout, if on */
+
+static struct pcpsym *pcp_sym[2];	/* Symbol tables, by mode */
+static int pcp_nsym[2];
+
+static char *pcp_mstr[2] = { "exec", "user" };
+
+/* Itick callout - take one sample.
+*/
+static void
+pcp_sample(void *arg)
+{
+    register uint32 k = PCP_KEY(cpu.mr_usrmode ? PCP_USER : PCP_EXEC, PC_30);
+    register unsigned h;
+
+    ++pcp_nsamp;
+    h = (unsigned)(((k * (uint32)0x9E3779B1) & 0xFFFFFFFF)
+			>> (32 - PCP_HBITS));
+    for (;;) {
+	if (pcp_tab[h].pe_key == k) {
+	    ++pcp_tab[h].pe_cnt;
+	    return;
+	}
+	if (!pcp_tab[h].pe_key)
+	    break;
+	h = (h + 1) & (PCP_HSIZE-1);
+    }
+    if (pcp_nent >= PCP_HMAX) {
+	++pcp_lost;
+	return;
+    }
+    ++pcp_nent;
+    pcp_tab[h].pe_key = k;
+    pcp_tab[h].pe_cnt = 1;
+}
+
+int
+pcp_on(void)
+{
+    if (!pcp_tab) {
+	pcp_tab = (struct pcpent *)calloc(PCP_HSIZE, sizeof(struct pcpent));
+	if (!pcp_tab)
+	    return FALSE;
+    }
+    if (!pcp_tmr)
+	pcp_tmr = clk_itmrget(pcp_sample, (void *)NULL);
+    return pcp_tmr != NULL;
+}
+
+void
+pcp_off(void)
+{
+    if (pcp_tmr) {
+	clk_tmrkill(pcp_tmr);
+	pcp_tmr = NULL;
+    }
+}
+
+int
+pcp_ison(void)
+{
+    return pcp_tmr != NULL;
+}
+
+void
+pcp_reset(void)
+{
+    if (pcp_tab)
+	memset((char *)pcp_tab, 0, PCP_HSIZE * sizeof(struct pcpent));
+    pcp_nent = 0;
+    pcp_nsamp = pcp_lost = 0;
+}
+
+/* Symbol table support */
+
+static int
+pcp_symcmp(const void *a, const void *b)
+{
+    register uint32 va = ((const struct pcpsym *)a)->ps_val;
+    register uint32 vb = ((const struct pcpsym *)b)->ps_val;
+
+    return (va < vb) ? -1 : ((va > vb) ? 1 : 0);
+}
+
+/* Parse octal value, either plain or <lh>,,<rh>.
+*/
+static int
+pcp_octval(register char *s, uint32 *vp)
+{
+    register uint32 v = 0, lh = 0;
+    int n = 0;
+
+    for (;; ++s) {
+	if (*s >= '0' && *s <= '7') {
+	    v = (v << 3) | (*s - '0');
+	    ++n;
+	} else if (s[0] == ',' && s[1] == ',' && n && !lh) {
+	    lh = v | ((uint32)1 << 31);	/* Remember we saw one */
+	    v = 0;
+	    n = 0;
+	    ++s;
+	} else
+	    break;
+    }
+    if (*s || !n)
+	return FALSE;
+    if (lh)
+	v = ((lh & 07777) << 18) | (v & 0777777);
+    *vp = v & 07777777777;
+    return TRUE;
+}
+
+static void
+pcp_symfree(int mode)
+{
+    register int i;
+
+    for (i = 0; i < pcp_nsym[mode]; ++i)
+	free(pcp_sym[mode][i].ps_name);
+    free((char *)pcp_sym[mode]);
+    pcp_sym[mode] = NULL;
+    pcp_nsym[mode] = 0;
+}
+
+/* Load symbols for the given mode, replacing any already there.
+**	Returns # of symbols loaded, or -1 if the file cannot be read.
+*/
+int
+pcp_symload(char *file, int mode)
+{
+    FILE *f;
+    char line[512];
+    struct pcpsym *tab = NULL;
+    int n = 0, max = 0;
+
+    if (!(f = fopen(file, "r")))
+	return -1;
+    while (fgets(line, sizeof(line), f)) {
+	register char *cp, *tok;
+	char *name = NULL;
+	uint32 val = 0;
+	int haveval = FALSE;
+
+	for (cp = line; *cp; ) {
+	    while (*cp && (isspace(*cp) || *cp == '=' || *cp == ':'))
+		++cp;
+	    if (!*cp)
+		break;
+	    tok = cp;
+	    while (*cp && !isspace(*cp) && *cp != '=' && *cp != ':')
+		++cp;
+	    if (*cp)
+		*cp++ = '\0';
+	    if (isdigit(*tok)) {
+		if (!haveval)
+		    haveval = pcp_octval(tok, &val);
+	    } else if (!name)
+		name = tok;
+	    if (name && haveval)
+		break;
+	}
+	if (!name || !haveval)
+	    continue;
+	if (n >= max) {
+	    struct pcpsym *nt;
+
+	    max = max ? max * 2 : 1024;
+	    nt = (struct pcpsym *)realloc((char *)tab,
+					  max * sizeof(struct pcpsym));
+	    if (!nt)
+		break;
+	    tab = nt;
+	}
+	if (!(tab[n].ps_name = malloc(strlen(name)+1)))
+	    break;
+	strcpy(tab[n].ps_name, name);
+	tab[n++].ps_val = val;
+    }
+    fclose(f);
+
+    if (n)
+	qsort((void *)tab, (size_t)n, sizeof(struct pcpsym), pcp_symcmp);
+    pcp_symfree(mode);
+    pcp_sym[mode] = tab;
+    pcp_nsym[mode] = n;
+    return n;
+}
+
+/* Find closest symbol at or below addr in the same section.
+**	Returns index, or -1 if none.
+*/
+static int
+pcp_symfind(int mode, uint32 addr)
+{
+    register struct pcpsym *tab = pcp_sym[mode];
+    register int lo = 0, hi = pcp_nsym[mode] - 1, mid;
+
+    if (hi < 0 || tab[0].ps_val > addr)
+	return -1;
+    while (lo < hi) {			/* Find last val <= addr */
+	mid = (lo + hi + 1) / 2;
+	if (tab[mid].ps_val <= addr)
+	    lo = mid;
+	else
+	    hi = mid - 1;
+    }
+    if ((tab[lo].ps_val >> 18) != (addr >> 18))
+	return -1;
+    return lo;
+}
+
+/* Report support */
+
+static int
+pcp_cntcmp(const void *a, const void *b)
+{
+    register unsigned long ca = ((const struct pcpent *)a)->pe_cnt;
+    register unsigned long cb = ((const struct pcpent *)b)->pe_cnt;
+
+    return (ca < cb) ? 1 : ((ca > cb) ? -1 : 0);
+}
+
+static int
+pcp_keycmp(const void *a, const void *b)
+{
+    register uint32 ka = ((const struct pcpent *)a)->pe_key;
+    register uint32 kb = ((const struct pcpent *)b)->pe_key;
+
+    return (ka < kb) ? -1 : ((ka > kb) ? 1 : 0);
+}
+
+/* Return a copy of all buckets in use, sorted by key (mode, address).
+*/
+static struct pcpent *
+pcp_collect(int *np)
+{
+    register struct pcpent *ents;
+    register int i, n = 0;
+
+    *np = 0;
+    if (!pcp_tab || !pcp_nent)
+	return NULL;
+    if (!(ents = (struct pcpent *)malloc(pcp_nent * sizeof(struct pcpent))))
+	return NULL;
+    for (i = 0; i < PCP_HSIZE; ++i)
+	if (pcp_tab[i].pe_key)
+	    ents[n++] = pcp_tab[i];
+    qsort((void *)ents, (size_t)n, sizeof(struct pcpent), pcp_keycmp);
+    *np = n;
+    return ents;
+}
+
+/* Aggregate keys, for page or symbol totals */
+
+static uint32
+pcp_pagkey(uint32 k)
+{
+    return ((uint32)PCP_KMODE(k) << 31) | PCP_AGPAGE
+		| (PCP_KADDR(k) >> PCP_PAGSHF);
+}
+
+static uint32
+pcp_symkey(uint32 k)
+{
+    int i = pcp_symfind(PCP_KMODE(k), PCP_KADDR(k));
+
+    if (i < 0)
+	return pcp_pagkey(k);
+    return ((uint32)PCP_KMODE(k) << 31) | (uint32)i;
+}
+
+/* Merge runs of buckets that map to the same aggregate key.
+**	Since buckets are sorted by address and symbols by value, all
+**	buckets belonging to one page or symbol are adjacent.
+*/
+static struct pcpent *
+pcp_aggr(struct pcpent *ents, int n, uint32 (*keyf)(uint32), int *np)
+{
+    register struct pcpent *agg;
+    register int i, m = 0;
+    register uint32 k;
+
+    *np = 0;
+    if (!n || !(agg = (struct pcpent *)malloc(n * sizeof(struct pcpent))))
+	return NULL;
+    for (i = 0; i < n; ++i) {
+	k = (*keyf)(ents[i].pe_key);
+	if (m && agg[m-1].pe_key == k)
+	    agg[m-1].pe_cnt += ents[i].pe_cnt;
+	else {
+	    agg[m].pe_key = k;
+	    agg[m++].pe_cnt = ents[i].pe_cnt;
+	}
+    }
+    *np = m;
+    return agg;
+}
+
+static char *
+pcp_addrstr(char *buf, uint32 addr)
+{
+    if (addr >> 18)
+	sprintf(buf, "%lo,,%06lo", (long)(addr >> 18), (long)(addr & 0777777));
+    else
+	sprintf(buf, "%06lo", (long)addr);
+    return buf;
+}
+
+/* Describe bucket location as <sym>+<offset>, or address if no symbol.
+*/
+static char *
+pcp_locstr(char *buf, int mode, uint32 addr)
+{
+    int i = pcp_symfind(mode, addr);
+
+    if (i < 0)
+	return pcp_addrstr(buf, addr);
+    if (addr == pcp_sym[mode][i].ps_val)
+	sprintf(buf, "%.64s", pcp_sym[mode][i].ps_name);
+    else
+	sprintf(buf, "%.64s+%lo", pcp_sym[mode][i].ps_name,
+		(long)(addr - pcp_sym[mode][i].ps_val));
+    return buf;
+}
+
+/* Describe aggregate, as symbol name or page.
+*/
+static char *
+pcp_aggstr(char *buf, uint32 k)
+{
+    if (k & PCP_AGPAGE) {
+	uint32 pag = PCP_AGVAL(k);
+	sprintf(buf, "pg%lo,,%03lo", (long)(pag >> (18-PCP_PAGSHF)),
+		(long)(pag & ((1<<(18-PCP_PAGSHF))-1)));
+    } else
+	sprintf(buf, "%.64s", pcp_sym[PCP_AGMODE(k)][PCP_AGVAL(k)].ps_name);
+    return buf;
+}
+
+static void
+pcp_showagg(FILE *f, char *typ, struct pcpent *agg, int n, int max)
+{
+    register int i;
+    char buf[80];
+
+    qsort((void *)agg, (size_t)n, sizeof(struct pcpent), pcp_cntcmp);
+    fprintf(f, "%10s %6s %-4s  %s\n", "Count", "%", "Mode", typ);
+    for (i = 0; i < n && i < max; ++i)
+	fprintf(f, "%10lu %6.2f %-4s  %s\n", agg[i].pe_cnt,
+		(agg[i].pe_cnt * 100.0) / pcp_nsamp,
+		pcp_mstr[PCP_AGMODE(agg[i].pe_key)],
+		pcp_aggstr(buf, agg[i].pe_key));
+}
+
+/* Show summary with top <max> buckets, pages, and symbols.
+*/
+void
+pcp_show(FILE *f, int max)
+{
+    struct pcpent *ents, *agg;
+    int n, m;
+    register int i;
+    char buf[80], abuf[20];
+
+    fprintf(f, "PC sampling is %s; %lu samples in %d buckets",
+	    pcp_tmr ? "on" : "off", pcp_nsamp, pcp_nent);
+    if (pcp_lost)
+	fprintf(f, ", %lu lost", pcp_lost);
+    fprintf(f, "; symbols: %d exec, %d user\n",
+	    pcp_nsym[PCP_EXEC], pcp_nsym[PCP_USER]);
+    if (!(ents = pcp_collect(&n)))
+	return;
+
+    if ((agg = pcp_aggr(ents, n, pcp_symkey, &m))) {
+	if (pcp_nsym[PCP_EXEC] || pcp_nsym[PCP_USER])
+	    pcp_showagg(f, "Symbol", agg, m, max);
+	free((char *)agg);
+    }
+    if ((agg = pcp_aggr(ents, n, pcp_pagkey, &m))) {
+	pcp_showagg(f, "Page", agg, m, max);
+	free((char *)agg);
+    }
+
+    qsort((void *)ents, (size_t)n, sizeof(struct pcpent), pcp_cntcmp);
+    fprintf(f, "%10s %6s %-4s  %-14s %s\n",
+	    "Count", "%", "Mode", "Bucket", "Location");
+    for (i = 0; i < n && i < max; ++i) {
+	register uint32 k = ents[i].pe_key;
+	fprintf(f, "%10lu %6.2f %-4s  %-14s %s\n", ents[i].pe_cnt,
+		(ents[i].pe_cnt * 100.0) / pcp_nsamp,
+		pcp_mstr[PCP_KMODE(k)],
+		pcp_addrstr(abuf, PCP_KADDR(k)),
+		pcp_locstr(buf, PCP_KMODE(k), PCP_KADDR(k)));
+    }
+    free((char *)ents);
+}
+
+/* Flat output: one line per bucket in address order, tab-separated:
+**	<mode> <octal bucket address> <count> <location>
+*/
+void
+pcp_flat(FILE *f)
+{
+    struct pcpent *ents;
+    int n;
+    register int i;
+    char buf[80];
+
+    if (!(ents = pcp_collect(&n)))
+	return;
+    for (i = 0; i < n; ++i) {
+	register uint32 k = ents[i].pe_key;
+	fprintf(f, "%s\t%lo\t%lu\t%s\n", pcp_mstr[PCP_KMODE(k)],
+		(long)PCP_KADDR(k), ents[i].pe_cnt,
+		pcp_locstr(buf, PCP_KMODE(k), PCP_KADDR(k)));
+    }
+    free((char *)ents);
+}
+
+/* Folded output, as used by flame graph tools.  There are no call
+** stacks, so each "stack" is just <mode>;<section>;<symbol or page>.
+*/
+void
+pcp_folded(FILE *f)
+{
+    struct pcpent *ents, *agg;
+    int n, m;
+    register int i;
+    char buf[80];
+
+    if (!(ents = pcp_collect(&n)))
+	return;
+    if ((agg = pcp_aggr(ents, n, pcp_symkey, &m))) {
+	for (i = 0; i < m; ++i) {
+	    register uint32 k = agg[i].pe_key;
+	    register uint32 sect = (k & PCP_AGPAGE)
+		? (PCP_AGVAL(k) >> (18-PCP_PAGSHF))
+		: (pcp_sym[PCP_AGMODE(k)][PCP_AGVAL(k)].ps_val >> 18);
+	    fprintf(f, "%s;s%lo;%s %lu\n", pcp_mstr[PCP_AGMODE(k)],
+		    (long)sect, pcp_aggstr(buf, k), agg[i].pe_cnt);
+	}
+	free((char *)agg);
+    }
+    free((char *)ents);
+}
+
+#endif /* KLH10_PCPROF */
@@ -0,0 +1,38 @@
+/* KN10PRF.H - KLH10 guest PC sampling profiler definitions
+*/
+/*  Copyright 2026 The KLH10 contributors
+**  All Rights Reserved
+**
+**  This file is part of the KLH10 Distribution.  Use, modification, and
+**  re-distribution is permitted subject to the terms in the file
+**  named "LICENSE", which contains the full text of the legal notices
+**  and should always accompany this Distribution.
+**
+**  This software is provided "AS IS" with NO WARRANTY OF ANY KIND.
+**
+**  This notice (including the copyright and warranty disclaimer)
+**  must be included in all copies or derivations of this software.
+*/
+
+#ifndef KN10PRF_INCLUDED
+#define KN10PRF_INCLUDED 1
+
+#if KLH10_PCPROF
+
+#define PCP_BKTSHF 4	/* Log2 of words per sample bucket (16) */
+#define PCP_PAGSHF 9	/* Log2 of words per page, for page totals */
+
+#define PCP_EXEC 0	/* Mode indices, also for symbol tables */
+#define PCP_USER 1
+
+extern int  pcp_on(void);		/* Start sampling */
+extern void pcp_off(void);		/* Stop sampling, keep samples */
+extern int  pcp_ison(void);
+extern void pcp_reset(void);		/* Flush all samples */
+extern int  pcp_symload(char *, int);	/* Load symbols for a mode */
+extern void pcp_show(FILE *, int);	/* Top buckets & pages */
+extern void pcp_flat(FILE *);		/* All buckets, one per line */
+extern void pcp_folded(FILE *);		/* Folded-stack format */
+
+#endif /* KLH10_PCPROF */
+#endif /* ifndef KN10PRF_INCLUDED */
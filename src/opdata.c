@@ -35,6 +35,10 @@
  RCSID(opdata_c,"$Id: opdata.c,v 2.3 2001/11/10 21:28:59 klh Exp $")
 #endif
 
+#if KLH10_MULTI
+KLH10_TLS struct machstate *kn10_cpu = &kn10_mach0;	/* See kn10def.h */
+#endif
+
 /* Initialize master table at compile time.
 **	op_init() uses this data to fill out all other tables at runtime.
 */
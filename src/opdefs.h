@@ -254,9 +254,28 @@ extern int op_init(void);	/* Function to initialize runtime tables */
        OPCODS_RCSID
 #endif
 
-/* Macro for invoking normal instruction */
-#define op_xct(op, ac, e) \
+/* Macros for invoking normal and EXTEND instructions.
+**	With KLH10_OPPROF, these go through the profiling versions
+**	whenever it's turned on (cpu.mr_opprof).
+*/
+#if KLH10_OPPROF
+# define op_xct(op, ac, e) \
+	(cpu.mr_opprof ? op_pfxct((int)(op), (int)(ac), (vaddr_t)(e)) \
+	: (*cpu.opdisp[(int)(op)])((int)(op), (int)(ac), (vaddr_t)(e)))
+# define opx_xct(xop, ac, e0, e1) \
+	(cpu.mr_opprof \
+	? opx_pfxct((int)(xop), (int)(ac), (vaddr_t)(e0), (vaddr_t)(e1)) \
+	: (*opcxrtn[(int)(xop)])((int)(xop), (int)(ac), \
+				(vaddr_t)(e0), (vaddr_t)(e1)))
+extern pcinc_t op_pfxct(int, int, vaddr_t);
+extern pcinc_t opx_pfxct(int, int, vaddr_t, vaddr_t);
+#else
+# define op_xct(op, ac, e) \
 	(*cpu.opdisp[(int)(op)])((int)(op), (int)(ac), (vaddr_t)(e))
+# define opx_xct(xop, ac, e0, e1) \
+	(*opcxrtn[(int)(xop)])((int)(xop), (int)(ac), \
+				(vaddr_t)(e0), (vaddr_t)(e1))
+#endif
 
 /* Instruction word format defs - here for now */
 
@@ -1213,6 +1213,394 @@ os_v2rt_idle(ossighandler_t *hdlarg)
 #endif
 }
 
+#if KLH10_CLK_TIMERFD
+
+/* Interval timer from a timerfd thread.
+**	Instead of a SIGALRM/SIGVTALRM handler, a thread of its own blocks
+** reading a CLOCK_MONOTONIC timerfd and invokes the callout on each
+** expiration; each machine (callout arg) has its own timerfd and
+** thread.  The callout runs in that thread, so it may only do what
+** a signal handler could (set interrupt flags).  Nothing is delivered
+** to the main thread, so system calls there are never interrupted by
+** the clock.  Expirations missed because the thread didn't get to run
+** are counted as overruns and not made up; the clock is real-time, not
+** virtual, so the PDP-10 sees time passing while the host is busy.
+*/
+#if !(HAVE_PTHREAD_H && HAVE_SYS_TIMERFD_H)
+# error "KLH10_CLK_TIMERFD needs <pthread.h> and <sys/timerfd.h>"
+#endif
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/timerfd.h>
+
+#ifndef OSTFD_MAX		/* Max # of timers, one per machine */
+# define OSTFD_MAX (KLH10_MULTI ? 8 : 1)
+#endif
+
+static struct ostfd {
+    int tf_used;		/* TRUE once slot is taken */
+    int tf_fd;			/* timerfd */
+    void (*tf_rtn)(void *);	/* Callout and its arg, which also */
+    void *tf_arg;		/*	identifies the timer */
+    uint32 tf_usec;		/* Interval, 0 if disarmed */
+    volatile unsigned long tf_nticks;	/* # callouts made, total */
+    volatile unsigned long tf_nover;	/* # expirations missed */
+    volatile long tf_maxlate;	/* Max usec late for a callout */
+} ostfd[OSTFD_MAX];
+static pthread_mutex_t ostfdlock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *
+os_tfdloop(void *arg)
+{
+    register struct ostfd *tf = (struct ostfd *)arg;
+    uint64_t n;
+    struct itimerspec its;
+    long late;
+
+    for (;;) {
+	if (read(tf->tf_fd, (char *)&n, sizeof(n)) != sizeof(n)) {
+	    if (errno == EINTR || errno == EAGAIN)
+		continue;
+	    panic("os_tfdloop: timerfd read failed - %s", os_strerror(errno));
+	}
+
+	/* See how long ago the last expiration was */
+	if (timerfd_gettime(tf->tf_fd, &its) == 0
+	  && (its.it_interval.tv_sec || its.it_interval.tv_nsec)) {
+	    late = ((long)(its.it_interval.tv_sec - its.it_value.tv_sec)
+			* 1000000L)
+		+ ((its.it_interval.tv_nsec - its.it_value.tv_nsec) / 1000L);
+	    if (late > tf->tf_maxlate)
+		tf->tf_maxlate = late;
+	}
+
+	if (tf->tf_rtn) {
+	    (*tf->tf_rtn)(tf->tf_arg);
+	    ++tf->tf_nticks;
+	    tf->tf_nover += (unsigned long)n - 1;
+	}
+    }
+    return NULL;
+}
+
+/* OS_TFDFIND - Find the timer for arg, or NULL if it has none.
+*/
+static struct ostfd *
+os_tfdfind(void *arg)
+{
+    register struct ostfd *tf;
+
+    for (tf = ostfd; tf < &ostfd[OSTFD_MAX]; ++tf)
+	if (tf->tf_used && tf->tf_arg == arg)
+	    return tf;
+    return NULL;
+}
+
+/* OS_TFDTIMER - Set timer to invoke rtn(arg) every "usecs" microseconds.
+**	A zero interval disarms it.  Each different arg (each machine) gets
+**	its own timer and thread, started on first use with all signals
+**	blocked so they keep going to the main thread.
+*/
+void
+os_tfdtimer(void (*rtn)(void *), void *arg, uint32 usecs)
+{
+    register struct ostfd *tf;
+    struct itimerspec its;
+    pthread_t thr;
+    sigset_t allmsk, oldmsk;
+    int err;
+
+    pthread_mutex_lock(&ostfdlock);
+    if (!(tf = os_tfdfind(arg))) {
+	for (tf = ostfd; tf < &ostfd[OSTFD_MAX]; ++tf)
+	    if (!tf->tf_used)
+		break;
+	if (tf >= &ostfd[OSTFD_MAX])
+	    panic("os_tfdtimer: out of timers");
+	if ((tf->tf_fd = timerfd_create(CLOCK_MONOTONIC, 0)) < 0)
+	    panic("os_tfdtimer: timerfd_create failed - %s",
+				os_strerror(errno));
+	tf->tf_arg = arg;
+	tf->tf_used = TRUE;
+	sigfillset(&allmsk);
+	pthread_sigmask(SIG_BLOCK, &allmsk, &oldmsk);
+	err = pthread_create(&thr, (pthread_attr_t *)NULL,
+				os_tfdloop, (void *)tf);
+	pthread_sigmask(SIG_SETMASK, &oldmsk, (sigset_t *)NULL);
+	if (err)
+	    panic("os_tfdtimer: pthread_create failed - %s",
+				os_strerror(err));
+	pthread_detach(thr);
+    }
+    pthread_mutex_unlock(&ostfdlock);
+
+    tf->tf_rtn = rtn;
+    its.it_interval.tv_sec  = its.it_value.tv_sec  = usecs / 1000000;
+    its.it_interval.tv_nsec = its.it_value.tv_nsec = (usecs % 1000000) * 1000;
+    tf->tf_usec = usecs;
+    if (timerfd_settime(tf->tf_fd, 0, &its, (struct itimerspec *)NULL) < 0)
+	panic("os_tfdtimer: timerfd_settime failed - %s", os_strerror(errno));
+}
+
+/* OS_TFDIDLE - clk_idle() for the timerfd clock of arg.
+**	Sleeps until the next callout or until some signal handler sets
+**	INSBRK.  The sleep is timed to the timer's next expiration; if the
+**	clock thread hasn't quite made its callout by then, wait for it
+**	in short naps.
+*/
+void
+os_tfdidle(void *arg)
+{
+    register struct ostfd *tf;
+    struct itimerspec its;
+    osstm_t stm;
+    unsigned long ticks;
+
+    if (!(tf = os_tfdfind(arg)) || !tf->tf_usec)
+	return;
+    ticks = tf->tf_nticks;
+    if (timerfd_gettime(tf->tf_fd, &its) < 0)
+	return;
+    stm = its.it_value;
+    while (!INSBRKTEST() && os_msleep(&stm) > 0) ;
+    while (!INSBRKTEST() && ticks == tf->tf_nticks && tf->tf_usec) {
+	stm.tv_sec = 0;
+	stm.tv_nsec = 20000;		/* 20 usec */
+	os_msleep(&stm);
+    }
+}
+
+/* OS_TFDSTATS - Report # callouts, # expirations missed, and the most
+**	usec a callout was late, for the timer of arg.
+*/
+void
+os_tfdstats(void *arg,
+	    unsigned long *anticks,
+	    unsigned long *anover,
+	    long *amaxlate)
+{
+    register struct ostfd *tf = os_tfdfind(arg);
+
+    *anticks = tf ? tf->tf_nticks : 0;
+    *anover = tf ? tf->tf_nover : 0;
+    *amaxlate = tf ? tf->tf_maxlate : 0;
+}
+
+#endif /* KLH10_CLK_TIMERFD */
+
+#if KLH10_EVHS_BELL
+
+/* Doorbell watcher for DP_XT_MSEM and KLH10_RP_THREAD.
+**	Device subprocs (or I/O threads) ring the 10 by writing to an
+** eventfd.  One thread of ours waits on all of them with epoll; when a
+** bell rings it drains the eventfd and invokes the callout registered
+** for it, which like a signal handler may only set interrupt flags.
+** If the machine owning the bell is idling, its thread is then poked
+** with SIGUSR2, which only serves to end its sleep; otherwise nothing
+** is delivered to it at all.
+**	The thread handles each batch of events with the table locked,
+** and an event names its entry by index and generation, so an entry
+** unwatched (and maybe reused) since epoll_wait returned is skipped,
+** and os_bellunwatch can't return while the entry is still in use.
+*/
+#if !(HAVE_PTHREAD_H && HAVE_SYS_EPOLL_H)
+# error "KLH10_EVHS_BELL needs <pthread.h> and <sys/epoll.h>"
+#endif
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+
+#ifndef OSBELL_MAX
+# define OSBELL_MAX 64		/* Max # of bells watched */
+#endif
+
+static struct {
+    int ob_epfd;		/* epoll fd, -1 until first use */
+    pthread_mutex_t ob_lock;	/* Guards table and its use */
+    struct osbell {
+	int obe_fd;		/* eventfd, -1 if slot free */
+	uint32_t obe_gen;	/* Bumped each time slot is taken */
+	void (*obe_rtn)(void *);
+	void *obe_arg;
+	void *obe_key;		/* Machine the bell belongs to */
+	volatile int obe_idle;	/* TRUE while that machine idles */
+	pthread_t obe_idthr;	/* Thread that is idling */
+    } ob_tab[OSBELL_MAX];
+} osbell = { -1, PTHREAD_MUTEX_INITIALIZER };
+
+static void
+os_bellsig(int junk)
+{
+    /* Do nothing -- call merely breaks out of an idle sleep */
+}
+
+static void *
+os_bellloop(void *arg)
+{
+    struct epoll_event evs[16];
+    struct osbell *rung[16];
+    register struct osbell *obe;
+    uint64_t n;
+    int i, nev;
+
+    for (;;) {
+	if ((nev = epoll_wait(osbell.ob_epfd, evs, 16, -1)) < 0) {
+	    if (errno == EINTR)
+		continue;
+	    panic("os_bellloop: epoll_wait failed - %s", os_strerror(errno));
+	}
+	pthread_mutex_lock(&osbell.ob_lock);
+	for (i = 0; i < nev; ++i) {
+	    obe = &osbell.ob_tab[(unsigned)(evs[i].data.u64 & 0xFFFF)];
+	    if (obe->obe_fd < 0
+	      || obe->obe_gen != (uint32_t)(evs[i].data.u64 >> 32)) {
+		rung[i] = NULL;
+		continue;		/* Unwatched meanwhile */
+	    }
+	    (void) read(obe->obe_fd, (char *)&n, sizeof(n));
+	    (*obe->obe_rtn)(obe->obe_arg);
+	    rung[i] = obe;
+	}
+	for (i = 0; i < nev; ++i)	/* Wake each machine that was rung */
+	    if ((obe = rung[i]) && obe->obe_idle)
+		pthread_kill(obe->obe_idthr, SIGUSR2);
+	pthread_mutex_unlock(&osbell.ob_lock);
+    }
+    return NULL;
+}
+
+/* OS_BELLWATCH - Invoke rtn(arg) from the watcher thread whenever fd,
+**	a non-blocking eventfd, is written, and wake machine "key" if it
+**	is idling.  The one thread serves all machines; it is started on
+**	first use, with all signals blocked.  Returns FALSE if can't.
+*/
+int
+os_bellwatch(int fd, void (*rtn)(void *), void *arg, void *key)
+{
+    register struct osbell *obe;
+    struct epoll_event ev;
+    pthread_t thr;
+    sigset_t allmsk, oldmsk;
+    int i, err;
+
+    pthread_mutex_lock(&osbell.ob_lock);
+    if (osbell.ob_epfd < 0) {
+	for (i = 0; i < OSBELL_MAX; ++i)
+	    osbell.ob_tab[i].obe_fd = -1;
+	if ((osbell.ob_epfd = epoll_create1(0)) < 0) {
+	    fprintf(stderr, "[os_bellwatch: epoll_create1 failed - %s]\r\n",
+				os_strerror(errno));
+	    pthread_mutex_unlock(&osbell.ob_lock);
+	    return FALSE;
+	}
+	osux_signal(SIGUSR2, os_bellsig);
+	sigfillset(&allmsk);
+	pthread_sigmask(SIG_BLOCK, &allmsk, &oldmsk);
+	err = pthread_create(&thr, (pthread_attr_t *)NULL,
+				os_bellloop, (void *)NULL);
+	pthread_sigmask(SIG_SETMASK, &oldmsk, (sigset_t *)NULL);
+	if (err) {
+	    fprintf(stderr, "[os_bellwatch: pthread_create failed - %s]\r\n",
+				os_strerror(err));
+	    close(osbell.ob_epfd);
+	    osbell.ob_epfd = -1;
+	    pthread_mutex_unlock(&osbell.ob_lock);
+	    return FALSE;
+	}
+	pthread_detach(thr);
+    }
+
+    for (i = 0, obe = osbell.ob_tab; i < OSBELL_MAX; ++i, ++obe)
+	if (obe->obe_fd < 0)
+	    break;
+    if (i >= OSBELL_MAX) {
+	fprintf(stderr, "[os_bellwatch: out of table entries!]\r\n");
+	pthread_mutex_unlock(&osbell.ob_lock);
+	return FALSE;
+    }
+    obe->obe_rtn = rtn;
+    obe->obe_arg = arg;
+    obe->obe_key = key;
+    obe->obe_idle = FALSE;
+    obe->obe_fd = fd;
+    ++obe->obe_gen;
+    ev.events = EPOLLIN;
+    ev.data.u64 = ((uint64_t)obe->obe_gen << 32) | (uint64_t)i;
+    if (epoll_ctl(osbell.ob_epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+	fprintf(stderr, "[os_bellwatch: epoll_ctl failed - %s]\r\n",
+				os_strerror(errno));
+	obe->obe_fd = -1;
+	pthread_mutex_unlock(&osbell.ob_lock);
+	return FALSE;
+    }
+    pthread_mutex_unlock(&osbell.ob_lock);
+    return TRUE;
+}
+
+/* OS_BELLUNWATCH - Stop watching fd.  Must be done before closing it.
+**	Once this returns the watcher thread is done with its entry.
+*/
+void
+os_bellunwatch(int fd)
+{
+    register struct osbell *obe;
+    register int i;
+
+    pthread_mutex_lock(&osbell.ob_lock);
+    for (i = 0, obe = osbell.ob_tab; i < OSBELL_MAX; ++i, ++obe)
+	if (obe->obe_fd == fd) {
+	    (void) epoll_ctl(osbell.ob_epfd, EPOLL_CTL_DEL, fd,
+				(struct epoll_event *)NULL);
+	    obe->obe_fd = -1;
+	}
+    pthread_mutex_unlock(&osbell.ob_lock);
+}
+
+/* OS_BELLIDLE - Called by clk_idle() of machine "key" with TRUE before
+**	idling and FALSE after, so one of its bells can end the sleep.
+**	The idle routines all test INSBRK before sleeping, after this
+**	flag is set.
+*/
+void
+os_bellidle(void *key, int on)
+{
+    register struct osbell *obe;
+    register int i;
+    pthread_t self = pthread_self();
+
+    pthread_mutex_lock(&osbell.ob_lock);
+    for (i = 0, obe = osbell.ob_tab; i < OSBELL_MAX; ++i, ++obe)
+	if (obe->obe_fd >= 0 && obe->obe_key == key) {
+	    if (on)
+		obe->obe_idthr = self;
+	    obe->obe_idle = on;
+	}
+    pthread_mutex_unlock(&osbell.ob_lock);
+}
+
+#endif /* KLH10_EVHS_BELL */
+
+/* OS_RTIDLE - special function for clk_idle() with a counted clock.
+**	Idles for up to usec microseconds of real time, or until some
+**	signal handler sets INSBRK.  Returns # usec left unslept (0 if all).
+** A signal arriving just before the sleep starts is only noticed when
+** the sleep ends, which the caller bounds to one clock interval.
+*/
+int32
+os_rtidle(int32 usec)
+{
+#if HAVE_NANOSLEEP
+    osstm_t stm;
+
+    stm.tv_sec = usec / 1000000;
+    stm.tv_nsec = (usec % 1000000) * 1000;
+    while (!INSBRKTEST() && os_msleep(&stm) > 0) ;
+    return (int32)(stm.tv_sec * 1000000 + stm.tv_nsec / 1000);
+#else
+    return usec;		/* Can't idle, caller keeps spinning */
+#endif
+}
+
 /* OS_SLEEP - Sleep for N seconds regardless of signals.
 **	This must not conflict with the behavior of os_timer().  Certain
 ** systems may require special hackery to achieve this.
@@ -1673,6 +2061,61 @@ os_mmkill(osmm_t mm, char *ptr)
     return TRUE;
 }
 
+/* Return # of attaches to a shared segment, including ours, or -1 if
+**	unknown.
+*/
+int
+os_mmusers(osmm_t mm)
+{
+#if CENV_SYS_UNIX && KLH10_DEV_DP
+    struct shmid_ds ds;
+
+    if (shmctl(mm, IPC_STAT, &ds) == 0)
+	return (int) ds.shm_nattch;
+#endif
+    return -1;
+}
+
+/* Map part of an open file into our address space, for fast loading
+**	of large images.  The mapping is private; if WRT is set it can
+**	also be written, copying each page on its first write, which lets
+**	many processes share one image until they change it.
+**	Returns FALSE if the file can't be mapped, in which case the
+**	caller should just read it.
+*/
+#if CENV_SYS_UNIX
+# include <sys/mman.h>
+#endif
+
+int
+os_fmmap(int fd, long off, size_t siz, int wrt, char **aptr)
+{
+#if CENV_SYS_UNIX
+    char *ptr;
+
+    ptr = (char *)mmap((void *)0, siz,
+		       (wrt ? (PROT_READ|PROT_WRITE) : PROT_READ),
+		       MAP_PRIVATE, fd, (off_t)off);
+    if (ptr == (char *)MAP_FAILED)
+	return FALSE;
+    *aptr = ptr;
+    return TRUE;
+#else
+    errno = 0;			/* No error, just not implemented */
+    return FALSE;
+#endif
+}
+
+int
+os_fmunmap(char *ptr, size_t siz)
+{
+#if CENV_SYS_UNIX
+    return (munmap((void *)ptr, siz) == 0);
+#else
+    return FALSE;
+#endif
+}
+
 /* Attempt to lock all of our process memory now and in the future.
 */
 #if HAVE_MLOCKALL
@@ -192,6 +192,21 @@ extern osintf_t os_swap(osintf_t *, int);
 #define INTF_ACTBEG(flag) do { (flag) = 2
 #define INTF_ACTEND(flag) } while (os_swap(&(flag), 0) != 2)
 
+/* Host cycle counter, for profiling.
+**	OS_CYCLES(v) sets v (an unsigned long) to a free-running count of
+**	host CPU cycles.  Only differences are meaningful.  Where there is
+**	no cheap counter, OS_HAVECYCLES is 0 and v is always 0.
+*/
+#if defined(__GNUC__) && defined(__x86_64__)
+# define OS_HAVECYCLES 1
+# define OS_CYCLES(v) { register unsigned int lo__, hi__; \
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo__), "=d" (hi__)); \
+	(v) = ((unsigned long)hi__ << 32) | lo__; }
+#else
+# define OS_HAVECYCLES 0
+# define OS_CYCLES(v) ((v) = 0)
+#endif
+
 
 /* Time facilities */
 
@@ -272,6 +287,17 @@ extern void os_vtimer(ossighandler_t *, uint32);
 extern void os_timer(int, ossighandler_t *, uint32, ostimer_t *);
 extern void os_timer_restore(ostimer_t *);
 extern void os_v2rt_idle(ossighandler_t *);
+extern int32 os_rtidle(int32);
+#if KLH10_CLK_TIMERFD
+extern void os_tfdtimer(void (*)(void *), void *, uint32);
+extern void os_tfdidle(void *);
+extern void os_tfdstats(void *, unsigned long *, unsigned long *, long *);
+#endif
+#if KLH10_EVHS_BELL
+extern int  os_bellwatch(int, void (*)(void *), void *, void *);
+extern void os_bellunwatch(int);
+extern void os_bellidle(void *, int);
+#endif
 extern void os_sleep(int);
 extern int  os_msleep(osstm_t *);
 
@@ -304,6 +330,9 @@ typedef int osmm_t;
 extern int os_mmcreate(size_t, osmm_t *, char **);
 extern int os_mmshare(osmm_t, char **);
 extern int os_mmkill(osmm_t, char *);
+extern int os_mmusers(osmm_t);
+extern int os_fmmap(int, long, size_t, int, char **);
+extern int os_fmunmap(char *, size_t);
 extern int os_memlock(int);
 
 /* Dynamic Library Loading facilities */
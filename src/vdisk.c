@@ -93,6 +93,15 @@ vdkerror(register struct vdk_unit *d, char *fmt, ...)
 }
 
 
+#if !VDK_DISKMAP
+static int vdk_fdread(struct vdk_unit *, osfd_t, w10_t *, uint32, int);
+static int vdk_fdwrite(struct vdk_unit *, osfd_t, w10_t *, uint32, int);
+static int vdk_ovmount(struct vdk_unit *);
+static void vdk_ovunmount(struct vdk_unit *);
+static int vdk_ovread(struct vdk_unit *, w10_t *, uint32, int);
+static int vdk_ovwrite(struct vdk_unit *, w10_t *, uint32, int);
+#endif
+
 int
 vdk_init(register struct vdk_unit *d,
 	 void (*errhdlr)(struct vdk_unit *, char *),
@@ -115,6 +124,13 @@ vdk_mount(register struct vdk_unit *d,
 	d->dk_err = EINVAL;	/* Invalid arg */
 	return FALSE;		/* Not initialized */
     }
+#if VDK_DISKMAP
+    if (d->dk_ismap && d->dk_ovpath) {
+	vdkerror(d, "vdk_mount: Can't use overlay with mapped disk");
+	d->dk_err = EINVAL;
+	return FALSE;
+    }
+#endif
 
     /* Prepare some things that depend on format.
     ** If doing conversion, the buffer pointed to by dk_buf needs to be big
@@ -188,11 +204,12 @@ vdk_mount(register struct vdk_unit *d,
 
     /* Actually open the real device! */
     d->dk_iswrite = wrtf;			/* See if writing */
-    if (!os_fdopen(&d->dk_fd, path, (wrtf ? "+b" : "rb"))) {
+    if (!os_fdopen(&d->dk_fd, path,		/* Overlay takes writes */
+		   ((wrtf && !d->dk_ovpath) ? "+b" : "rb"))) {
 	/* Diskfile doesn't appear to exist, try to create it */
 	fprintf(stderr, "[Creating %s disk file \"%s\"]\r\n",
 			d->dk_devname, path);
-	if (!wrtf || !os_fdopen(&d->dk_fd, path, "+bc")) {
+	if (!wrtf || d->dk_ovpath || !os_fdopen(&d->dk_fd, path, "+bc")) {
 	    vdkerror(d, "vdk_mount: Cannot create %s disk file \"%s\"",
 			d->dk_devname, path);
 	    d->dk_err = errno;
@@ -215,11 +232,20 @@ vdk_mount(register struct vdk_unit *d,
 	}
     }
 #endif
+#if !VDK_DISKMAP
+    if (d->dk_ovpath && !vdk_ovmount(d)) {
+	os_fdclose(d->dk_fd);
+	return FALSE;
+    }
+#endif
 
     /* Success, remember the filename */
     if (!(d->dk_filename = (char *)malloc(strlen(path)+1))) {
 	vdkerror(d, "vdk_mount: Cannot malloc pathname \"%s\"", path);
 	d->dk_err = errno;
+#if !VDK_DISKMAP
+	vdk_ovunmount(d);
+#endif
 	os_fdclose(d->dk_fd);
 	return FALSE;
     }
@@ -237,6 +263,8 @@ vdk_unmount(register struct vdk_unit *d)
 	    if (!vdk_unmap(d))
 		return 0;
 	}
+#else
+	vdk_ovunmount(d);
 #endif
 	if (!os_fdclose(d->dk_fd))
 	    return 0;
@@ -277,6 +305,20 @@ vdk_read(register struct vdk_unit *d,
     return vdk_mapio(d, 0, dwaddr, wp, (int)(nsec * VDK_NWDS(d)))
 
 #else
+    if (d->dk_ovmap)
+	return vdk_ovread(d, wp, secaddr, nsec);
+    return vdk_fdread(d, d->dk_fd, wp, secaddr, nsec);
+#endif
+}
+
+#if !VDK_DISKMAP
+static int
+vdk_fdread(register struct vdk_unit *d,
+	   osfd_t fd,		/* Diskfile or overlay */
+	   w10_t *wp,
+	   uint32 secaddr,
+	   int nsec)
+{
     register osdaddr_t daddr;
     register size_t bcnt;
     size_t ndone = 0;
@@ -289,14 +331,14 @@ vdk_read(register struct vdk_unit *d,
 	daddr = ((osdaddr_t)secaddr) * VDK_NWDS(d) * sizeof(w10_t);
 	bcnt = nsec * VDK_NWDS(d) * sizeof(w10_t);
 
-	if (!os_fdseek(d->dk_fd, daddr)) {
+	if (!os_fdseek(fd, daddr)) {
 	    d->dk_err = errno;		/* OS DEP!! */
 	    vdkerror(d, "vdk_read: seek failed for %"
 		     OSDADDR_FMT "d, errno = %d", daddr, errno);
 	    return 0;			/* Later do something better? */
 	}
 
-	if (!os_fdread(d->dk_fd, (char *)wp, bcnt, &ndone)) {
+	if (!os_fdread(fd, (char *)wp, bcnt, &ndone)) {
 	    d->dk_err = errno;		/* OS DEP!! */
 	    vdkerror(d, "vdk_read: failed: cnt %ld, ret %ld, errno = %d",
 		     (long)bcnt, (long)ndone, errno);
@@ -322,7 +364,7 @@ vdk_read(register struct vdk_unit *d,
 
     /* Set up for OS I/O */
     daddr = ((osdaddr_t)secaddr) * d->dk_bytesec; /* Disk addr in bytes */
-    if (!os_fdseek(d->dk_fd, daddr)) {
+    if (!os_fdseek(fd, daddr)) {
 	d->dk_err = errno;		/* OS DEP!! */
 	vdkerror(d, "vdk_read: seek failed for %" OSDADDR_FMT "d, errno = %d",
 			daddr, errno);
@@ -337,7 +379,7 @@ vdk_read(register struct vdk_unit *d,
 	secwant = (secleft <= d->dk_bufsecs) ? secleft : d->dk_bufsecs;
 	bcnt = secwant * d->dk_bytesec;		/* # bytes to read */
 
-	err = !os_fdread(d->dk_fd, (char *) d->dk_buf, bcnt, &ndone);
+	err = !os_fdread(fd, (char *) d->dk_buf, bcnt, &ndone);
 
 	/* Find # sectors read in (ie need conversion) */
 	secdone = (ndone == bcnt) ? secwant : (ndone / d->dk_bytesec);
@@ -367,8 +409,8 @@ vdk_read(register struct vdk_unit *d,
     }
 
     return nsec - secleft;
-#endif /* !VDK_DISKMAP */
 }
+#endif /* !VDK_DISKMAP */
 
 /* Write to disk.
 **	Return # sectors written.
@@ -398,6 +440,20 @@ vdk_write(register struct vdk_unit *d,
     return vdk_mapio(d, TRUE, dwaddr, wp, (int)(nsec * VDK_NWDS(d)))
 
 #else
+    if (d->dk_ovmap)
+	return vdk_ovwrite(d, wp, secaddr, nsec);
+    return vdk_fdwrite(d, d->dk_fd, wp, secaddr, nsec);
+#endif
+}
+
+#if !VDK_DISKMAP
+static int
+vdk_fdwrite(register struct vdk_unit *d,
+	    osfd_t fd,		/* Diskfile or overlay */
+	    w10_t *wp,
+	    uint32 secaddr,
+	    int nsec)
+{
     register osdaddr_t daddr;
     register size_t bcnt;
     size_t ndone = 0;
@@ -410,14 +466,14 @@ vdk_write(register struct vdk_unit *d,
 	daddr = ((osdaddr_t)secaddr) * VDK_NWDS(d) * sizeof(w10_t);
 	bcnt = nsec * VDK_NWDS(d) * sizeof(w10_t);
 
-	if (!os_fdseek(d->dk_fd, daddr)) {
+	if (!os_fdseek(fd, daddr)) {
 	    vdkerror(d, "vdk_write: seek failed for %" OSDADDR_FMT
 		     "d, errno = %d", daddr, errno);
 	    d->dk_err = errno;		/* OS DEP!! */
 	    return 0;			/* Later do something better? */
 	}
 
-	if (!os_fdwrite(d->dk_fd, (char *)wp, bcnt, &ndone)) {
+	if (!os_fdwrite(fd, (char *)wp, bcnt, &ndone)) {
 	    vdkerror(d, "vdk_write: failed: cnt %ld, ret %ld, errno = %d",
 			    (long)bcnt, (long)ndone, errno);
 	    d->dk_err = errno;		/* OS DEP!! */
@@ -435,7 +491,7 @@ vdk_write(register struct vdk_unit *d,
 
     /* Set up for OS I/O */
     daddr = ((osdaddr_t)secaddr) * d->dk_bytesec; /* Disk addr in bytes */
-    if (!os_fdseek(d->dk_fd, daddr)) {
+    if (!os_fdseek(fd, daddr)) {
 	vdkerror(d, "vdk_read: seek failed for %" OSDADDR_FMT "d, errno = %d",
 			daddr, errno);
 	d->dk_err = errno;		/* OS DEP!! */
@@ -454,7 +510,7 @@ vdk_write(register struct vdk_unit *d,
 
 	bcnt = secwant * d->dk_bytesec;		/* # bytes to write */
 
-	err = !os_fdwrite(d->dk_fd, (char *) d->dk_buf, bcnt, &ndone);
+	err = !os_fdwrite(fd, (char *) d->dk_buf, bcnt, &ndone);
 
 	/* Find # sectors written */
 	secdone = (ndone == bcnt) ? secwant : (ndone / d->dk_bytesec);
@@ -472,9 +528,140 @@ vdk_write(register struct vdk_unit *d,
     }
 
     return nsec - secleft;
-#endif /* !VDK_DISKMAP */
 }
+#endif /* !VDK_DISKMAP */
 
+#if !VDK_DISKMAP
+
+/* Overlay support.
+**	A sector is read from the overlay if its bit is set, else from the
+** diskfile; each run of sectors from the same place is one transfer.
+** Writes always go to the overlay, and the bitmap bytes that change are
+** then written back, so an overlay survives being unmounted and can be
+** mounted again later over the same diskfile.
+*/
+#define vdk_ovtest(d,s) (((s) < (d)->dk_ovsecs) \
+			&& ((d)->dk_ovmap[(s)>>3] & (1 << ((s)&07))))
+
+static int
+vdk_ovmount(register struct vdk_unit *d)
+{
+    size_t mapsiz, ndone;
+
+    d->dk_ovsecs = (uint32)d->dk_ncyls * d->dk_ntrks * d->dk_nsecs;
+    if (!d->dk_ovsecs) {
+	vdkerror(d, "vdk_mount: Overlay needs disk geometry");
+	d->dk_err = EINVAL;
+	return FALSE;
+    }
+    d->dk_ovmapoff = (osdaddr_t)d->dk_ovsecs * d->dk_bytesec;
+    mapsiz = (d->dk_ovsecs + 7) / 8;
+    if (!(d->dk_ovmap = (unsigned char *)calloc(mapsiz, 1))) {
+	vdkerror(d, "vdk_mount: Cannot alloc overlay map of size %ld",
+			(long)mapsiz);
+	d->dk_err = errno;
+	return FALSE;
+    }
+    if (!os_fdopen(&d->dk_ovfd, d->dk_ovpath, "+b")) {
+	fprintf(stderr, "[Creating %s overlay file \"%s\"]\r\n",
+			d->dk_devname, d->dk_ovpath);
+	if (!os_fdopen(&d->dk_ovfd, d->dk_ovpath, "+bc")) {
+	    vdkerror(d, "vdk_mount: Cannot create overlay file \"%.256s\"",
+			d->dk_ovpath);
+	    d->dk_err = errno;
+	    free(d->dk_ovmap);
+	    d->dk_ovmap = NULL;
+	    return FALSE;
+	}
+    }
+
+    /* Get existing map.  A new overlay is all zeros. */
+    if (!os_fdseek(d->dk_ovfd, d->dk_ovmapoff)
+      || !os_fdread(d->dk_ovfd, (char *)d->dk_ovmap, mapsiz, &ndone)) {
+	vdkerror(d, "vdk_mount: Cannot read overlay map, errno = %d", errno);
+	d->dk_err = errno;
+	vdk_ovunmount(d);
+	return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+vdk_ovunmount(register struct vdk_unit *d)
+{
+    if (d->dk_ovmap) {
+	os_fdclose(d->dk_ovfd);
+	free(d->dk_ovmap);
+	d->dk_ovmap = NULL;
+    }
+}
+
+static int
+vdk_ovread(register struct vdk_unit *d,
+	   w10_t *wp,
+	   uint32 secaddr,
+	   int nsec)
+{
+    register int n;
+    int inov, cnt, done = 0;
+
+    while (done < nsec) {
+	inov = vdk_ovtest(d, secaddr);
+	for (n = 1; (done + n) < nsec; ++n)
+	    if (!vdk_ovtest(d, secaddr + n) != !inov)
+		break;
+	cnt = vdk_fdread(d, (inov ? d->dk_ovfd : d->dk_fd),
+			 wp, secaddr, n);
+	done += cnt;
+	if (cnt < n)
+	    break;
+	wp += n * VDK_NWDS(d);
+	secaddr += n;
+    }
+    return done;
+}
+
+static int
+vdk_ovwrite(register struct vdk_unit *d,
+	    w10_t *wp,
+	    uint32 secaddr,
+	    int nsec)
+{
+    register uint32 s, end;
+    uint32 lo = 0, hi = 0;
+    int n, chg = FALSE;
+    size_t ndone;
+
+    /* Data first, so a sector is never marked before it's there */
+    n = vdk_fdwrite(d, d->dk_ovfd, wp, secaddr, nsec);
+
+    end = secaddr + n;
+    if (end > d->dk_ovsecs)
+	end = d->dk_ovsecs;
+    for (s = secaddr; s < end; ++s) {
+	if (!vdk_ovtest(d, s)) {
+	    d->dk_ovmap[s>>3] |= (1 << (s&07));
+	    if (!chg) {
+		lo = s>>3;
+		chg = TRUE;
+	    }
+	    hi = s>>3;
+	}
+    }
+    if (chg) {
+	if (!os_fdseek(d->dk_ovfd, d->dk_ovmapoff + lo)
+	  || !os_fdwrite(d->dk_ovfd, (char *)(d->dk_ovmap + lo),
+			 (size_t)(hi - lo + 1), &ndone)) {
+	    d->dk_err = errno;
+	    vdkerror(d, "vdk_write: overlay map update failed, errno = %d",
+			errno);
+	    return 0;
+	}
+    }
+    return n;
+}
+#endif /* !VDK_DISKMAP */
+
 /* Format conversion routines */
 
 /*
@@ -131,6 +131,17 @@ struct vdk_unit {
 	char *dk_errarg;	/* Arg to handler */
 	int dk_err;		/* # of last I/O error (0 if none) */
 
+	/* Overlay.  If dk_ovpath is set when mounting, the diskfile is
+	** opened read-only and every sector written goes to the overlay
+	** file instead, at the same place it would have in the diskfile.
+	** A bitmap of the sectors so written follows the data.
+	*/
+	char *dk_ovpath;	/* Pathname of overlay file, if any */
+	osfd_t dk_ovfd;		/* Overlay file I/O handle */
+	unsigned char *dk_ovmap; /* M Bitmap, 1 = sector is in overlay */
+	uint32 dk_ovsecs;	/* # sectors covered by bitmap */
+	osdaddr_t dk_ovmapoff;	/* Offset of bitmap in overlay file */
+
 #if VDK_DISKMAP
 	int dk_ismap;		/* TRUE if disk being mapped */
 	struct vdk_header dk_dfh;	/* Copy of diskfile header */